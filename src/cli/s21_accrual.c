@@ -0,0 +1,241 @@
+/*!
+ * \file s21_accrual.h
+ * \brief Начисление процентов на конец дня по книге вкладов с контрольными
+ * точками
+ *
+ * Файл счетов (записи deposit_account, см. s21_depositcal.h) отображается в
+ * память; выходной файл из записей deposit_accrual — по 16 байт на счёт в
+ * том же порядке — создаётся нужного размера и тоже отображается. Счета
+ * делятся на порции по ACCRUAL_CHUNK, которые распределяет пул потоков.
+ *
+ * Рядом с выходным файлом ведётся файл контрольной точки "<выход>.ckpt":
+ * заголовок с размером и временем изменения файла счетов (с точностью до
+ * наносекунд) и по байту на порцию. Порция отмечается выполненной только
+ * после того, как её результаты сброшены на диск, поэтому прерванный запуск
+ * с теми же файлами продолжает работу с невыполненных порций. Отметка
+ * хранит и то, были ли в порции неверные счета, поэтому продолжение
+ * завершается с тем же кодом, что и запуск без перерыва. После успешного
+ * завершения контрольная точка удаляется.
+ */
+#define _DEFAULT_SOURCE
+
+#include "s21_accrual.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../lib/s21_datatypes.h"
+#include "../lib/s21_depositcal.h"
+#include "../lib/s21_pool.h"
+
+/*!
+ * \struct accrual_job
+ * \brief Общее задание потоков: счета, итоги и отметки порций.
+ */
+typedef struct accrual_job {
+  const deposit_account *accounts;
+  deposit_accrual *out;
+  accrual_checkpoint *ckpt;
+  size_t count;
+} accrual_job;
+
+/*!
+ * \brief Возвращает время изменения файла в наносекундах.
+ */
+static int64_t mtime_ns(const struct stat *st) {
+  return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+}
+
+/*!
+ * \brief Синхронно сбрасывает на диск диапазон отображения, выровненный по
+ * страницам.
+ */
+static int sync_range(void *from, size_t len) {
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t start = (size_t)from & ~(page - 1);
+  return msync((void *)start, (size_t)from - start + len, MS_SYNC);
+}
+
+/*!
+ * \brief Начисляет проценты по невыполненным порциям с from по to.
+ */
+static void accrual_range(void *arg, int from, int to) {
+  accrual_job *job = arg;
+  for (int c = from; c < to; c++) {
+    if (__atomic_load_n(&job->ckpt->done[c], __ATOMIC_RELAXED)) continue;
+    size_t start = (size_t)c * ACCRUAL_CHUNK;
+    size_t len = job->count - start < ACCRUAL_CHUNK ? job->count - start
+                                                    : ACCRUAL_CHUNK;
+    int status =
+        accrueDeposits(job->accounts + start, (long)len, job->out + start);
+    unsigned char mark = status == OK ? ACCRUAL_DONE : ACCRUAL_DONE_INVALID;
+    // отметка не должна опередить данные порции на диске; порция, которую
+    // не удалось сбросить, остаётся невыполненной
+    if (sync_range(job->out + start, len * sizeof(deposit_accrual)) == 0)
+      __atomic_store_n(&job->ckpt->done[c], mark, __ATOMIC_RELEASE);
+  }
+}
+
+/*!
+ * \brief Открывает файл контрольной точки и проверяет, что он относится к
+ * тому же файлу счетов; иначе создаёт новый.
+ *
+ * \param path Путь к файлу контрольной точки.
+ * \param in Сведения о файле счетов.
+ * \param nchunks Число порций.
+ * \param resumed Указатель для записи признака продолжения.
+ * \return Отображение контрольной точки или MAP_FAILED.
+ */
+static accrual_checkpoint *open_checkpoint(const char *path,
+                                           const struct stat *in,
+                                           size_t nchunks, int *resumed) {
+  size_t size = sizeof(accrual_checkpoint) + nchunks;
+  accrual_checkpoint *ckpt = MAP_FAILED;
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  struct stat st;
+  if (fd >= 0 && fstat(fd, &st) == 0) {
+    *resumed = (size_t)st.st_size == size;
+    if (*resumed || ftruncate(fd, (off_t)size) == 0)
+      ckpt = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (fd >= 0) close(fd);
+  if (ckpt != MAP_FAILED) {
+    size_t count = (size_t)in->st_size / sizeof(deposit_account);
+    *resumed = *resumed &&
+               !memcmp(ckpt->magic, ACCRUAL_MAGIC, sizeof(ckpt->magic)) &&
+               ckpt->count == count && ckpt->chunk == ACCRUAL_CHUNK &&
+               ckpt->input_size == (uint64_t)in->st_size &&
+               ckpt->input_mtime_ns == mtime_ns(in);
+    if (!*resumed) {
+      memset(ckpt, 0, size);
+      strcpy(ckpt->magic, ACCRUAL_MAGIC);
+      ckpt->count = count;
+      ckpt->chunk = ACCRUAL_CHUNK;
+      ckpt->input_size = (uint64_t)in->st_size;
+      ckpt->input_mtime_ns = mtime_ns(in);
+      msync(ckpt, size, MS_SYNC);
+    }
+  }
+  return ckpt;
+}
+
+/*!
+ * \brief Создаёт (или при продолжении открывает) выходной файл на count
+ * итогов и отображает его в память.
+ *
+ * \return Адрес отображения, NULL для пустой книги или MAP_FAILED.
+ */
+static deposit_accrual *map_accruals(const char *path, size_t count,
+                                     int resumed) {
+  void *map = MAP_FAILED;
+  size_t size = count * sizeof(deposit_accrual);
+  int fd = open(path, O_RDWR | O_CREAT | (resumed ? 0 : O_TRUNC), 0644);
+  struct stat st;
+  int valid = fd >= 0 && fstat(fd, &st) == 0;
+  // при продолжении выходной файл должен быть прежнего размера
+  if (valid && resumed) valid = (size_t)st.st_size == size;
+  if (valid && !resumed) valid = ftruncate(fd, (off_t)size) == 0;
+  if (valid)
+    map = size ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+               : NULL;
+  if (fd >= 0) close(fd);
+  return map;
+}
+
+/*!
+ * \brief Начисляет проценты по книге вкладов и записывает итоги.
+ *
+ * \param path Путь к файлу счетов.
+ * \param out_path Путь к выходному файлу итогов.
+ * \param threads Число потоков (0 — по числу процессоров).
+ * \param pin TRUE, чтобы закрепить потоки за процессорами.
+ * \return OK или ERROR (сообщение об ошибке выводится в stderr); неверные
+ * счета тоже дают ERROR, их итоги равны DEPOSIT_INVALID.
+ */
+int eval_accruals(const char *path, const char *out_path, int threads,
+                  int pin) {
+  const deposit_account *accounts = MAP_FAILED;
+  struct stat in;
+  int fd = open(path, O_RDONLY);
+  int error = fd >= 0 && fstat(fd, &in) == 0 &&
+                      in.st_size % sizeof(deposit_account) == 0
+                  ? OK
+                  : ERROR;
+  size_t count = error == OK ? (size_t)in.st_size / sizeof(deposit_account) : 0;
+  if (error == OK)
+    accounts = count ? mmap(NULL, (size_t)in.st_size, PROT_READ, MAP_SHARED,
+                            fd, 0)
+                     : NULL;
+  if (fd >= 0) close(fd);
+  if (accounts == MAP_FAILED) {
+    fprintf(stderr, "%s: cannot map a file of deposit accounts\n", path);
+    return ERROR;
+  }
+  if (accounts) madvise((void *)accounts, (size_t)in.st_size, MADV_SEQUENTIAL);
+
+  size_t nchunks = (count + ACCRUAL_CHUNK - 1) / ACCRUAL_CHUNK;
+  char *ckpt_path = malloc(strlen(out_path) + sizeof(".ckpt"));
+  if (ckpt_path) sprintf(ckpt_path, "%s.ckpt", out_path);
+  int resumed = FALSE;
+  accrual_checkpoint *ckpt =
+      ckpt_path ? open_checkpoint(ckpt_path, &in, nchunks, &resumed)
+                : MAP_FAILED;
+  deposit_accrual *out = MAP_FAILED;
+  if (ckpt == MAP_FAILED) {
+    perror(ckpt_path ? ckpt_path : out_path);
+    error = ERROR;
+  } else {
+    out = map_accruals(out_path, count, resumed);
+    if (out == MAP_FAILED && resumed) {
+      // выходной файл не соответствует контрольной точке: начать заново
+      memset(ckpt->done, 0, nchunks);
+      out = map_accruals(out_path, count, FALSE);
+    }
+    if (out == MAP_FAILED) {
+      perror(out_path);
+      error = ERROR;
+    }
+  }
+
+  if (error == OK) {
+    size_t done = 0;
+    for (size_t c = 0; resumed && c < nchunks; c++) done += ckpt->done[c] != 0;
+    if (done)
+      fprintf(stderr, "%s: resuming, %zu of %zu chunks already done\n",
+              out_path, done, nchunks);
+    accrual_job job = {accounts, out, ckpt, count};
+    if (threads <= 0) threads = default_threads();
+    if ((size_t)threads > nchunks) threads = (int)nchunks;
+    work_pool *pool = NULL;
+    // без пула порции обрабатываются в вызывающем потоке
+    if (threads > 1) pool_create(threads, pin, &pool);
+    pool_run(pool, (int)nchunks, accrual_range, &job);
+    pool_destroy(pool);
+    // неверные счета учитываются и в порциях, выполненных до перерыва
+    size_t undone = 0, invalid = 0;
+    for (size_t c = 0; c < nchunks; c++) {
+      undone += ckpt->done[c] == 0;
+      invalid += ckpt->done[c] == ACCRUAL_DONE_INVALID;
+    }
+    if (invalid) fprintf(stderr, "%s: invalid accounts\n", path);
+    if (undone)
+      fprintf(stderr, "%s: %zu chunks could not be written\n", out_path,
+              undone);
+    error = invalid || undone ? ERROR : OK;
+  }
+  // контрольная точка нужна только незавершённому запуску
+  int complete = ckpt != MAP_FAILED && out != MAP_FAILED;
+  for (size_t c = 0; complete && c < nchunks; c++) complete = ckpt->done[c];
+  if (out && out != MAP_FAILED)
+    munmap(out, count * sizeof(deposit_accrual));
+  if (ckpt != MAP_FAILED) munmap(ckpt, sizeof(accrual_checkpoint) + nchunks);
+  if (complete) unlink(ckpt_path);
+  if (accounts) munmap((void *)accounts, (size_t)in.st_size);
+  free(ckpt_path);
+  return error;
+}
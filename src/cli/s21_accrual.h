@@ -0,0 +1,34 @@
+#ifndef S21_ACCRUAL_H
+#define S21_ACCRUAL_H
+
+#include <stdint.h>
+
+//! Число счетов в одной порции; порция — единица работы потока и
+//! контрольной точки.
+#define ACCRUAL_CHUNK (1 << 16)
+
+//! Метка файла контрольной точки.
+#define ACCRUAL_MAGIC "SCACCR2"
+
+//! Отметка порции: результаты на диске.
+#define ACCRUAL_DONE 1
+
+//! Отметка порции: результаты на диске, среди счетов есть неверные.
+#define ACCRUAL_DONE_INVALID 2
+
+/*!
+ * \struct accrual_checkpoint
+ * \brief Файл контрольной точки: заголовок и отметки выполненных порций.
+ */
+typedef struct accrual_checkpoint {
+  char magic[8];
+  uint64_t count;
+  uint64_t chunk;
+  uint64_t input_size;
+  int64_t input_mtime_ns;
+  unsigned char done[];
+} accrual_checkpoint;
+
+int eval_accruals(const char *path, const char *out_path, int threads,
+                  int pin);
+#endif
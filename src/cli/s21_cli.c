@@ -0,0 +1,463 @@
+/*!
+ * \file s21_cli.c
+ * \brief Консольный пакетный вычислитель выражений
+ *
+ * Читает выражения по одному на строку из файлов или стандартного ввода и
+ * печатает результаты в том же порядке. После точки с запятой можно задать
+ * значения переменных:
+ *
+ *     a * x + b ; x = 2, a = 3, b = 4
+ *
+ * Строки читаются блоками по CLI_BLOCK, каждый блок вычисляется параллельно
+ * в пуле потоков с перехватом работы (см. s21_pool.h; ключ -a закрепляет
+ * потоки за процессорами), затем результаты блока выводятся по порядку.
+ * С ключом -s программа работает как сервис вычислений на Unix-сокете
+ * (см. s21_serve.h), ключ -l задаёт срок одного запроса в миллисекундах;
+ * с ключом -e — вычисляет одно выражение по столбцам из двоичных файлов
+ * (см. s21_columns.h):
+ *
+ *     smartcalc-cli -e "x * y" -c x=x.bin -c y=y.bin -o out.bin
+ *
+ * С ключом -t — дописывает к строкам CSV значения выражений (см. s21_csv.h):
+ *
+ *     smartcalc-cli -t -e "total = q * x" -c x=price -c q=qty data.csv
+ *
+ * С ключом -w строки вида "имя = выражение" компилируются и сохраняются в
+ * файл библиотеки программ (см. s21_library.h). С ключом -b — рассчитывает
+ * итоги портфеля кредитов по календарным месяцам (см. s21_loans.h):
+ *
+ *     smartcalc-cli -b loans.bin -o totals.csv
+ *
+ * С ключом -d — начисляет проценты на конец дня по книге вкладов с
+ * контрольными точками (см. s21_accrual.h):
+ *
+ *     smartcalc-cli -d accounts.bin -o accruals.bin
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/s21_datatypes.h"
+#include "../lib/s21_library.h"
+#include "../lib/s21_program.h"
+#include "../lib/s21_pool.h"
+#include "s21_accrual.h"
+#include "s21_columns.h"
+#include "s21_csv.h"
+#include "s21_loans.h"
+#include "s21_serve.h"
+
+//! Число строк, которые читаются и вычисляются за один раз.
+#define CLI_BLOCK 8192
+
+//! Результат строки: пустая строка.
+#define CLI_EMPTY 0
+
+//! Результат строки: значение вычислено.
+#define CLI_VALUE 1
+
+//! Результат строки: ошибка разбора или вычисления.
+#define CLI_ERROR 2
+
+/*!
+ * \struct cli_task
+ * \brief Блок строк с буферами результатов.
+ */
+typedef struct cli_task {
+  char **lines;
+  double *values;
+  int *kinds;
+  int n;
+  int precision;
+} cli_task;
+
+/*!
+ * \struct cli_options
+ * \brief Ключи командной строки.
+ */
+typedef struct cli_options {
+  int threads;
+  int pin;
+  int precision;
+  const char *socket_path;
+  long long timeout_ms;
+  int csv;
+  const char *exprs[CSV_MAX_EXPRS];
+  int nexprs;
+  const char *out_path;
+  const char *library_path;
+  const char *loans_path;
+  const char *accounts_path;
+  column_bind binds[S21_MAX_VARS];
+  int nbinds;
+  int first;
+} cli_options;
+
+/*!
+ * \brief Разбирает значения переменных вида "a = 1, b = 2".
+ *
+ * \param text Строка со значениями.
+ * \param prog Программа, по слотам которой раскладываются значения.
+ * \param vars Массив значений по слотам.
+ * \param bound Массив отметок о заданных слотах.
+ * \return OK или ERROR при неверной записи.
+ */
+static int parse_bindings(const char *text, const program *prog,
+                          double *vars, int *bound) {
+  int error = OK;
+  while (error == OK && *text) {
+    while (*text == ' ' || *text == '\t' || *text == ',') text++;
+    if (*text == '\0') break;
+    char name = *text++;
+    while (*text == ' ' || *text == '\t') text++;
+    if (name < 'a' || name > 'z' || *text++ != '=') {
+      error = ERROR;
+    } else {
+      char *end = NULL;
+      double value = strtod(text, &end);
+      if (end == text) error = ERROR;
+      int slot = program_var_slot(prog, name);
+      // лишние переменные не мешают вычислению
+      if (error == OK && slot != ERROR) {
+        vars[slot] = value;
+        bound[slot] = TRUE;
+      }
+      text = end;
+    }
+  }
+  return error;
+}
+
+/*!
+ * \brief Вычисляет одну строку ввода.
+ *
+ * \param line Строка без перевода строки; изменяется при разборе.
+ * \param precision Точность вычисления (P_DOUBLE или P_DDOUBLE).
+ * \param value Указатель для записи результата.
+ * \return CLI_EMPTY, CLI_VALUE или CLI_ERROR (в том числе для переменной
+ * без значения).
+ */
+static int eval_line(char *line, int precision, double *value) {
+  char *bindings = strchr(line, ';');
+  if (bindings) *bindings++ = '\0';
+  if (line[strspn(line, " \t\r")] == '\0') return CLI_EMPTY;
+
+  program prog = {0};
+  double vars[S21_MAX_VARS] = {0};
+  int bound[S21_MAX_VARS] = {0};
+  int error = compile_program_vars(line, &prog);
+  prog.precision = precision;
+  if (error == OK && bindings)
+    error = parse_bindings(bindings, &prog, vars, bound);
+  for (int v = 0; error == OK && v < prog.nvars; v++)
+    if (!bound[v] && program_uses_slot(&prog, v)) error = ERROR;
+  if (error == OK) error = calc_program_vars(&prog, vars, value);
+  remove_program(&prog);
+  return error == OK ? CLI_VALUE : CLI_ERROR;
+}
+
+/*!
+ * \brief Вычисляет строки блока с from по to.
+ */
+static void eval_range(void *arg, int from, int to) {
+  cli_task *t = arg;
+  for (int i = from; i < to; i++)
+    t->kinds[i] = eval_line(t->lines[i], t->precision, &t->values[i]);
+}
+
+/*!
+ * \brief Вычисляет блок строк в пуле потоков.
+ *
+ * Выражения в строках бывают очень разной длины, поэтому блок не делится
+ * поровну между потоками: пул с перехватом работы подбирает размер порций
+ * по измеренному времени и отдаёт оставшиеся строки освободившимся потокам.
+ *
+ * \param base Задание для всего блока.
+ * \param pool Пул потоков.
+ */
+static void eval_block(cli_task *base, work_pool *pool) {
+  pool_run(pool, base->n, eval_range, base);
+}
+
+/*!
+ * \brief Печатает результаты блока в порядке строк.
+ *
+ * \param base Вычисленный блок.
+ * \param out Поток вывода.
+ */
+static void print_block(const cli_task *base, FILE *out) {
+  for (int i = 0; i < base->n; i++) {
+    if (base->kinds[i] == CLI_VALUE)
+      fprintf(out, base->precision == P_DDOUBLE ? "%.17g\n" : "%.15g\n",
+              base->values[i]);
+    else if (base->kinds[i] == CLI_ERROR)
+      fputs("ERROR\n", out);
+    else
+      fputc('\n', out);
+  }
+}
+
+/*!
+ * \brief Вычисляет все строки потока ввода.
+ *
+ * \param in Поток ввода.
+ * \param block Буферы блока.
+ * \param pool Пул потоков.
+ * \return OK или ERROR при нехватке памяти.
+ */
+static int eval_stream(FILE *in, cli_task *block, work_pool *pool) {
+  char *buf = NULL;
+  size_t cap = 0;
+  ssize_t len = 0;
+  int error = OK;
+  while (error == OK && len >= 0) {
+    block->n = 0;
+    while (error == OK && block->n < CLI_BLOCK &&
+           (len = getline(&buf, &cap, in)) >= 0) {
+      while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == '\r'))
+        buf[--len] = '\0';
+      free(block->lines[block->n]);
+      block->lines[block->n] = strdup(buf);
+      if (block->lines[block->n] == NULL)
+        error = ERROR;
+      else
+        block->n++;
+    }
+    eval_block(block, pool);
+    print_block(block, stdout);
+  }
+  if (error != OK) perror("smartcalc-cli");
+  free(buf);
+  return error;
+}
+
+/*!
+ * \brief Разбирает ключи командной строки.
+ *
+ * \return OK или ERROR при неверных ключах.
+ */
+static int parse_options(int argc, char **argv, cli_options *opt) {
+  int error = OK;
+  int i = 1;
+  for (; i < argc && argv[i][0] == '-' && argv[i][1]; i++) {
+    int has_arg = i + 1 < argc;
+    if (!strcmp(argv[i], "-j") && has_arg) {
+      opt->threads = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-a")) {
+      opt->pin = TRUE;
+    } else if (!strcmp(argv[i], "-p") && has_arg) {
+      i++;
+      if (!strcmp(argv[i], "dd"))
+        opt->precision = P_DDOUBLE;
+      else if (!strcmp(argv[i], "double"))
+        opt->precision = P_DOUBLE;
+      else
+        error = ERROR;
+    } else if (!strcmp(argv[i], "-s") && has_arg) {
+      opt->socket_path = argv[++i];
+    } else if (!strcmp(argv[i], "-l") && has_arg) {
+      opt->timeout_ms = atoll(argv[++i]);
+    } else if (!strcmp(argv[i], "-t")) {
+      opt->csv = TRUE;
+    } else if (!strcmp(argv[i], "-e") && has_arg &&
+               opt->nexprs < CSV_MAX_EXPRS) {
+      opt->exprs[opt->nexprs++] = argv[++i];
+    } else if (!strcmp(argv[i], "-w") && has_arg) {
+      opt->library_path = argv[++i];
+    } else if (!strcmp(argv[i], "-d") && has_arg) {
+      opt->accounts_path = argv[++i];
+    } else if (!strcmp(argv[i], "-b") && has_arg) {
+      opt->loans_path = argv[++i];
+    } else if (!strcmp(argv[i], "-o") && has_arg) {
+      opt->out_path = argv[++i];
+    } else if (!strcmp(argv[i], "-c") && has_arg && argv[i + 1][0] &&
+               argv[i + 1][1] == '=' && opt->nbinds < S21_MAX_VARS) {
+      column_bind b = {argv[i + 1][0], argv[i + 1] + 2};
+      opt->binds[opt->nbinds++] = b;
+      i++;
+    } else {
+      error = ERROR;
+    }
+  }
+  opt->first = i;
+  if (opt->threads < 1 || opt->timeout_ms < 0) error = ERROR;
+  if (opt->csv && opt->nexprs == 0) error = ERROR;
+  if (opt->accounts_path && opt->out_path == NULL) error = ERROR;
+  if (!opt->csv && opt->nexprs > 0 && (opt->out_path == NULL ||
+                                       opt->nexprs > 1))
+    error = ERROR;
+  return error;
+}
+
+/*!
+ * \brief Вычисляет строки CSV из файла (или стандартного ввода).
+ *
+ * \return OK или ERROR.
+ */
+static int run_csv(const cli_options *opt, int argc, char **argv) {
+  int error = OK;
+  const char *path = opt->first < argc ? argv[opt->first] : "-";
+  FILE *in = strcmp(path, "-") ? fopen(path, "r") : stdin;
+  if (in == NULL) {
+    perror(path);
+    error = ERROR;
+  } else {
+    error = eval_csv(in, stdout, opt->exprs, opt->nexprs, opt->binds,
+                     opt->nbinds, opt->threads, opt->precision);
+    if (in != stdin) fclose(in);
+  }
+  return error;
+}
+
+/*!
+ * \brief Добавляет в список программ строку вида "имя = выражение".
+ *
+ * \return OK или ERROR для строки без имени или с неверным выражением.
+ */
+static int add_named(const char *line, program **progs, char ***names,
+                     int *count, int *cap) {
+  char name[64];
+  const char *body = split_name(line, name, sizeof(name));
+  if (name[0] == '\0') return ERROR;
+  if (*count == *cap) {
+    int grown_cap = *cap ? *cap * 2 : 64;
+    program *grown = realloc(*progs, sizeof(program) * grown_cap);
+    if (grown) *progs = grown;
+    char **grown_names = realloc(*names, sizeof(char *) * grown_cap);
+    if (grown_names) *names = grown_names;
+    if (!grown || !grown_names) return ERROR;
+    *cap = grown_cap;
+  }
+  program prog = {0};
+  char *copy = strdup(name);
+  int error = copy ? compile_program_vars(body, &prog) : ERROR;
+  if (error == OK) {
+    (*progs)[*count] = prog;
+    (*names)[(*count)++] = copy;
+  } else {
+    free(copy);
+  }
+  return error;
+}
+
+/*!
+ * \brief Компилирует строки "имя = выражение" и сохраняет их в файл
+ * библиотеки программ (см. s21_library.h).
+ *
+ * \return OK или ERROR.
+ */
+static int run_save(const cli_options *opt, int argc, char **argv) {
+  program *progs = NULL;
+  char **names = NULL;
+  int count = 0, cap = 0, error = OK;
+  char *line = NULL;
+  size_t line_cap = 0;
+  for (int i = opt->first; error == OK && i <= argc; i++) {
+    if (i == argc && opt->first < argc) break;
+    const char *path = i < argc ? argv[i] : "-";
+    FILE *in = strcmp(path, "-") ? fopen(path, "r") : stdin;
+    if (in == NULL) {
+      perror(path);
+      error = ERROR;
+      continue;
+    }
+    ssize_t len;
+    for (int n = 1; error == OK && (len = getline(&line, &line_cap, in)) >= 0;
+         n++) {
+      while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+        line[--len] = '\0';
+      if (line[strspn(line, " \t")] == '\0') continue;
+      error = add_named(line, &progs, &names, &count, &cap);
+      if (error != OK) fprintf(stderr, "%s:%d: invalid line\n", path, n);
+    }
+    if (in != stdin) fclose(in);
+  }
+  for (int i = 0; i < count; i++) progs[i].precision = opt->precision;
+  if (error == OK) {
+    error = save_library(opt->library_path, progs, (const char *const *)names,
+                         count);
+    if (error != OK) perror(opt->library_path);
+  }
+  for (int i = 0; i < count; i++) {
+    remove_program(&progs[i]);
+    free(names[i]);
+  }
+  free(progs);
+  free(names);
+  free(line);
+  return error;
+}
+
+/*!
+ * \brief Вычисляет выражения по одному на строку из файлов или stdin.
+ *
+ * \return OK или ERROR.
+ */
+static int run_lines(const cli_options *opt, int argc, char **argv) {
+  int error = OK;
+  cli_task block = {calloc(CLI_BLOCK, sizeof(char *)),
+                    malloc(sizeof(double) * CLI_BLOCK),
+                    malloc(sizeof(int) * CLI_BLOCK), 0, opt->precision};
+  work_pool *pool = NULL;
+  if (!block.lines || !block.values || !block.kinds) error = ERROR;
+  if (error == OK) error = pool_create(opt->threads, opt->pin, &pool);
+  if (error == OK && opt->first == argc)
+    error = eval_stream(stdin, &block, pool);
+  for (int i = opt->first; error == OK && i < argc; i++) {
+    FILE *in = strcmp(argv[i], "-") ? fopen(argv[i], "r") : stdin;
+    if (in == NULL) {
+      perror(argv[i]);
+      error = ERROR;
+    } else {
+      error = eval_stream(in, &block, pool);
+      if (in != stdin) fclose(in);
+    }
+  }
+  pool_destroy(pool);
+  for (int i = 0; block.lines && i < CLI_BLOCK; i++) free(block.lines[i]);
+  free(block.lines);
+  free(block.values);
+  free(block.kinds);
+  return error;
+}
+
+int main(int argc, char **argv) {
+  cli_options opt = {0};
+  opt.threads = default_threads();
+  opt.precision = P_DOUBLE;
+  opt.timeout_ms = SERVE_TIMEOUT_MS;
+  if (parse_options(argc, argv, &opt) != OK) {
+    fprintf(stderr,
+            "usage: %s [-j threads] [-a] [-p dd] [file ...]\n"
+            "       %s [-j threads] [-l ms] -s socket\n"
+            "       %s [-p dd] -w library [file ...]\n"
+            "       %s [-j threads] [-a] [-p dd] -e expr -c var=file ... "
+            "-o file\n"
+            "       %s [-j threads] [-p dd] -t -e expr ... [-c var=column] "
+            "[file]\n"
+            "       %s -b loans [-o file]\n"
+            "       %s [-j threads] [-a] -d accounts -o file\n",
+            argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+    return 2;
+  }
+  int error = OK;
+  if (opt.socket_path)
+    error = serve(opt.socket_path, opt.threads, opt.timeout_ms);
+  else if (opt.accounts_path)
+    error = eval_accruals(opt.accounts_path, opt.out_path, opt.threads,
+                          opt.pin);
+  else if (opt.loans_path)
+    error = eval_portfolio(opt.loans_path, opt.out_path);
+  else if (opt.library_path)
+    error = run_save(&opt, argc, argv);
+  else if (opt.csv)
+    error = run_csv(&opt, argc, argv);
+  else if (opt.nexprs)
+    error = eval_columns(opt.exprs[0], opt.binds, opt.nbinds, opt.out_path,
+                         opt.threads, opt.pin, opt.precision);
+  else
+    error = run_lines(&opt, argc, argv);
+  return error == OK ? 0 : 1;
+}
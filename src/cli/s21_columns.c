@@ -0,0 +1,192 @@
+/*!
+ * \file s21_columns.h
+ * \brief Вычисление выражения по столбцам из двоичных файлов
+ *
+ * Файлы со столбцами (массивы double в порядке байтов машины) отображаются
+ * в память, выходной файл создаётся нужного размера и тоже отображается.
+ * Пакетный вычислитель читает значения прямо из отображений входных файлов
+ * и пишет результаты прямо в отображение выходного, без промежуточных
+ * копий. Строки делятся на блоки по COLUMNS_CHUNK, которые распределяет
+ * пул потоков; обработанные страницы входных файлов сразу освобождаются,
+ * поэтому размер файлов не ограничен объёмом памяти.
+ */
+#define _DEFAULT_SOURCE
+
+#include "s21_columns.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../lib/s21_datatypes.h"
+#include "../lib/s21_pool.h"
+#include "../lib/s21_program.h"
+
+/*!
+ * \struct column_job
+ * \brief Общее задание потоков: программа, столбцы и флаг ошибки.
+ */
+typedef struct column_job {
+  const program *prog;
+  const double *cols[S21_MAX_VARS];
+  double *out;
+  size_t rows;
+  atomic_int error;
+} column_job;
+
+/*!
+ * \brief Передаёт ядру совет о диапазоне столбца, выровненном по страницам.
+ */
+static void advise_rows(const double *col, size_t len, int advice) {
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t from = (size_t)col & ~(page - 1);
+  madvise((void *)from, (size_t)col - from + len * sizeof(double), advice);
+}
+
+/*!
+ * \brief Вычисляет блоки строк с from по to.
+ */
+static void column_range(void *arg, int from, int to) {
+  column_job *job = arg;
+  for (int chunk = from; chunk < to; chunk++) {
+    size_t start = (size_t)chunk * COLUMNS_CHUNK;
+    size_t len = job->rows - start < COLUMNS_CHUNK ? job->rows - start
+                                                   : COLUMNS_CHUNK;
+    const double *cols[S21_MAX_VARS] = {0};
+    for (int v = 0; v < job->prog->nvars; v++) {
+      cols[v] = job->cols[v] ? job->cols[v] + start : NULL;
+      if (cols[v]) advise_rows(cols[v], len, MADV_WILLNEED);
+    }
+    if (calc_program_batch_vars(job->prog, cols, job->out + start,
+                                (int)len) != OK)
+      atomic_store(&job->error, ERROR);
+    // страницы блока больше не нужны, их можно вытеснить
+    for (int v = 0; v < job->prog->nvars; v++)
+      if (cols[v]) advise_rows(cols[v], len, MADV_DONTNEED);
+  }
+}
+
+/*!
+ * \brief Отображает файл со столбцом в память только для чтения.
+ *
+ * \param path Путь к файлу.
+ * \param rows Указатель для записи числа строк.
+ * \return Адрес отображения, NULL для пустого файла или MAP_FAILED при
+ * ошибке.
+ */
+static void *map_column(const char *path, size_t *rows) {
+  void *map = MAP_FAILED;
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size % sizeof(double) == 0) {
+    *rows = (size_t)st.st_size / sizeof(double);
+    map = *rows ? mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0)
+                : NULL;
+    if (map != MAP_FAILED && map) madvise(map, st.st_size, MADV_SEQUENTIAL);
+  }
+  if (fd >= 0) close(fd);
+  return map;
+}
+
+/*!
+ * \brief Создаёт выходной файл на rows значений и отображает его в память.
+ *
+ * \return Адрес отображения, NULL для пустого столбца или MAP_FAILED.
+ */
+static double *map_output(const char *path, size_t rows) {
+  void *map = MAP_FAILED;
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0 && ftruncate(fd, (off_t)(rows * sizeof(double))) == 0)
+    map = rows ? mmap(NULL, rows * sizeof(double), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0)
+               : NULL;
+  if (fd >= 0) close(fd);
+  return map;
+}
+
+/*!
+ * \brief Вычисляет выражение по столбцам из файлов и записывает результат.
+ *
+ * \param line Выражение.
+ * \param binds Привязки переменных к файлам.
+ * \param nbinds Количество привязок.
+ * \param out_path Путь к выходному файлу.
+ * \param threads Число потоков (0 — по числу процессоров).
+ * \param pin TRUE, чтобы закрепить потоки за процессорами.
+ * \param precision Точность вычисления (P_DOUBLE или P_DDOUBLE).
+ * \return OK или ERROR (сообщение об ошибке выводится в stderr).
+ */
+int eval_columns(const char *line, const column_bind *binds, int nbinds,
+                 const char *out_path, int threads, int pin, int precision) {
+  program prog = {0};
+  if (compile_program_vars(line, &prog) != OK) {
+    fprintf(stderr, "invalid expression: %s\n", line);
+    return ERROR;
+  }
+  prog.precision = precision;
+
+  column_job *job = calloc(1, sizeof(column_job));
+  void *maps[S21_MAX_VARS] = {0};
+  size_t sizes[S21_MAX_VARS] = {0};
+  int error = job ? OK : ERROR;
+  size_t rows = 0;
+  int have_rows = 0;
+  for (int v = 0; error == OK && v < prog.nvars; v++) {
+    const column_bind *b = NULL;
+    for (int i = 0; i < nbinds; i++)
+      if (binds[i].name == prog.vars[v]) b = &binds[i];
+    if (b == NULL && !program_uses_slot(&prog, v)) continue;
+    if (b == NULL) {
+      fprintf(stderr, "variable %c is not bound to a column\n", prog.vars[v]);
+      error = ERROR;
+      continue;
+    }
+    maps[v] = map_column(b->source, &sizes[v]);
+    if (maps[v] == MAP_FAILED) {
+      maps[v] = NULL;
+      fprintf(stderr, "%s: cannot map a column of doubles\n", b->source);
+      error = ERROR;
+    } else if (have_rows && sizes[v] != rows) {
+      fprintf(stderr, "%s: column length differs\n", b->source);
+      error = ERROR;
+    }
+    rows = sizes[v];
+    have_rows = 1;
+    job->cols[v] = maps[v];
+  }
+  // выражение без переменных нечем размножить по строкам
+  if (error == OK && !have_rows) rows = 1;
+
+  double *out = MAP_FAILED;
+  if (error == OK) out = map_output(out_path, rows);
+  if (error == OK && out == MAP_FAILED) {
+    perror(out_path);
+    error = ERROR;
+  }
+  if (error == OK && rows) {
+    job->prog = &prog;
+    job->out = out;
+    job->rows = rows;
+    atomic_init(&job->error, OK);
+    size_t chunks = (rows + COLUMNS_CHUNK - 1) / COLUMNS_CHUNK;
+    if (threads <= 0) threads = default_threads();
+    if ((size_t)threads > chunks) threads = (int)chunks;
+    work_pool *pool = NULL;
+    // без пула блоки вычисляются в вызывающем потоке
+    if (threads > 1) pool_create(threads, pin, &pool);
+    pool_run(pool, (int)chunks, column_range, job);
+    pool_destroy(pool);
+    error = atomic_load(&job->error);
+  }
+
+  if (out != MAP_FAILED && out) munmap(out, rows * sizeof(double));
+  for (int v = 0; v < prog.nvars; v++)
+    if (maps[v]) munmap(maps[v], sizes[v] * sizeof(double));
+  free(job);
+  remove_program(&prog);
+  return error;
+}
@@ -0,0 +1,19 @@
+#ifndef S21_COLUMNS_H
+#define S21_COLUMNS_H
+
+//! Число строк, которые вычисляются за один шаг.
+#define COLUMNS_CHUNK (1 << 20)
+
+/*!
+ * \struct column_bind
+ * \brief Привязка переменной выражения к источнику значений: файлу со
+ * столбцом double или столбцу CSV.
+ */
+typedef struct column_bind {
+  char name;
+  const char *source;
+} column_bind;
+
+int eval_columns(const char *line, const column_bind *binds, int nbinds,
+                 const char *out_path, int threads, int pin, int precision);
+#endif
@@ -0,0 +1,504 @@
+/*!
+ * \file s21_csv.h
+ * \brief Потоковое вычисление выражений по строкам CSV
+ *
+ * Первая строка файла — заголовок. Переменные выражений привязываются к
+ * столбцам по имени (ключ -c x=price), а без явной привязки — к столбцу с
+ * тем же однобуквенным именем. К каждой строке ввода дописываются значения
+ * выходных выражений. Выражение можно назвать: "total = a * x".
+ *
+ * Обработка идёт конвейером из трёх стадий, связанных ограниченными
+ * неблокирующими очередями:
+ * - поток чтения собирает строки в порции по CSV_BATCH и разбирает числа;
+ * - рабочие потоки вычисляют выражения над порцией пакетным вычислителем и
+ *   форматируют выходные строки;
+ * - поток записи выводит порции строго в порядке ввода.
+ * Число порций фиксировано, поэтому память не зависит от размера файла.
+ * Ошибка любой стадии (нехватка памяти, сбой вычисления или записи)
+ * запоминается в общем флаге; чтение после неё прекращается.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "s21_csv.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/s21_datatypes.h"
+#include "../lib/s21_program.h"
+#include "s21_queue.h"
+
+//! Число букв-переменных.
+#define CSV_LETTERS 26
+
+/*!
+ * \struct csv_batch
+ * \brief Порция строк: исходный текст, разобранные значения и вывод.
+ */
+typedef struct csv_batch {
+  size_t seq;
+  int n;
+  char *text;
+  size_t text_len;
+  size_t text_cap;
+  size_t offsets[CSV_BATCH];
+  double vals[CSV_LETTERS][CSV_BATCH];
+  double *res;
+  char *out;
+  size_t out_len;
+  size_t out_cap;
+} csv_batch;
+
+/*!
+ * \struct csv_field
+ * \brief Столбец CSV, к которому привязана переменная.
+ */
+typedef struct csv_field {
+  int index;
+  int letter;
+} csv_field;
+
+/*!
+ * \struct csv_state
+ * \brief Общее состояние конвейера.
+ */
+typedef struct csv_state {
+  FILE *in;
+  FILE *out;
+  program progs[CSV_MAX_EXPRS];
+  int nexprs;
+  csv_field fields[CSV_LETTERS];
+  int nfields;
+  int precision;
+  int workers;
+  ring free_q;
+  ring work_q;
+  ring done_q;
+  csv_batch **pool;
+  int npool;
+  atomic_int error;
+} csv_state;
+
+/*!
+ * \brief Читает одно поле CSV и переходит к следующему.
+ *
+ * Поддерживаются поля в двойных кавычках с удвоенными кавычками внутри.
+ *
+ * \param p Указатель на текущую позицию в строке.
+ * \param buf Буфер для значения поля (обрезается по cap).
+ * \param cap Размер буфера.
+ * \return TRUE, если после поля есть ещё поля, иначе FALSE.
+ */
+static int next_field(const char **p, char *buf, size_t cap) {
+  const char *s = *p;
+  size_t len = 0;
+  int quoted = *s == '"';
+  if (quoted) s++;
+  while (*s && (quoted || *s != ',')) {
+    if (quoted && *s == '"') {
+      if (s[1] != '"') {
+        quoted = 0;
+        s++;
+        continue;
+      }
+      s++;
+    }
+    if (len + 1 < cap) buf[len++] = *s;
+    s++;
+  }
+  buf[len] = '\0';
+  int more = *s == ',';
+  *p = more ? s + 1 : s;
+  return more;
+}
+
+/*!
+ * \brief Разбирает число из поля; пустое или нечисловое поле даёт NaN.
+ */
+static double field_value(const char *field) {
+  char *end = NULL;
+  double value = strtod(field, &end);
+  while (end && isspace((unsigned char)*end)) end++;
+  return end == field || (end && *end) ? NAN : value;
+}
+
+/*!
+ * \brief Добавляет текст в буфер, увеличивая его при необходимости.
+ *
+ * \return OK или ERROR при нехватке памяти.
+ */
+static int append(char **buf, size_t *len, size_t *cap, const char *text,
+                  size_t n) {
+  if (*len + n + 1 > *cap) {
+    size_t grown_cap = (*len + n + 1) * 2;
+    char *grown = realloc(*buf, grown_cap);
+    if (grown == NULL) return ERROR;
+    *buf = grown;
+    *cap = grown_cap;
+  }
+  memcpy(*buf + *len, text, n);
+  *len += n;
+  (*buf)[*len] = '\0';
+  return OK;
+}
+
+/*!
+ * \brief Добавляет строку ввода в порцию и разбирает привязанные столбцы.
+ */
+static int read_row(const csv_state *st, csv_batch *b, const char *line,
+                    size_t len) {
+  size_t offset = b->text_len;
+  if (append(&b->text, &b->text_len, &b->text_cap, line, len + 1) != OK)
+    return ERROR;
+  b->offsets[b->n] = offset;
+  for (int f = 0; f < st->nfields; f++)
+    b->vals[st->fields[f].letter][b->n] = NAN;
+
+  const char *p = line;
+  char field[128];
+  int more = TRUE;
+  for (int index = 0, f = 0; more && f < st->nfields; index++) {
+    more = next_field(&p, field, sizeof(field));
+    for (; f < st->nfields && st->fields[f].index == index; f++)
+      b->vals[st->fields[f].letter][b->n] = field_value(field);
+  }
+  b->n++;
+  return OK;
+}
+
+/*!
+ * \brief Вычисляет выражения над порцией и форматирует выходные строки.
+ *
+ * \return OK или ERROR при сбое вычисления или нехватке памяти.
+ */
+static int process_batch(const csv_state *st, csv_batch *b) {
+  int error = OK;
+  for (int e = 0; e < st->nexprs; e++) {
+    const program *prog = &st->progs[e];
+    const double *cols[S21_MAX_VARS] = {0};
+    for (int v = 0; v < prog->nvars; v++)
+      cols[v] = b->vals[prog->vars[v] - 'a'];
+    if (calc_program_batch_vars(prog, cols, b->res + e * CSV_BATCH, b->n) !=
+        OK)
+      error = ERROR;
+  }
+  const char *format = st->precision == P_DDOUBLE ? ",%.17g" : ",%.15g";
+  b->out_len = 0;
+  for (int i = 0; error == OK && i < b->n; i++) {
+    const char *line = b->text + b->offsets[i];
+    error = append(&b->out, &b->out_len, &b->out_cap, line, strlen(line));
+    for (int e = 0; error == OK && e < st->nexprs; e++) {
+      char num[40];
+      int n = snprintf(num, sizeof(num), format, b->res[e * CSV_BATCH + i]);
+      error = append(&b->out, &b->out_len, &b->out_cap, num, (size_t)n);
+    }
+    if (error == OK) error = append(&b->out, &b->out_len, &b->out_cap, "\n", 1);
+  }
+  return error;
+}
+
+/*!
+ * \brief Рабочий поток: вычисляет порции до метки конца (NULL).
+ */
+static void *csv_worker(void *arg) {
+  csv_state *st = arg;
+  csv_batch *b;
+  while ((b = ring_pop_wait(&st->work_q)) != NULL) {
+    if (process_batch(st, b) != OK) {
+      atomic_store(&st->error, ERROR);
+      b->out_len = 0;
+    }
+    ring_push_wait(&st->done_q, b);
+  }
+  return NULL;
+}
+
+/*!
+ * \brief Поток записи: выводит порции по порядку и возвращает их в пул.
+ *
+ * Порции приходят в произвольном порядке; пришедшие раньше времени ждут в
+ * массиве ready, индекс в котором — номер порции по модулю размера пула.
+ */
+static void *csv_writer(void *arg) {
+  csv_state *st = arg;
+  csv_batch **ready = calloc(st->npool, sizeof(csv_batch *));
+  if (ready == NULL) atomic_store(&st->error, ERROR);
+  size_t next = 0;
+  csv_batch *b;
+  while ((b = ring_pop_wait(&st->done_q)) != NULL) {
+    // без массива порядок не восстановить: порции только возвращаются
+    if (ready == NULL) {
+      ring_push_wait(&st->free_q, b);
+      continue;
+    }
+    ready[b->seq % st->npool] = b;
+    while ((b = ready[next % st->npool]) != NULL && b->seq == next) {
+      if (atomic_load(&st->error) == OK &&
+          fwrite(b->out, 1, b->out_len, st->out) != b->out_len)
+        atomic_store(&st->error, ERROR);
+      ready[next % st->npool] = NULL;
+      next++;
+      ring_push_wait(&st->free_q, b);
+    }
+  }
+  free(ready);
+  return NULL;
+}
+
+/*!
+ * \brief Поток чтения: собирает порции строк и передаёт их рабочим.
+ */
+static void read_batches(csv_state *st) {
+  char *line = NULL;
+  size_t cap = 0;
+  ssize_t len = 0;
+  size_t seq = 0;
+  while (len >= 0 && atomic_load(&st->error) == OK) {
+    csv_batch *b = ring_pop_wait(&st->free_q);
+    b->n = 0;
+    b->text_len = 0;
+    while (b->n < CSV_BATCH && len >= 0 &&
+           (len = getline(&line, &cap, st->in)) >= 0) {
+      while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+        line[--len] = '\0';
+      if (read_row(st, b, line, (size_t)len) != OK) {
+        atomic_store(&st->error, ERROR);
+        len = -1;
+      }
+    }
+    if (b->n > 0) {
+      b->seq = seq++;
+      ring_push_wait(&st->work_q, b);
+    } else {
+      ring_push_wait(&st->free_q, b);
+    }
+  }
+  if (ferror(st->in)) atomic_store(&st->error, ERROR);
+  free(line);
+}
+
+/*!
+ * \brief Выделяет имя выражения вида "имя = выражение".
+ *
+ * \param text Текст выражения.
+ * \param name Буфер для имени (пустой, если имени нет).
+ * \param cap Размер буфера имени.
+ * \return Указатель на само выражение.
+ */
+const char *split_name(const char *text, char *name, size_t cap) {
+  const char *s = text;
+  while (*s == ' ') s++;
+  const char *start = s;
+  while (isalnum((unsigned char)*s) || *s == '_') s++;
+  const char *end = s;
+  while (*s == ' ') s++;
+  name[0] = '\0';
+  if (*s == '=' && end > start && (size_t)(end - start) < cap) {
+    memcpy(name, start, end - start);
+    name[end - start] = '\0';
+    return s + 1;
+  }
+  return text;
+}
+
+/*!
+ * \brief Выводит строку заголовка: исходный заголовок и имена выражений.
+ */
+static void write_header(FILE *out, const char *header,
+                         const char *const *exprs, int nexprs) {
+  fputs(header, out);
+  for (int e = 0; e < nexprs; e++) {
+    char name[64];
+    const char *body = split_name(exprs[e], name, sizeof(name));
+    const char *label = name[0] ? name : body;
+    if (strpbrk(label, ",\"")) {
+      fputs(",\"", out);
+      for (; *label; label++) {
+        if (*label == '"') fputc('"', out);
+        fputc(*label, out);
+      }
+      fputc('"', out);
+    } else {
+      fprintf(out, ",%s", label);
+    }
+  }
+  fputc('\n', out);
+}
+
+/*!
+ * \brief Привязывает переменные выражений к столбцам заголовка.
+ *
+ * \return OK или ERROR, если переменной не нашлось столбца.
+ */
+static int bind_fields(csv_state *st, const char *header,
+                       const column_bind *binds, int nbinds) {
+  int used[CSV_LETTERS] = {0};
+  for (int e = 0; e < st->nexprs; e++)
+    for (int i = 0; i < st->progs[e].size; i++)
+      if (st->progs[e].code[i].type == S_XOPERAND)
+        used[st->progs[e].vars[st->progs[e].code[i].ival] - 'a'] = TRUE;
+
+  int error = OK;
+  for (int letter = 0; letter < CSV_LETTERS; letter++) {
+    if (!used[letter]) continue;
+    char want[2] = {(char)('a' + letter), '\0'};
+    const char *column = want;
+    for (int i = 0; i < nbinds; i++)
+      if (binds[i].name == 'a' + letter) column = binds[i].source;
+    const char *p = header;
+    char field[128];
+    int index = ERROR, more = TRUE;
+    for (int i = 0; more && index == ERROR; i++) {
+      more = next_field(&p, field, sizeof(field));
+      if (!strcmp(field, column)) index = i;
+    }
+    if (index == ERROR) {
+      fprintf(stderr, "no column %s for variable %c\n", column, 'a' + letter);
+      error = ERROR;
+    } else {
+      // столбцы держим по возрастанию номера, чтобы разбирать строку за
+      // один проход
+      int pos = st->nfields++;
+      while (pos > 0 && st->fields[pos - 1].index > index) {
+        st->fields[pos] = st->fields[pos - 1];
+        pos--;
+      }
+      st->fields[pos].index = index;
+      st->fields[pos].letter = letter;
+    }
+  }
+  return error;
+}
+
+/*!
+ * \brief Создаёт пул порций и очереди конвейера.
+ *
+ * \return OK или ERROR при нехватке памяти.
+ */
+static int open_pipeline(csv_state *st, int threads) {
+  st->workers = threads;
+  st->npool = 2 * threads + 2;
+  st->pool = calloc(st->npool, sizeof(csv_batch *));
+  int error = st->pool ? OK : ERROR;
+  size_t capacity = (size_t)(st->npool + threads + 1);
+  if (error == OK &&
+      (ring_init(&st->free_q, capacity) != OK ||
+       ring_init(&st->work_q, capacity) != OK ||
+       ring_init(&st->done_q, capacity) != OK))
+    error = ERROR;
+  for (int i = 0; error == OK && i < st->npool; i++) {
+    st->pool[i] = calloc(1, sizeof(csv_batch));
+    if (st->pool[i])
+      st->pool[i]->res = malloc(sizeof(double) * CSV_BATCH * st->nexprs);
+    if (st->pool[i] == NULL || st->pool[i]->res == NULL)
+      error = ERROR;
+    else
+      ring_push(&st->free_q, st->pool[i]);
+  }
+  return error;
+}
+
+/*!
+ * \brief Освобождает пул порций и очереди конвейера.
+ */
+static void close_pipeline(csv_state *st) {
+  for (int i = 0; st->pool && i < st->npool; i++) {
+    if (st->pool[i] == NULL) continue;
+    free(st->pool[i]->text);
+    free(st->pool[i]->res);
+    free(st->pool[i]->out);
+    free(st->pool[i]);
+  }
+  free(st->pool);
+  ring_free(&st->free_q);
+  ring_free(&st->work_q);
+  ring_free(&st->done_q);
+}
+
+/*!
+ * \brief Вычисляет выражения по строкам CSV.
+ *
+ * \param in Поток ввода CSV с заголовком.
+ * \param out Поток вывода.
+ * \param exprs Выходные выражения (возможно, с именами).
+ * \param nexprs Количество выражений.
+ * \param binds Привязки переменных к именам столбцов.
+ * \param nbinds Количество привязок.
+ * \param threads Число рабочих потоков.
+ * \param precision Точность вычисления.
+ * \return OK или ERROR (сообщение выводится в stderr).
+ */
+int eval_csv(FILE *in, FILE *out, const char *const *exprs, int nexprs,
+             const column_bind *binds, int nbinds, int threads,
+             int precision) {
+  if (nexprs < 1 || nexprs > CSV_MAX_EXPRS || threads < 1) return ERROR;
+  csv_state *st = calloc(1, sizeof(csv_state));
+  if (st == NULL) return ERROR;
+  st->in = in;
+  st->out = out;
+  st->precision = precision;
+  atomic_init(&st->error, OK);
+  int error = OK;
+  for (int e = 0; e < nexprs; e++) {
+    char name[64];
+    const char *body = split_name(exprs[e], name, sizeof(name));
+    if (error == OK && compile_program_vars(body, &st->progs[e]) != OK) {
+      fprintf(stderr, "invalid expression: %s\n", exprs[e]);
+      error = ERROR;
+    }
+    st->progs[e].precision = precision;
+    st->nexprs++;
+  }
+
+  char *header = NULL;
+  size_t cap = 0;
+  ssize_t len = error == OK ? getline(&header, &cap, in) : -1;
+  if (len >= 0) {
+    while (len > 0 && (header[len - 1] == '\n' || header[len - 1] == '\r'))
+      header[--len] = '\0';
+    error = bind_fields(st, header, binds, nbinds);
+    if (error == OK) write_header(out, header, exprs, nexprs);
+  }
+  if (error == OK && len >= 0) error = open_pipeline(st, threads);
+
+  if (error == OK && len >= 0) {
+    pthread_t writer;
+    pthread_t *ids = malloc(sizeof(pthread_t) * threads);
+    int started = 0;
+    int writer_started = ids && pthread_create(&writer, NULL, csv_writer,
+                                               st) == 0;
+    for (int i = 0; writer_started && i < threads; i++)
+      if (pthread_create(&ids[started], NULL, csv_worker, st) == 0) started++;
+    if (started > 0) {
+      read_batches(st);
+    } else {
+      error = ERROR;
+    }
+    for (int i = 0; i < started; i++) ring_push_wait(&st->work_q, NULL);
+    for (int i = 0; i < started; i++) pthread_join(ids[i], NULL);
+    if (writer_started) {
+      ring_push_wait(&st->done_q, NULL);
+      pthread_join(writer, NULL);
+    }
+    free(ids);
+  }
+  if (error == OK && len >= 0) {
+    // запись могла сорваться и в заголовке, и при сбросе буфера
+    if (fflush(out) != 0 || ferror(out)) {
+      fprintf(stderr, "cannot write output\n");
+      error = ERROR;
+    } else if (atomic_load(&st->error) != OK) {
+      fprintf(stderr, "cannot read or evaluate input\n");
+      error = ERROR;
+    }
+  }
+  close_pipeline(st);
+  free(header);
+  for (int e = 0; e < st->nexprs; e++) remove_program(&st->progs[e]);
+  free(st);
+  return error;
+}
@@ -0,0 +1,18 @@
+#ifndef S21_CSV_H
+#define S21_CSV_H
+
+#include <stdio.h>
+
+#include "s21_columns.h"
+
+//! Число строк CSV в одной порции конвейера.
+#define CSV_BATCH 1024
+
+//! Максимальное число выходных выражений.
+#define CSV_MAX_EXPRS 64
+
+const char *split_name(const char *text, char *name, size_t cap);
+int eval_csv(FILE *in, FILE *out, const char *const *exprs, int nexprs,
+             const column_bind *binds, int nbinds, int threads,
+             int precision);
+#endif
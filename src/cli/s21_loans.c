@@ -0,0 +1,170 @@
+/*!
+ * \file s21_loans.h
+ * \brief Расчёт денежных потоков портфеля кредитов из файла
+ *
+ * Портфель читается из двоичного файла записей loan_record (см.
+ * s21_portfolio.h), который отображается в память без копирования, или из
+ * CSV-файла (имя оканчивается на .csv) со строками
+ *
+ *     сумма,ставка,срок,вид[,месяц выдачи]
+ *
+ * где вид — 0 для аннуитетных и 1 для дифференцированных платежей; первая
+ * строка, не начинающаяся с числа, считается заголовком. Итоги по
+ * календарным месяцам выводятся в CSV: месяц, погашенный долг, проценты и
+ * остаток долга.
+ */
+#define _DEFAULT_SOURCE
+
+#include "s21_loans.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../lib/s21_datatypes.h"
+#include "../lib/s21_portfolio.h"
+
+/*!
+ * \brief Отображает двоичный файл портфеля в память только для чтения.
+ *
+ * \param path Путь к файлу.
+ * \param count Указатель для записи числа кредитов.
+ * \param size Указатель для записи размера отображения.
+ * \return Адрес отображения, NULL для пустого файла или MAP_FAILED при
+ * ошибке.
+ */
+static void *map_loans(const char *path, size_t *count, size_t *size) {
+  void *map = MAP_FAILED;
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd >= 0 && fstat(fd, &st) == 0 &&
+      st.st_size % sizeof(loan_record) == 0) {
+    *size = (size_t)st.st_size;
+    *count = *size / sizeof(loan_record);
+    map = *size ? mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0) : NULL;
+    if (map != MAP_FAILED && map) madvise(map, *size, MADV_SEQUENTIAL);
+  }
+  if (fd >= 0) close(fd);
+  return map;
+}
+
+/*!
+ * \brief Разбирает строку CSV-файла портфеля.
+ *
+ * \return OK или ERROR, если строка не начинается с числа или неполна.
+ */
+static int parse_loan(const char *line, loan_record *loan) {
+  char *end = NULL;
+  memset(loan, 0, sizeof(*loan));
+  loan->amount = strtod(line, &end);
+  int error = end != line && *end == ',' ? OK : ERROR;
+  if (error == OK) loan->rate = strtod(end + 1, &end);
+  if (error == OK && *end != ',') error = ERROR;
+  if (error == OK) loan->term = (int)strtol(end + 1, &end, 10);
+  if (error == OK && *end != ',') error = ERROR;
+  if (error == OK) loan->type = (int)strtol(end + 1, &end, 10);
+  if (error == OK && *end == ',') loan->start = (int)strtol(end + 1, &end, 10);
+  if (error == OK && end[strspn(end, " \t\r\n")] != '\0') error = ERROR;
+  return error;
+}
+
+/*!
+ * \brief Читает CSV-файл портфеля в массив записей.
+ *
+ * \param path Путь к файлу.
+ * \param loans Указатель для записи массива; освобождается free.
+ * \param count Указатель для записи числа кредитов.
+ * \return OK или ERROR (сообщение выводится в stderr).
+ */
+static int read_loans_csv(const char *path, loan_record **loans,
+                          size_t *count) {
+  FILE *in = fopen(path, "r");
+  if (in == NULL) {
+    perror(path);
+    return ERROR;
+  }
+  char line[LOANS_MAX_LINE];
+  size_t cap = 0;
+  int error = OK;
+  *loans = NULL;
+  *count = 0;
+  for (int n = 1; error == OK && fgets(line, sizeof(line), in); n++) {
+    if (line[strspn(line, " \t\r\n")] == '\0') continue;
+    if (*count == cap) {
+      cap = cap ? cap * 2 : 4096;
+      loan_record *grown = realloc(*loans, sizeof(loan_record) * cap);
+      if (grown == NULL) error = ERROR;
+      if (grown) *loans = grown;
+    }
+    if (error == OK && parse_loan(line, &(*loans)[*count]) == OK) {
+      (*count)++;
+    } else if (error == OK && !(n == 1 && strchr("+-.0123456789", line[0]) ==
+                                              NULL)) {
+      fprintf(stderr, "%s:%d: invalid loan\n", path, n);
+      error = ERROR;
+    }
+  }
+  fclose(in);
+  return error;
+}
+
+/*!
+ * \brief Выводит итоги портфеля по месяцам в CSV.
+ *
+ * \return OK или ERROR при ошибке записи.
+ */
+static int write_totals(const portfolio_totals *t, FILE *out) {
+  fputs("month,principal,interest,balance\n", out);
+  for (int m = 0; m < t->months; m++)
+    fprintf(out, "%d,%.15g,%.15g,%.15g\n", m, t->principal[m], t->interest[m],
+            t->balance[m]);
+  return ferror(out) ? ERROR : OK;
+}
+
+/*!
+ * \brief Рассчитывает итоги портфеля из файла и записывает их.
+ *
+ * \param path Путь к двоичному или CSV-файлу портфеля.
+ * \param out_path Путь к выходному файлу или NULL для стандартного вывода.
+ * \return OK или ERROR (сообщение об ошибке выводится в stderr).
+ */
+int eval_portfolio(const char *path, const char *out_path) {
+  size_t len = strlen(path), count = 0, size = 0;
+  int csv = len > 4 && !strcmp(path + len - 4, ".csv");
+  loan_record *loans = NULL;
+  void *map = NULL;
+  int error = OK;
+  if (csv) {
+    error = read_loans_csv(path, &loans, &count);
+  } else {
+    map = map_loans(path, &count, &size);
+    if (map == MAP_FAILED) {
+      fprintf(stderr, "%s: cannot map a file of loan records\n", path);
+      map = NULL;
+      error = ERROR;
+    }
+    loans = map;
+  }
+
+  portfolio_totals totals = {0};
+  if (error == OK && portfolio_run(loans, count, &totals) != OK) {
+    fprintf(stderr, "%s: invalid loan or horizon longer than %d months\n",
+            path, PORTFOLIO_MAX_MONTHS);
+    error = ERROR;
+  }
+  FILE *out = stdout;
+  if (error == OK && out_path && (out = fopen(out_path, "w")) == NULL) {
+    perror(out_path);
+    error = ERROR;
+  }
+  if (error == OK) error = write_totals(&totals, out);
+  if (out && out != stdout) fclose(out);
+  portfolio_free(&totals);
+  if (map) munmap(map, size);
+  if (csv) free(loans);
+  return error;
+}
@@ -0,0 +1,8 @@
+#ifndef S21_LOANS_H
+#define S21_LOANS_H
+
+//! Наибольшая длина строки CSV-файла портфеля.
+#define LOANS_MAX_LINE 256
+
+int eval_portfolio(const char *path, const char *out_path);
+#endif
@@ -0,0 +1,134 @@
+/*!
+ * \file s21_queue.h
+ * \brief Ограниченная неблокирующая очередь для конвейеров CLI
+ *
+ * Кольцевой буфер, в котором у каждой ячейки есть номер поколения (схема
+ * Вьюкова). Писатель и читатель захватывают позицию сравнением с обменом и
+ * работают со своей ячейкой независимо, без мьютексов. Ожидающие варианты
+ * операций крутятся с уступкой процессора, пока очередь полна или пуста.
+ */
+#define _DEFAULT_SOURCE
+
+#include "s21_queue.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../lib/s21_datatypes.h"
+
+//! Число попыток с уступкой процессора перед короткой паузой.
+#define RING_SPINS 64
+
+/*!
+ * \brief Создаёт очередь.
+ *
+ * \param q Очередь.
+ * \param capacity Ёмкость, округляется вверх до степени двойки.
+ * \return OK или ERROR при нехватке памяти.
+ */
+int ring_init(ring *q, size_t capacity) {
+  size_t size = 2;
+  while (size < capacity) size *= 2;
+  q->cells = malloc(sizeof(ring_cell) * size);
+  if (q->cells == NULL) return ERROR;
+  q->mask = size - 1;
+  for (size_t i = 0; i < size; i++) atomic_init(&q->cells[i].seq, i);
+  atomic_init(&q->head, 0);
+  atomic_init(&q->tail, 0);
+  return OK;
+}
+
+/*!
+ * \brief Освобождает память очереди.
+ */
+void ring_free(ring *q) {
+  free(q->cells);
+  q->cells = NULL;
+}
+
+/*!
+ * \brief Добавляет элемент в очередь.
+ *
+ * \return OK или ERROR, если очередь полна.
+ */
+int ring_push(ring *q, void *item) {
+  size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+  while (1) {
+    ring_cell *cell = &q->cells[pos & q->mask];
+    size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+    long diff = (long)(seq - pos);
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        cell->item = item;
+        atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+        return OK;
+      }
+    } else if (diff < 0) {
+      return ERROR;
+    } else {
+      pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    }
+  }
+}
+
+/*!
+ * \brief Извлекает элемент из очереди.
+ *
+ * \return OK или ERROR, если очередь пуста.
+ */
+int ring_pop(ring *q, void **item) {
+  size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+  while (1) {
+    ring_cell *cell = &q->cells[pos & q->mask];
+    size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+    long diff = (long)(seq - (pos + 1));
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        *item = cell->item;
+        atomic_store_explicit(&cell->seq, pos + q->mask + 1,
+                              memory_order_release);
+        return OK;
+      }
+    } else if (diff < 0) {
+      return ERROR;
+    } else {
+      pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+    }
+  }
+}
+
+/*!
+ * \brief Ждёт, пока поток сможет продолжить: сначала уступает процессор,
+ * потом спит по 50 мкс.
+ */
+static void ring_backoff(int *spins) {
+  if (++(*spins) < RING_SPINS) {
+    sched_yield();
+  } else {
+    struct timespec pause = {0, 50000};
+    nanosleep(&pause, NULL);
+  }
+}
+
+/*!
+ * \brief Добавляет элемент, дожидаясь места в очереди.
+ */
+void ring_push_wait(ring *q, void *item) {
+  int spins = 0;
+  while (ring_push(q, item) != OK) ring_backoff(&spins);
+}
+
+/*!
+ * \brief Извлекает элемент, дожидаясь его появления в очереди.
+ */
+void *ring_pop_wait(ring *q) {
+  void *item = NULL;
+  int spins = 0;
+  while (ring_pop(q, &item) != OK) ring_backoff(&spins);
+  return item;
+}
@@ -0,0 +1,34 @@
+#ifndef S21_QUEUE_H
+#define S21_QUEUE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+/*!
+ * \struct ring_cell
+ * \brief Ячейка кольцевой очереди с номером поколения.
+ */
+typedef struct ring_cell {
+  atomic_size_t seq;
+  void *item;
+} ring_cell;
+
+/*!
+ * \struct ring
+ * \brief Ограниченная неблокирующая очередь указателей для нескольких
+ * писателей и нескольких читателей.
+ */
+typedef struct ring {
+  ring_cell *cells;
+  size_t mask;
+  _Alignas(64) atomic_size_t head;
+  _Alignas(64) atomic_size_t tail;
+} ring;
+
+int ring_init(ring *q, size_t capacity);
+void ring_free(ring *q);
+int ring_push(ring *q, void *item);
+int ring_pop(ring *q, void **item);
+void ring_push_wait(ring *q, void *item);
+void *ring_pop_wait(ring *q);
+#endif
@@ -0,0 +1,981 @@
+/*!
+ * \file s21_serve.h
+ * \brief Сервис вычислений через Unix-сокет
+ *
+ * Один поток ввода-вывода принимает соединения и читает сообщения через
+ * epoll, готовые запросы передаются в очередь фиксированного пула рабочих
+ * потоков. Скомпилированные выражения хранятся в общем кэше сервера и
+ * доступны по дескриптору из любого соединения; одинаковые выражения
+ * компилируются один раз. Ссылки на выражения принадлежат соединениям,
+ * которые их получили: освободить можно только свою ссылку, а оставшиеся
+ * освобождаются при закрытии соединения. Ответы рабочие потоки отправляют
+ * сами, а остаток, не поместившийся в сокет, дописывает поток
+ * ввода-вывода.
+ */
+#define _GNU_SOURCE
+
+#include "s21_serve.h"
+
+#include <stdio.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../lib/s21_budget.h"
+#include "../lib/s21_datatypes.h"
+#include "../lib/s21_program.h"
+
+//! Число корзин хэш-таблицы кэша выражений.
+#define SERVE_BUCKETS 4096
+
+//! Максимальное число выражений в кэше.
+#define SERVE_MAX_PROGRAMS 65536
+
+//! Размер блока чтения из сокета.
+#define SERVE_READ 65536
+
+/*!
+ * \struct cache_entry
+ * \brief Скомпилированное выражение в кэше сервера.
+ *
+ * Дескриптор выражения — номер записи в младших 16 битах и поколение записи
+ * в старших, поэтому дескриптор освобождённого выражения не попадёт в
+ * запись, занятую позже другим выражением.
+ */
+typedef struct cache_entry {
+  program prog;
+  char *text;
+  uint32_t hash;
+  uint32_t generation;
+  int refs;
+  int next;
+} cache_entry;
+
+/*!
+ * \struct program_cache
+ * \brief Кэш выражений: записи, хэш-таблица по тексту и список свободных.
+ *
+ * Записи добавляются и удаляются под блокировкой записи. Счётчик ссылок
+ * записи увеличивается и под блокировкой чтения, поэтому читается
+ * атомарно.
+ */
+typedef struct program_cache {
+  pthread_rwlock_t lock;
+  cache_entry *entries;
+  int size;
+  int capacity;
+  int free_head;
+  int buckets[SERVE_BUCKETS];
+} program_cache;
+
+/*!
+ * \struct conn
+ * \brief Соединение с клиентом.
+ *
+ * Входной буфер использует только поток ввода-вывода, выходной — под
+ * мьютексом соединения. Соединение закрывает поток ввода-вывода, когда в
+ * нём не осталось запросов в обработке. Флаг cancel дублирует broken для
+ * рабочих потоков и читается без мьютекса. В handles — дескрипторы,
+ * полученные соединением, по одному на каждую ссылку в кэше; они тоже
+ * защищены мьютексом. Пока у соединения слишком много запросов в работе
+ * или неотправленных ответов, флаг paused останавливает чтение из сокета.
+ */
+typedef struct conn {
+  int fd;
+  pthread_mutex_t lock;
+  char *in;
+  size_t in_len;
+  size_t in_cap;
+  char *out;
+  size_t out_len;
+  size_t out_cap;
+  size_t out_sent;
+  int pending;
+  size_t pending_bytes;
+  int paused;
+  int eof;
+  int broken;
+  int cancel;
+  uint32_t *handles;
+  int nhandles;
+  int handles_cap;
+  struct conn *prew;
+  struct conn *next;
+} conn;
+
+/*!
+ * \struct job
+ * \brief Запрос в очереди рабочих потоков.
+ */
+typedef struct job {
+  conn *c;
+  serve_frame head;
+  char *data;
+  struct job *next;
+} job;
+
+/*!
+ * \struct server
+ * \brief Состояние сервиса.
+ */
+typedef struct server {
+  int epfd;
+  int listen_fd;
+  int wake_fd;
+  program_cache cache;
+  pthread_mutex_t queue_lock;
+  pthread_cond_t queue_cond;
+  job *head;
+  job *tail;
+  int stopping;
+  conn *conns;
+  long long timeout_ms;
+} server;
+
+//! Флаг остановки по сигналу.
+static volatile sig_atomic_t stop_requested = 0;
+
+/*!
+ * \brief Обработчик SIGINT и SIGTERM: просит сервис остановиться.
+ */
+static void on_signal(int sig) {
+  (void)sig;
+  stop_requested = 1;
+}
+
+/*!
+ * \brief Хэш FNV-1a текста выражения вместе с точностью.
+ */
+static uint32_t text_hash(const char *text, int precision) {
+  uint32_t h = 2166136261u ^ (uint32_t)precision;
+  for (; *text; text++) h = (h ^ (unsigned char)*text) * 16777619u;
+  return h;
+}
+
+/*!
+ * \brief Находит запись кэша по дескриптору.
+ *
+ * Вызывается под блокировкой кэша.
+ *
+ * \return Указатель на запись или NULL для неверного дескриптора.
+ */
+static cache_entry *cache_find(program_cache *cache, uint32_t handle) {
+  int index = (int)(handle & 0xFFFF);
+  cache_entry *e = NULL;
+  if (index < cache->size &&
+      __atomic_load_n(&cache->entries[index].refs, __ATOMIC_RELAXED) > 0 &&
+      cache->entries[index].generation == handle >> 16)
+    e = &cache->entries[index];
+  return e;
+}
+
+/*!
+ * \brief Находит запись кэша по тексту выражения и точности.
+ *
+ * Вызывается под блокировкой кэша.
+ *
+ * \return Номер записи или ERROR, если выражения в кэше нет.
+ */
+static int cache_lookup(const program_cache *cache, const char *text,
+                        int precision, uint32_t hash) {
+  int index = cache->buckets[hash % SERVE_BUCKETS];
+  while (index != ERROR &&
+         (cache->entries[index].hash != hash ||
+          cache->entries[index].prog.precision != precision ||
+          strcmp(cache->entries[index].text, text)))
+    index = cache->entries[index].next;
+  return index;
+}
+
+/*!
+ * \brief Добавляет скомпилированное выражение в кэш без ссылок.
+ *
+ * Вызывается под блокировкой записи кэша. При успехе программа и текст
+ * переходят во владение кэша.
+ *
+ * \return Номер записи или ERROR при переполнении кэша.
+ */
+static int cache_insert(program_cache *cache, const program *prog,
+                        char *text, uint32_t hash) {
+  if (cache->free_head == ERROR && cache->size == cache->capacity) {
+    int capacity = cache->capacity ? cache->capacity * 2 : 64;
+    cache_entry *grown = NULL;
+    if (capacity <= SERVE_MAX_PROGRAMS)
+      grown = realloc(cache->entries, sizeof(cache_entry) * capacity);
+    if (grown == NULL) return ERROR;
+    cache->entries = grown;
+    cache->capacity = capacity;
+  }
+  int index;
+  if (cache->free_head != ERROR) {
+    index = cache->free_head;
+    cache->free_head = cache->entries[index].next;
+  } else {
+    index = cache->size++;
+    cache->entries[index].generation = 0;
+  }
+  cache_entry *e = &cache->entries[index];
+  int bucket = (int)(hash % SERVE_BUCKETS);
+  e->prog = *prog;
+  e->text = text;
+  e->hash = hash;
+  e->generation = (e->generation + 1) & 0xFFFF;
+  e->refs = 0;
+  e->next = cache->buckets[bucket];
+  cache->buckets[bucket] = index;
+  return index;
+}
+
+/*!
+ * \brief Возвращает дескриптор выражения, компилируя его при первом запросе.
+ *
+ * Выражение ищется под блокировкой чтения, поэтому повторные запросы не
+ * ждут вычислений. Новое выражение компилируется без блокировки и
+ * добавляется под блокировкой записи; если другой поток успел добавить
+ * то же выражение, своя копия отбрасывается.
+ *
+ * \param cache Кэш выражений.
+ * \param text Текст выражения.
+ * \param precision Точность вычисления.
+ * \param handle Указатель для записи дескриптора.
+ * \return OK, ERROR при ошибке компиляции или переполнении кэша или
+ * LIMITED при превышении лимитов компиляции.
+ */
+static int cache_acquire(program_cache *cache, const char *text,
+                         int precision, uint32_t *handle) {
+  uint32_t hash = text_hash(text, precision);
+  pthread_rwlock_rdlock(&cache->lock);
+  int index = cache_lookup(cache, text, precision, hash);
+  if (index != ERROR) {
+    // запись удаляется только под блокировкой записи, поэтому ссылку
+    // можно добавить под блокировкой чтения
+    cache_entry *e = &cache->entries[index];
+    __atomic_add_fetch(&e->refs, 1, __ATOMIC_RELAXED);
+    *handle = (uint32_t)index | (e->generation << 16);
+  }
+  pthread_rwlock_unlock(&cache->lock);
+  if (index != ERROR) return OK;
+
+  program prog = {0};
+  int error = compile_program_vars(text, &prog);
+  prog.precision = precision;
+  char *copy = error == OK ? strdup(text) : NULL;
+  if (error == OK && copy == NULL) error = ERROR;
+  int inserted = FALSE;
+  if (error == OK) {
+    pthread_rwlock_wrlock(&cache->lock);
+    index = cache_lookup(cache, text, precision, hash);
+    if (index == ERROR) {
+      index = cache_insert(cache, &prog, copy, hash);
+      inserted = index != ERROR;
+    }
+    if (index == ERROR) {
+      error = ERROR;
+    } else {
+      cache->entries[index].refs++;
+      *handle = (uint32_t)index | (cache->entries[index].generation << 16);
+    }
+    pthread_rwlock_unlock(&cache->lock);
+  }
+  if (!inserted) {
+    remove_program(&prog);
+    free(copy);
+  }
+  return error;
+}
+
+/*!
+ * \brief Освобождает одну ссылку на выражение; последняя удаляет его.
+ *
+ * \return OK или ERROR для неверного дескриптора.
+ */
+static int cache_release(program_cache *cache, uint32_t handle) {
+  int error = ERROR;
+  pthread_rwlock_wrlock(&cache->lock);
+  cache_entry *e = cache_find(cache, handle);
+  if (e) {
+    error = OK;
+    if (--e->refs == 0) {
+      int index = (int)(e - cache->entries);
+      int *link = &cache->buckets[e->hash % SERVE_BUCKETS];
+      while (*link != index) link = &cache->entries[*link].next;
+      *link = e->next;
+      remove_program(&e->prog);
+      free(e->text);
+      e->next = cache->free_head;
+      cache->free_head = index;
+    }
+  }
+  pthread_rwlock_unlock(&cache->lock);
+  return error;
+}
+
+/*!
+ * \brief Запоминает дескриптор, полученный соединением.
+ *
+ * Вызывается под мьютексом соединения.
+ *
+ * \return OK или ERROR при нехватке памяти.
+ */
+static int conn_add_handle(conn *c, uint32_t handle) {
+  if (c->nhandles == c->handles_cap) {
+    int cap = c->handles_cap ? c->handles_cap * 2 : 16;
+    uint32_t *grown = realloc(c->handles, sizeof(uint32_t) * cap);
+    if (grown == NULL) return ERROR;
+    c->handles = grown;
+    c->handles_cap = cap;
+  }
+  c->handles[c->nhandles++] = handle;
+  return OK;
+}
+
+/*!
+ * \brief Забывает одну ссылку соединения на дескриптор.
+ *
+ * Вызывается под мьютексом соединения.
+ *
+ * \return OK или ERROR, если у соединения нет ссылки на этот дескриптор.
+ */
+static int conn_drop_handle(conn *c, uint32_t handle) {
+  int error = ERROR;
+  for (int i = 0; error == ERROR && i < c->nhandles; i++) {
+    if (c->handles[i] == handle) {
+      c->handles[i] = c->handles[--c->nhandles];
+      error = OK;
+    }
+  }
+  return error;
+}
+
+/*!
+ * \brief Проверяет, исчерпало ли соединение свои лимиты.
+ *
+ * Вызывается под мьютексом соединения.
+ *
+ * \param c Соединение.
+ * \param length Размер данных следующего запроса.
+ * \return TRUE, если запрос нужно отложить до отправки ответов.
+ */
+static int conn_full(const conn *c, size_t length) {
+  // одиночный запрос принимается всегда, иначе большое сообщение не
+  // прошло бы никогда
+  return c->pending >= SERVE_MAX_PENDING ||
+         (c->pending && c->pending_bytes + length > SERVE_MAX_PENDING_BYTES) ||
+         c->out_len - c->out_sent > SERVE_MAX_PENDING_BYTES;
+}
+
+/*!
+ * \brief Пересчитывает события epoll соединения по его состоянию.
+ *
+ * Вызывается под мьютексом соединения.
+ */
+static void conn_watch(server *srv, conn *c) {
+  // ответ уже некуда отправить: вычисления соединения можно прервать
+  if (c->broken) __atomic_store_n(&c->cancel, 1, __ATOMIC_RELAXED);
+  struct epoll_event ev = {0};
+  ev.events = (c->eof || c->broken || c->paused ? 0 : EPOLLIN) |
+              (c->out_sent < c->out_len && !c->broken ? EPOLLOUT : 0);
+  ev.data.ptr = c;
+  epoll_ctl(srv->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+/*!
+ * \brief Отправляет накопленный ответ, пока сокет его принимает.
+ *
+ * Вызывается под мьютексом соединения.
+ */
+static void conn_flush(conn *c) {
+  while (!c->broken && c->out_sent < c->out_len) {
+    ssize_t sent = send(c->fd, c->out + c->out_sent, c->out_len - c->out_sent,
+                        MSG_NOSIGNAL);
+    if (sent > 0) {
+      c->out_sent += (size_t)sent;
+    } else if (sent < 0 && errno == EINTR) {
+      continue;
+    } else {
+      if (sent == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        c->broken = 1;
+      break;
+    }
+  }
+  if (c->out_sent == c->out_len) c->out_sent = c->out_len = 0;
+}
+
+/*!
+ * \brief Добавляет ответ в выходной буфер соединения и отправляет его.
+ *
+ * \param srv Сервис.
+ * \param c Соединение.
+ * \param head Заголовок ответа.
+ * \param data Данные ответа.
+ * \param length Размер данных запроса, на который дан ответ.
+ */
+static void conn_reply(server *srv, conn *c, serve_frame head,
+                       const void *data, size_t length) {
+  pthread_mutex_lock(&c->lock);
+  size_t need = c->out_len + sizeof(head) + head.length;
+  if (!c->broken && need > c->out_cap) {
+    char *grown = realloc(c->out, need);
+    if (grown) {
+      c->out = grown;
+      c->out_cap = need;
+    } else {
+      c->broken = 1;
+    }
+  }
+  if (!c->broken) {
+    memcpy(c->out + c->out_len, &head, sizeof(head));
+    if (head.length) memcpy(c->out + c->out_len + sizeof(head), data,
+                            head.length);
+    c->out_len = need;
+    conn_flush(c);
+  }
+  c->pending--;
+  c->pending_bytes -= length;
+  conn_watch(srv, c);
+  int done = (c->pending == 0 && (c->eof || c->broken)) ||
+             (c->paused && !conn_full(c, 0));
+  pthread_mutex_unlock(&c->lock);
+  // соединение закрывает или снова читает поток ввода-вывода, его нужно
+  // разбудить
+  if (done) {
+    uint64_t one = 1;
+    ssize_t ignored = write(srv->wake_fd, &one, sizeof(one));
+    (void)ignored;
+  }
+}
+
+/*!
+ * \brief Выполняет SERVE_COMPILE.
+ *
+ * \return Размер данных ответа, ERROR или LIMITED.
+ */
+static int do_compile(server *srv, const job *j, char *reply) {
+  int result = ERROR;
+  char *text = malloc(j->head.length + 1);
+  if (text) {
+    memcpy(text, j->data, j->head.length);
+    text[j->head.length] = '\0';
+    int precision = j->head.flags & SERVE_DDOUBLE ? P_DDOUBLE : P_DOUBLE;
+    uint32_t handle = 0;
+    int status = cache_acquire(&srv->cache, text, precision, &handle);
+    if (status == LIMITED) result = LIMITED;
+    if (status == OK) {
+      pthread_mutex_lock(&j->c->lock);
+      status = conn_add_handle(j->c, handle);
+      pthread_mutex_unlock(&j->c->lock);
+      if (status != OK) cache_release(&srv->cache, handle);
+    }
+    if (status == OK) {
+      pthread_rwlock_rdlock(&srv->cache.lock);
+      const cache_entry *e = cache_find(&srv->cache, handle);
+      uint32_t nvars = e ? (uint32_t)e->prog.nvars : 0;
+      memcpy(reply, &handle, 4);
+      memcpy(reply + 4, &nvars, 4);
+      if (e) memcpy(reply + 8, e->prog.vars, nvars);
+      pthread_rwlock_unlock(&srv->cache.lock);
+      result = (int)(8 + nvars);
+    }
+    free(text);
+  }
+  return result;
+}
+
+/*!
+ * \brief Выполняет SERVE_FREE: освобождает ссылку соединения на выражение.
+ *
+ * \return 0 или ERROR для неверного дескриптора или чужой ссылки.
+ */
+static int do_free(server *srv, const job *j) {
+  uint32_t handle = 0;
+  if (j->head.length != 4) return ERROR;
+  memcpy(&handle, j->data, 4);
+  pthread_mutex_lock(&j->c->lock);
+  int error = conn_drop_handle(j->c, handle);
+  pthread_mutex_unlock(&j->c->lock);
+  if (error == OK) error = cache_release(&srv->cache, handle);
+  return error == OK ? 0 : ERROR;
+}
+
+/*!
+ * \brief Выполняет SERVE_EVAL.
+ *
+ * Столбцы берутся прямо из буфера запроса, результат пишется в буфер
+ * ответа. Под блокировкой чтения кэша запрос только берёт ссылку на
+ * выражение и копирует его описание; вычисление идёт без блокировки, и
+ * ожидающие компиляция или освобождение не останавливают другие запросы.
+ *
+ * \param srv Сервис.
+ * \param j Запрос.
+ * \param reply Указатель для записи буфера ответа.
+ * \return Размер данных ответа, ERROR или LIMITED.
+ */
+static int do_eval(server *srv, const job *j, double **reply) {
+  uint32_t fields[4] = {0};
+  if (j->head.length < sizeof(fields)) return ERROR;
+  memcpy(fields, j->data, sizeof(fields));
+  uint64_t rows = fields[1], ncols = fields[2];
+  // хотя бы один столбец: размер ответа не больше размера запроса
+  if (ncols == 0 || ncols > S21_MAX_VARS ||
+      rows > SERVE_MAX_FRAME / sizeof(double) ||
+      j->head.length != sizeof(fields) + ncols * rows * sizeof(double))
+    return ERROR;
+
+  int result = ERROR;
+  program prog;
+  pthread_rwlock_rdlock(&srv->cache.lock);
+  cache_entry *e = cache_find(&srv->cache, fields[0]);
+  // массив записей может переместиться, поэтому берётся копия описания;
+  // код и константы живут, пока держится ссылка
+  if (e) {
+    __atomic_add_fetch(&e->refs, 1, __ATOMIC_RELAXED);
+    prog = e->prog;
+  }
+  pthread_rwlock_unlock(&srv->cache.lock);
+  if (e == NULL) return ERROR;
+
+  *reply = malloc(sizeof(double) * (rows ? rows : 1));
+  if (*reply) {
+    const double *cols[S21_MAX_VARS] = {0};
+    // данные запроса выровнены: буфер выделен malloc, заголовок 16 байт
+    const double *base = (const double *)(j->data + sizeof(fields));
+    for (uint64_t v = 0; v < ncols && v < (uint64_t)prog.nvars; v++)
+      cols[v] = base + v * rows;
+    int status = calc_program_batch_vars(&prog, cols, *reply, (int)rows);
+    if (status == OK) result = (int)(rows * sizeof(double));
+    if (status == LIMITED) result = LIMITED;
+  }
+  cache_release(&srv->cache, fields[0]);
+  return result;
+}
+
+/*!
+ * \brief Выполняет один запрос и отправляет ответ.
+ *
+ * Запрос выполняется в собственном бюджете с лимитами сервиса; разрыв
+ * соединения прерывает его.
+ */
+static void run_job(server *srv, job *j) {
+  serve_frame head = j->head;
+  char small[8 + S21_MAX_VARS];
+  double *rows = NULL;
+  const void *data = small;
+  int length = ERROR;
+  eval_limits limits = {SERVE_MAX_TOKENS, SERVE_MAX_DEPTH, SERVE_MAX_OPS,
+                        srv->timeout_ms, &j->c->cancel};
+  budget *b = NULL;
+  budget_create(&limits, &b);
+  budget *prev = budget_enter(b);
+  if (b == NULL) {
+    length = ERROR;
+  } else if (head.op == SERVE_COMPILE) {
+    length = do_compile(srv, j, small);
+  } else if (head.op == SERVE_EVAL) {
+    length = do_eval(srv, j, &rows);
+    data = rows;
+  } else if (head.op == SERVE_FREE) {
+    length = do_free(srv, j);
+  }
+  budget_enter(prev);
+  budget_destroy(b);
+  head.status = length == LIMITED ? SERVE_STATUS_LIMIT
+                : length < 0      ? SERVE_STATUS_ERROR
+                                  : SERVE_STATUS_OK;
+  head.length = length < 0 ? 0 : (uint32_t)length;
+  conn_reply(srv, j->c, head, data, j->head.length);
+  free(rows);
+}
+
+/*!
+ * \brief Рабочий поток: берёт запросы из очереди, пока сервис работает.
+ */
+static void *serve_worker(void *arg) {
+  server *srv = arg;
+  while (1) {
+    pthread_mutex_lock(&srv->queue_lock);
+    while (srv->head == NULL && !srv->stopping)
+      pthread_cond_wait(&srv->queue_cond, &srv->queue_lock);
+    job *j = srv->head;
+    if (j) {
+      srv->head = j->next;
+      if (srv->head == NULL) srv->tail = NULL;
+    }
+    pthread_mutex_unlock(&srv->queue_lock);
+    if (j == NULL) break;
+    run_job(srv, j);
+    free(j->data);
+    free(j);
+  }
+  return NULL;
+}
+
+/*!
+ * \brief Ставит запрос в очередь рабочих потоков.
+ */
+static void push_job(server *srv, job *j) {
+  pthread_mutex_lock(&srv->queue_lock);
+  if (srv->tail)
+    srv->tail->next = j;
+  else
+    srv->head = j;
+  srv->tail = j;
+  pthread_cond_signal(&srv->queue_cond);
+  pthread_mutex_unlock(&srv->queue_lock);
+}
+
+/*!
+ * \brief Выделяет из входного буфера соединения все полные сообщения.
+ *
+ * Когда соединение исчерпало лимиты, оставшиеся сообщения ждут во входном
+ * буфере, а чтение из сокета приостанавливается.
+ *
+ * \return OK или ERROR при нарушении протокола.
+ */
+static int take_frames(server *srv, conn *c) {
+  int error = OK;
+  size_t pos = 0;
+  serve_frame head;
+  while (error == OK && !c->paused && c->in_len - pos >= sizeof(head)) {
+    memcpy(&head, c->in + pos, sizeof(head));
+    if (head.length > SERVE_MAX_FRAME) {
+      error = ERROR;
+    } else if (c->in_len - pos < sizeof(head) + head.length) {
+      break;
+    } else {
+      pthread_mutex_lock(&c->lock);
+      if (conn_full(c, head.length)) {
+        c->paused = 1;
+        conn_watch(srv, c);
+      }
+      pthread_mutex_unlock(&c->lock);
+      if (c->paused) break;
+      job *j = calloc(1, sizeof(job));
+      if (j) j->data = malloc(head.length ? head.length : 1);
+      if (j == NULL || j->data == NULL) {
+        if (j) free(j);
+        error = ERROR;
+      } else {
+        j->c = c;
+        j->head = head;
+        memcpy(j->data, c->in + pos + sizeof(head), head.length);
+        pos += sizeof(head) + head.length;
+        pthread_mutex_lock(&c->lock);
+        c->pending++;
+        c->pending_bytes += head.length;
+        pthread_mutex_unlock(&c->lock);
+        push_job(srv, j);
+      }
+    }
+  }
+  memmove(c->in, c->in + pos, c->in_len - pos);
+  c->in_len -= pos;
+  return error;
+}
+
+/*!
+ * \brief Читает всё доступное из сокета соединения.
+ */
+static void conn_read(server *srv, conn *c) {
+  int stop = 0;
+  while (!stop && !c->paused) {
+    if (c->in_cap - c->in_len < SERVE_READ) {
+      char *grown = realloc(c->in, c->in_cap + SERVE_READ);
+      if (grown == NULL) break;
+      c->in = grown;
+      c->in_cap += SERVE_READ;
+    }
+    ssize_t got = recv(c->fd, c->in + c->in_len, c->in_cap - c->in_len, 0);
+    if (got > 0) {
+      c->in_len += (size_t)got;
+      if (take_frames(srv, c) == ERROR) {
+        pthread_mutex_lock(&c->lock);
+        c->broken = 1;
+        conn_watch(srv, c);
+        pthread_mutex_unlock(&c->lock);
+        stop = 1;
+      }
+    } else if (got < 0 && errno == EINTR) {
+      continue;
+    } else {
+      if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        pthread_mutex_lock(&c->lock);
+        if (got == 0)
+          c->eof = 1;
+        else
+          c->broken = 1;
+        conn_watch(srv, c);
+        pthread_mutex_unlock(&c->lock);
+      }
+      stop = 1;
+    }
+  }
+}
+
+/*!
+ * \brief Принимает новые соединения.
+ */
+static void accept_all(server *srv) {
+  int fd;
+  while ((fd = accept4(srv->listen_fd, NULL, NULL,
+                       SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+    conn *c = calloc(1, sizeof(conn));
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN;
+    ev.data.ptr = c;
+    if (c == NULL || epoll_ctl(srv->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      free(c);
+      close(fd);
+    } else {
+      c->fd = fd;
+      pthread_mutex_init(&c->lock, NULL);
+      c->next = srv->conns;
+      if (srv->conns) srv->conns->prew = c;
+      srv->conns = c;
+    }
+  }
+}
+
+/*!
+ * \brief Возобновляет чтение соединений, ответы которых уже отправлены.
+ *
+ * Сначала разбираются сообщения, отложенные во входном буфере.
+ */
+static void resume_conns(server *srv) {
+  for (conn *c = srv->conns; c; c = c->next) {
+    pthread_mutex_lock(&c->lock);
+    int resume = c->paused && !c->broken && !conn_full(c, 0);
+    if (resume) {
+      c->paused = 0;
+      conn_watch(srv, c);
+    }
+    pthread_mutex_unlock(&c->lock);
+    if (resume && take_frames(srv, c) == ERROR) {
+      pthread_mutex_lock(&c->lock);
+      c->broken = 1;
+      conn_watch(srv, c);
+      pthread_mutex_unlock(&c->lock);
+    }
+  }
+}
+
+/*!
+ * \brief Закрывает соединения, которые больше не нужны.
+ *
+ * Соединение закрывается после ошибки или после конца ввода от клиента,
+ * когда все его запросы обработаны и ответы отправлены. Ссылки на
+ * выражения, которые клиент не освободил, освобождаются.
+ */
+static void sweep_conns(server *srv) {
+  conn *c = srv->conns;
+  while (c) {
+    conn *next = c->next;
+    pthread_mutex_lock(&c->lock);
+    int done = c->pending == 0 &&
+               (c->broken || (c->eof && c->out_sent == c->out_len));
+    pthread_mutex_unlock(&c->lock);
+    if (done) {
+      epoll_ctl(srv->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+      close(c->fd);
+      if (c->prew)
+        c->prew->next = c->next;
+      else
+        srv->conns = c->next;
+      if (c->next) c->next->prew = c->prew;
+      for (int i = 0; i < c->nhandles; i++)
+        cache_release(&srv->cache, c->handles[i]);
+      free(c->handles);
+      pthread_mutex_destroy(&c->lock);
+      free(c->in);
+      free(c->out);
+      free(c);
+    }
+    c = next;
+  }
+}
+
+/*!
+ * \brief Удаляет файл сокета, если по пути path лежит именно сокет.
+ *
+ * Другие файлы не трогает: неверный путь в ключе -s не должен стоить
+ * пользователю данных.
+ *
+ * \return OK, если по пути нет файла или сокет удалён, иначе ERROR.
+ */
+static int unlink_socket(const char *path) {
+  struct stat st;
+  int error = OK;
+  if (lstat(path, &st) != 0) {
+    if (errno != ENOENT) error = ERROR;
+  } else if (!S_ISSOCK(st.st_mode)) {
+    fprintf(stderr, "%s: exists and is not a socket\n", path);
+    error = ERROR;
+  } else if (unlink(path) != 0) {
+    error = ERROR;
+  }
+  return error;
+}
+
+/*!
+ * \brief Открывает слушающий сокет по пути path.
+ *
+ * \return Дескриптор сокета или ERROR.
+ */
+static int open_socket(const char *path) {
+  struct sockaddr_un addr = {0};
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) return ERROR;
+  strcpy(addr.sun_path, path);
+  int fd = ERROR;
+  if (unlink_socket(path) == OK)
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd >= 0) {
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, SOMAXCONN) != 0) {
+      close(fd);
+      fd = ERROR;
+    }
+  }
+  return fd < 0 ? ERROR : fd;
+}
+
+/*!
+ * \brief Цикл ввода-вывода: события сокетов до сигнала остановки.
+ */
+static void event_loop(server *srv) {
+  struct epoll_event events[64];
+  while (!stop_requested) {
+    int n = epoll_wait(srv->epfd, events, 64, 500);
+    for (int i = 0; i < n; i++) {
+      conn *c = events[i].data.ptr;
+      if (c == NULL) {
+        accept_all(srv);
+      } else if (c == (conn *)srv) {
+        uint64_t count = 0;
+        ssize_t ignored = read(srv->wake_fd, &count, sizeof(count));
+        (void)ignored;
+      } else {
+        // после конца ввода EPOLLHUP приходит постоянно, читать уже нечего
+        if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !c->eof)
+          conn_read(srv, c);
+        // клиент закрыл сокет целиком: ответы некому получить, а запросы
+        // соединения можно прервать
+        if ((events[i].events & EPOLLHUP) && !c->broken) {
+          pthread_mutex_lock(&c->lock);
+          c->broken = 1;
+          conn_watch(srv, c);
+          pthread_mutex_unlock(&c->lock);
+        }
+        if (events[i].events & EPOLLOUT) {
+          pthread_mutex_lock(&c->lock);
+          conn_flush(c);
+          conn_watch(srv, c);
+          pthread_mutex_unlock(&c->lock);
+        }
+      }
+    }
+    resume_conns(srv);
+    sweep_conns(srv);
+  }
+}
+
+/*!
+ * \brief Запускает сервис вычислений на Unix-сокете.
+ *
+ * Работает до SIGINT или SIGTERM, после чего дожидается обработки
+ * принятых запросов и удаляет файл сокета.
+ *
+ * \param path Путь к файлу сокета.
+ * \param threads Число рабочих потоков.
+ * \param timeout_ms Срок выполнения одного запроса, мс (0 — без срока).
+ * \return OK при нормальной остановке, ERROR при ошибке запуска.
+ */
+int serve(const char *path, int threads, long long timeout_ms) {
+  server *srv = calloc(1, sizeof(server));
+  if (srv == NULL) return ERROR;
+  srv->timeout_ms = timeout_ms;
+  srv->listen_fd = open_socket(path);
+  srv->epfd = epoll_create1(EPOLL_CLOEXEC);
+  srv->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  struct epoll_event listen_ev = {.events = EPOLLIN, .data.ptr = NULL};
+  struct epoll_event wake_ev = {.events = EPOLLIN, .data.ptr = srv};
+  int error = OK;
+  if (srv->listen_fd < 0 || srv->epfd < 0 || srv->wake_fd < 0 ||
+      epoll_ctl(srv->epfd, EPOLL_CTL_ADD, srv->listen_fd, &listen_ev) ||
+      epoll_ctl(srv->epfd, EPOLL_CTL_ADD, srv->wake_fd, &wake_ev))
+    error = ERROR;
+
+  pthread_rwlockattr_t attr;
+  pthread_rwlockattr_init(&attr);
+  // поиски в кэше идут непрерывно, без этого компиляция может ждать долго
+  pthread_rwlockattr_setkind_np(&attr,
+                                PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+  pthread_rwlock_init(&srv->cache.lock, &attr);
+  pthread_rwlockattr_destroy(&attr);
+  srv->cache.free_head = ERROR;
+  for (int i = 0; i < SERVE_BUCKETS; i++) srv->cache.buckets[i] = ERROR;
+  pthread_mutex_init(&srv->queue_lock, NULL);
+  pthread_cond_init(&srv->queue_cond, NULL);
+
+  pthread_t *ids = malloc(sizeof(pthread_t) * threads);
+  int started = 0;
+  for (int i = 0; error == OK && ids && i < threads; i++)
+    if (pthread_create(&ids[i], NULL, serve_worker, srv) == 0) started++;
+  if (started == 0) error = ERROR;
+
+  if (error == OK) {
+    struct sigaction sa = {0};
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    fprintf(stderr, "serving on %s with %d threads\n", path, started);
+    event_loop(srv);
+  }
+
+  pthread_mutex_lock(&srv->queue_lock);
+  srv->stopping = 1;
+  pthread_cond_broadcast(&srv->queue_cond);
+  pthread_mutex_unlock(&srv->queue_lock);
+  for (int i = 0; i < started; i++) pthread_join(ids[i], NULL);
+  free(ids);
+  for (conn *c = srv->conns; c; c = c->next) c->broken = 1;
+  sweep_conns(srv);
+  for (int i = 0; i < srv->cache.size; i++) {
+    if (srv->cache.entries[i].refs > 0) {
+      remove_program(&srv->cache.entries[i].prog);
+      free(srv->cache.entries[i].text);
+    }
+  }
+  free(srv->cache.entries);
+  pthread_rwlock_destroy(&srv->cache.lock);
+  pthread_mutex_destroy(&srv->queue_lock);
+  pthread_cond_destroy(&srv->queue_cond);
+  if (srv->listen_fd >= 0) {
+    close(srv->listen_fd);
+    unlink_socket(path);
+  }
+  if (srv->epfd >= 0) close(srv->epfd);
+  if (srv->wake_fd >= 0) close(srv->wake_fd);
+  free(srv);
+  return error;
+}
+
+#else
+
+int serve(const char *path, int threads, long long timeout_ms) {
+  (void)threads;
+  (void)timeout_ms;
+  fprintf(stderr, "%s: serving requires Linux (epoll)\n", path);
+  return -1;
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef S21_SERVE_H
+#define S21_SERVE_H
+
+#include <stdint.h>
+
+/*!
+ * \defgroup ServeProtocol Протокол сервиса вычислений
+ * @{
+ * \brief Двоичный протокол обмена через Unix-сокет.
+ *
+ * Каждое сообщение начинается с заголовка serve_frame, за которым идут
+ * length байт данных. Числа передаются в порядке байтов машины (сокет
+ * локальный). Ответ повторяет op и id запроса; запросы одного соединения
+ * обрабатываются параллельно, поэтому ответы могут приходить не по порядку.
+ *
+ * SERVE_COMPILE: данные — текст выражения (флаг SERVE_DDOUBLE включает
+ * повышенную точность). Ответ: uint32 дескриптор, uint32 число переменных и
+ * их имена по слотам, по одному байту.
+ *
+ * SERVE_EVAL: данные — uint32 дескриптор, uint32 число строк, uint32 число
+ * столбцов (не меньше одного), uint32 ноль и столбцы double по слотам
+ * переменных. Недостающие столбцы считаются нулевыми. Ответ: столбец double
+ * результатов.
+ *
+ * SERVE_FREE: данные — uint32 дескриптор. Освобождает одну ссылку,
+ * полученную через SERVE_COMPILE этим же соединением; дескриптор, который
+ * соединение не получало, даёт ошибку. Ссылки, не освобождённые клиентом,
+ * освобождаются при закрытии соединения. Ответ без данных.
+ *
+ * Компиляция и вычисление ограничены лимитами SERVE_MAX_* и сроком;
+ * запрос, превысивший их, получает статус SERVE_STATUS_LIMIT. Запросы
+ * разорванного соединения прерываются.
+ *
+ * Соединение, у которого в работе SERVE_MAX_PENDING запросов или
+ * SERVE_MAX_PENDING_BYTES байт их данных либо неотправленных ответов,
+ * не читается, пока клиент не получит ответы.
+ */
+
+//! Запрос: скомпилировать выражение.
+#define SERVE_COMPILE 1
+
+//! Запрос: вычислить выражение по столбцам значений.
+#define SERVE_EVAL 2
+
+//! Запрос: освободить скомпилированное выражение.
+#define SERVE_FREE 3
+
+//! Флаг SERVE_COMPILE: вычислять с двойной-двойной точностью.
+#define SERVE_DDOUBLE 1
+
+//! Статус ответа: запрос выполнен.
+#define SERVE_STATUS_OK 0
+
+//! Статус ответа: ошибка (неверный запрос, выражение или дескриптор).
+#define SERVE_STATUS_ERROR 1
+
+//! Статус ответа: превышен лимит или срок запроса, либо запрос прерван.
+#define SERVE_STATUS_LIMIT 2
+
+//! Наибольшее число лексем выражения.
+#define SERVE_MAX_TOKENS 65536
+
+//! Наибольшая вложенность скобок выражения.
+#define SERVE_MAX_DEPTH 128
+
+//! Наибольшее число операций одного запроса.
+#define SERVE_MAX_OPS 10000000000LL
+
+//! Срок выполнения запроса по умолчанию, мс.
+#define SERVE_TIMEOUT_MS 5000
+
+//! Максимальный размер данных одного сообщения.
+#define SERVE_MAX_FRAME (256u << 20)
+
+//! Наибольшее число запросов одного соединения в работе.
+#define SERVE_MAX_PENDING 64
+
+//! Наибольший объём данных запросов или ответов одного соединения.
+#define SERVE_MAX_PENDING_BYTES SERVE_MAX_FRAME
+
+/*!
+ * \struct serve_frame
+ * \brief Заголовок сообщения.
+ */
+typedef struct serve_frame {
+  uint32_t length;
+  uint8_t op;
+  uint8_t status;
+  uint16_t flags;
+  uint32_t id;
+} serve_frame;
+
+/*! @} */
+
+int serve(const char *path, int threads, long long timeout_ms);
+#endif
@@ -1,6 +1,7 @@
 #include "creditwindow.h"
 
-#include <QTextEdit>
+#include <QHeaderView>
+#include <QTableView>
 
 #include "../lib/s21_creditcal.h"
 #include "ui_creditwindow.h"
@@ -16,6 +17,18 @@ CreditWindow::CreditWindow(QWidget *parent)
   ui->label_dif_payment->hide();
   ui->payment_month_max->hide();
 
+  // строки одной высоты позволяют представлению не измерять весь график
+  ui->scheduleView->setModel(&model);
+  ui->scheduleView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+  ui->scheduleView->horizontalHeader()->setSectionResizeMode(
+      QHeaderView::Stretch);
+
+  sweepScale = new QCPColorScale(ui->sweepPlot);
+  ui->sweepPlot->plotLayout()->addElement(0, 1, sweepScale);
+  ui->sweepPlot->xAxis->setLabel("Ставка, %");
+  ui->sweepPlot->yAxis->setLabel("Срок, мес.");
+  sweepPayment.resize(SWEEP_RATES * SWEEP_TERMS);
+
   this->setWindowTitle("Credit Calculator");
 }
 
@@ -25,43 +38,43 @@ void CreditWindow::on_pushButton_clicked() {
   double S = ui->creditsum->value();
   double P = ui->P->value();
   int N = static_cast<int>(ui->months->value());
-  ui->textEdit->clear();
-
-  if (ui->radioButton_an->isChecked()) {
-    double result = calculateAnnuityPayment(S, N, P);
-    ui->payment_month->show();
-    ui->payment_month_min->hide();
-    ui->payment_month_max->hide();
-    ui->label_month_pay->show();
-    ui->label_dif_payment->hide();
-    ui->payment_month->setValue(result);
-    ui->payment_all->setValue(result * N);
-    ui->overpay->setValue(result * N - S);
-
-    for (int month = 1; month <= N; ++month) {
-      ui->textEdit->append("Месяц " + QString::number(month) + ": " +
-                           QString::number(result, 'f', 2));
-    }
-  } else if (ui->radioButton_dif->isChecked()) {
-    double *payments = calculateDifferentialPayments(S, N, P);
-    if (payments != NULL) {
-      double total = 0;
-      for (int i = 0; i < N; ++i) {
-        total += payments[i];
-        ui->textEdit->append("Месяц " + QString::number(i + 1) + ": " +
-                             QString::number(payments[i], 'f', 2));
-      }
-      ui->payment_month_max->setValue(payments[0]);
-      ui->payment_month_min->setValue(payments[N - 1]);
-      free(payments);  // Освобождение памяти
-      ui->payment_all->setValue(total);
-      ui->overpay->setValue(total - S);
-      ui->payment_month_min->show();
-      ui->payment_month_max->show();
-      ui->payment_month->hide();
-      ui->label_month_pay->hide();
-      ui->label_dif_payment->show();
-    }
+
+  bool annuity = ui->radioButton_an->isChecked();
+  if (!annuity && !ui->radioButton_dif->isChecked()) return;
+  if (model.recalculate(S, N, P,
+                        annuity ? CREDIT_ANNUITY : CREDIT_DIFFERENTIAL) != OK)
+    return;
+
+  const loan_schedule_minor &schedule = model.schedule();
+  ui->payment_all->setValue(schedule.totalPayment / 100.0);
+  ui->overpay->setValue(schedule.totalInterest / 100.0);
+
+  // эффективная ставка считается по тем же платежам в копейках, что и в
+  // таблице
+  payments.resize(schedule.count);
+  for (int i = 0; i < schedule.count; ++i)
+    payments[i] = schedule.payment[i] / 100.0;
+  loan_schedule flows = {};
+  flows.payment = payments.data();
+  flows.capacity = flows.count = schedule.count;
+  loan_fees fees = {ui->fee_upfront->value(), ui->fee_monthly->value()};
+  double effective = 0;
+  if (calculateEffectiveRate(S, &flows, &fees, &effective) == OK)
+    ui->effective_rate->setValue(effective);
+  else
+    ui->effective_rate->clear();
+
+  ui->payment_month->setVisible(annuity);
+  ui->label_month_pay->setVisible(annuity);
+  ui->payment_month_min->setVisible(!annuity);
+  ui->payment_month_max->setVisible(!annuity);
+  ui->label_dif_payment->setVisible(!annuity);
+  if (annuity) {
+    ui->payment_month->setValue(schedule.payment[0] / 100.0);
+  } else {
+    ui->payment_month_max->setValue(schedule.payment[0] / 100.0);
+    ui->payment_month_min->setValue(schedule.payment[schedule.count - 1] /
+                                    100.0);
   }
 }
 
@@ -71,3 +84,37 @@ void CreditWindow::on_actionNormal_triggered() {
 }
 
 void CreditWindow::on_pushButton_2_clicked() { on_actionNormal_triggered(); }
+
+void CreditWindow::on_pushButton_sweep_clicked() {
+  double S = ui->creditsum->value();
+  double maxRate = qMax(2 * ui->P->value(), 1.0);
+  int maxTerm = qMax(2 * static_cast<int>(ui->months->value()), SWEEP_TERMS);
+
+  // карта строится вокруг текущих условий: ставки от 0 до удвоенной,
+  // сроки от месяца до удвоенного
+  double rates[SWEEP_RATES];
+  int terms[SWEEP_TERMS];
+  for (int i = 0; i < SWEEP_RATES; ++i)
+    rates[i] = maxRate * i / (SWEEP_RATES - 1);
+  for (int j = 0; j < SWEEP_TERMS; ++j)
+    terms[j] = 1 + (maxTerm - 1) * j / (SWEEP_TERMS - 1);
+  loan_sweep sweep = {sweepPayment.data(), nullptr, nullptr};
+  if (calculateSweep(rates, SWEEP_RATES, terms, SWEEP_TERMS, &S, 1, &sweep) !=
+      OK)
+    return;
+
+  ui->sweepPlot->clearPlottables();
+  QCPColorMap *map =
+      new QCPColorMap(ui->sweepPlot->xAxis, ui->sweepPlot->yAxis);
+  map->data()->setSize(SWEEP_RATES, SWEEP_TERMS);
+  map->data()->setRange(QCPRange(rates[0], rates[SWEEP_RATES - 1]),
+                        QCPRange(terms[0], terms[SWEEP_TERMS - 1]));
+  for (int i = 0; i < SWEEP_RATES; ++i)
+    for (int j = 0; j < SWEEP_TERMS; ++j)
+      map->data()->setCell(i, j, sweepPayment[i * SWEEP_TERMS + j]);
+  map->setColorScale(sweepScale);
+  map->setGradient(QCPColorGradient::gpThermal);
+  map->rescaleDataRange();
+  ui->sweepPlot->rescaleAxes();
+  ui->sweepPlot->replot();
+}
@@ -2,13 +2,15 @@
 #define CREDITWINDOW_H
 
 #include <QMainWindow>
-#ifdef __cplusplus
-extern "C" {
-#endif
-#include "../lib/s21_creditcal.h"
-#ifdef __cplusplus
-}
-#endif
+
+#include "qcustomplot.h"
+#include "schedulemodel.h"
+
+//! Число ставок на карте платежей.
+#define SWEEP_RATES 200
+
+//! Число сроков на карте платежей.
+#define SWEEP_TERMS 40
 
 namespace Ui {
 class CreditWindow;
@@ -28,11 +30,17 @@ class CreditWindow : public QMainWindow {
 
   void on_pushButton_2_clicked();
 
+  void on_pushButton_sweep_clicked();
+
  signals:
   void showMain();
 
  private:
   Ui::CreditWindow *ui;
+  ScheduleModel model;
+  QVector<double> payments;
+  QCPColorScale *sweepScale;
+  QVector<double> sweepPayment;
 };
 
 #endif  // CREDITWINDOW_H
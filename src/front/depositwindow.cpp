@@ -0,0 +1,121 @@
+#include "depositwindow.h"
+
+#include <algorithm>
+
+#include "ui_depositwindow.h"
+
+/**
+ * @brief Добавляет в таблицу событий пустую строку (день 0, сумма 0).
+ */
+static void addEventRow(QTableWidget *table) {
+  int row = table->rowCount();
+  table->insertRow(row);
+  table->setItem(row, 0, new QTableWidgetItem("0"));
+  table->setItem(row, 1, new QTableWidgetItem("0"));
+}
+
+/**
+ * @brief Удаляет из таблицы событий выделенную (или последнюю) строку.
+ */
+static void removeEventRow(QTableWidget *table) {
+  int row = table->currentRow();
+  if (row < 0) row = table->rowCount() - 1;
+  if (row >= 0) table->removeRow(row);
+}
+
+/**
+ * @brief Читает события из таблицы и упорядочивает их по дню.
+ *
+ * @return true, если все ячейки — числа.
+ */
+static bool readEvents(const QTableWidget *table,
+                       QVector<deposit_event> &events) {
+  events.clear();
+  bool valid = true;
+  for (int row = 0; row < table->rowCount(); ++row) {
+    bool dayOk = false, amountOk = false;
+    deposit_event e;
+    e.day = table->item(row, 0) ? table->item(row, 0)->text().toInt(&dayOk) : 0;
+    e.amount = table->item(row, 1)
+                   ? table->item(row, 1)->text().toDouble(&amountOk)
+                   : 0;
+    valid = valid && dayOk && amountOk;
+    events.append(e);
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const deposit_event &a, const deposit_event &b) {
+                     return a.day < b.day;
+                   });
+  return valid;
+}
+
+DepositWindow::DepositWindow(QWidget *parent)
+    : QMainWindow(parent), ui(new Ui::DepositWindow) {
+  ui->setupUi(this);
+
+  ui->period->addItem("Ежедневно", DEPOSIT_DAILY);
+  ui->period->addItem("Еженедельно", DEPOSIT_WEEKLY);
+  ui->period->addItem("Ежемесячно", DEPOSIT_MONTHLY);
+  ui->period->addItem("Ежеквартально", DEPOSIT_QUARTERLY);
+  ui->period->addItem("Раз в полгода", DEPOSIT_HALF_YEARLY);
+  ui->period->addItem("Ежегодно", DEPOSIT_YEARLY);
+  ui->period->addItem("В конце срока", DEPOSIT_AT_END);
+  ui->period->setCurrentIndex(2);
+
+  this->setWindowTitle("Deposit Calculator");
+}
+
+DepositWindow::~DepositWindow() { delete ui; }
+
+void DepositWindow::on_pushButton_calc_clicked() {
+  QVector<deposit_event> plus, minus;
+  bool valid = readEvents(ui->replenishments, plus);
+  valid = readEvents(ui->withdrawals, minus) && valid;
+
+  deposit_params params = {};
+  params.amount = ui->amount->value();
+  params.term = ui->term->value();
+  params.interestRate = ui->rate->value();
+  params.taxRate = ui->tax_rate->value();
+  params.taxFree = ui->tax_free->value();
+  params.period = ui->period->currentData().toInt();
+  params.capitalization = ui->capitalization->isChecked();
+  params.replenishments = plus.data();
+  params.nreplenishments = plus.size();
+  params.withdrawals = minus.data();
+  params.nwithdrawals = minus.size();
+  deposit_result result;
+  if (valid && calculateDeposit(&params, &result) == OK) {
+    ui->interest->setValue(result.interest);
+    ui->tax->setValue(result.tax);
+    ui->balance->setValue(result.balance);
+    ui->statusbar->clearMessage();
+  } else {
+    ui->interest->clear();
+    ui->tax->clear();
+    ui->balance->clear();
+    ui->statusbar->showMessage(
+        "Проверьте дни (от 0 до срока вклада) и суммы событий");
+  }
+}
+
+void DepositWindow::on_pushButton_add_replenishment_clicked() {
+  addEventRow(ui->replenishments);
+}
+
+void DepositWindow::on_pushButton_remove_replenishment_clicked() {
+  removeEventRow(ui->replenishments);
+}
+
+void DepositWindow::on_pushButton_add_withdrawal_clicked() {
+  addEventRow(ui->withdrawals);
+}
+
+void DepositWindow::on_pushButton_remove_withdrawal_clicked() {
+  removeEventRow(ui->withdrawals);
+}
+
+void DepositWindow::on_pushButton_back_clicked() {
+  this->hide();
+  emit showMain();
+}
@@ -0,0 +1,47 @@
+#ifndef DEPOSITWINDOW_H
+#define DEPOSITWINDOW_H
+
+#include <QMainWindow>
+#include <QTableWidget>
+#include <QVector>
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "../lib/s21_datatypes.h"
+#include "../lib/s21_depositcal.h"
+#ifdef __cplusplus
+}
+#endif
+
+namespace Ui {
+class DepositWindow;
+}
+
+class DepositWindow : public QMainWindow {
+  Q_OBJECT
+
+ public:
+  explicit DepositWindow(QWidget *parent = nullptr);
+  ~DepositWindow();
+
+ private slots:
+  void on_pushButton_calc_clicked();
+
+  void on_pushButton_add_replenishment_clicked();
+
+  void on_pushButton_remove_replenishment_clicked();
+
+  void on_pushButton_add_withdrawal_clicked();
+
+  void on_pushButton_remove_withdrawal_clicked();
+
+  void on_pushButton_back_clicked();
+
+ signals:
+  void showMain();
+
+ private:
+  Ui::DepositWindow *ui;
+};
+
+#endif  // DEPOSITWINDOW_H
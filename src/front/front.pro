@@ -4,34 +4,61 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 QT += printsupport
 
 CONFIG += c++17
+unix: LIBS += -lpthread
 
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    ../lib/s21_aggregate.c \
+    ../lib/s21_budget.c \
     ../lib/s21_creditcal.c \
+    ../lib/s21_depositcal.c \
     creditwindow.cpp \
+    depositwindow.cpp \
     main.cpp \
     mainwindow.cpp \
+    schedulemodel.cpp \
     ../lib/s21_datatypes.c \
+    ../lib/s21_ddouble.c \
+    ../lib/s21_dual.c \
+    ../lib/s21_integral.c \
     ../lib/s21_lexeme_parser.c \
     ../lib/s21_polish.c \
+    ../lib/s21_pool.c \
+    ../lib/s21_preview.c \
+    ../lib/s21_program.c \
+    ../lib/s21_roots.c \
     ../lib/s21_validate.c \
     qcustomplot.cpp
 
 HEADERS += \
     creditwindow.h \
+    depositwindow.h \
     mainwindow.h \
+    schedulemodel.h \
+    ../lib/s21_aggregate.h \
+    ../lib/s21_budget.h \
+    ../lib/s21_creditcal.h \
     ../lib/s21_datatypes.h \
+    ../lib/s21_depositcal.h \
+    ../lib/s21_ddouble.h \
+    ../lib/s21_dual.h \
+    ../lib/s21_integral.h \
     ../lib/s21_lexeme_parser.h \
     ../lib/s21_polish.h \
+    ../lib/s21_pool.h \
+    ../lib/s21_preview.h \
+    ../lib/s21_program.h \
+    ../lib/s21_roots.h \
     ../lib/s21_validate.h \
     ../s21_smartcal.h \
     qcustomplot.h
 
 FORMS += \
     creditwindow.ui \
+    depositwindow.ui \
     mainwindow.ui
 
 # Default rules for deployment.
@@ -1,11 +1,50 @@
 #include "mainwindow.h"
 
+#include "../lib/s21_budget.h"
 #include "../lib/s21_datatypes.h"
+#include "../lib/s21_ddouble.h"
+#include "../lib/s21_dual.h"
+#include "../lib/s21_integral.h"
 #include "../lib/s21_lexeme_parser.h"
 #include "../lib/s21_polish.h"
+#include "../lib/s21_preview.h"
+#include "../lib/s21_program.h"
+#include "../lib/s21_roots.h"
 #include "../lib/s21_validate.h"
 #include "./ui_mainwindow.h"
 
+//! Лимиты вычислений по кнопкам: окно не должно зависать дольше двух секунд.
+static const eval_limits kButtonLimits = {65536, 128, 0, 2000, nullptr};
+
+//! Лимиты предпросмотра: он пересчитывается при каждом нажатии клавиши.
+static const eval_limits kPreviewLimits = {65536, 128, 0, 50, nullptr};
+
+/**
+ * @brief Делает бюджет с заданными лимитами текущим для потока интерфейса.
+ *
+ * @param limits Лимиты вычисления.
+ * @return budget* Бюджет, который нужно завершить функцией finishBudget.
+ */
+static budget *startBudget(const eval_limits &limits) {
+  budget *b = nullptr;
+  budget_create(&limits, &b);
+  budget_enter(b);
+  return b;
+}
+
+/**
+ * @brief Снимает бюджет с потока интерфейса и освобождает его.
+ *
+ * @param b Бюджет от startBudget.
+ * @return int OK или LIMITED, если вычисление превысило лимиты.
+ */
+static int finishBudget(budget *b) {
+  int status = budget_status(b);
+  budget_enter(nullptr);
+  budget_destroy(b);
+  return status;
+}
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), ui(new Ui::MainWindow) {
   ui->setupUi(this);
@@ -40,11 +79,22 @@ MainWindow::MainWindow(QWidget *parent)
   connect(ui->pushButton_x, SIGNAL(clicked()), this, SLOT(addOperand()));
 
   connect(&cw, &CreditWindow::showMain, this, &MainWindow::show);
+  connect(&dw, &DepositWindow::showMain, this, &MainWindow::show);
+
+  preview_init(&pv, FALSE);
+  ui->previewPlot->addGraph();
+  ui->previewPlot->graph(0)->setPen(QColor(61, 82, 62, 255));
+  connect(ui->outputEdit, &QLineEdit::textChanged, this,
+          &MainWindow::updatePreview);
+  updatePreview(ui->outputEdit->text());
 }
 
 void MainWindow::showWindow() { this->show(); }
 
-MainWindow::~MainWindow() { delete ui; }
+MainWindow::~MainWindow() {
+  preview_free(&pv);
+  delete ui;
+}
 
 void MainWindow::on_pushButton_C_clicked() {
   ui->outputEdit->setText(QString("0"));
@@ -53,20 +103,37 @@ void MainWindow::on_pushButton_C_clicked() {
 /**
  * @brief Вычисляет значение математического выражения.
  *
- * Функция принимает строку, содержащую математическое выражение, преобразует её
- * в обратную польскую нотацию, затем вычисляет результат. В случае ошибки
- * парсинга или вычисления возвращает NaN.
+ * Функция принимает строку, содержащую математическое выражение, компилирует
+ * её в программу и вычисляет результат. Программа поддерживает агрегаты sum,
+ * prod, min и max. В случае ошибки парсинга или вычисления возвращает NaN.
  *
  * @param input Строка, содержащая математическое выражение.
  * @return double Результат вычисления выражения, или NaN в случае ошибки.
  */
 double calculateExpression(const QString &input) {
   double result = NAN;
-  stack *st = parse_all(input.toStdString().c_str());
-  if (st != NULL && s21_validate(st) != ERROR) {
-    stack *p = to_polish(&st);
-    calc_polish(p, &result);
+  program prog = {};
+  if (compile_program(input.toStdString().c_str(), &prog) == OK)
+    calc_program(&prog, get_x(), &result);
+  remove_program(&prog);
+  return result;
+}
+
+/**
+ * @brief Вычисляет значение выражения с двойной-двойной точностью.
+ *
+ * @param input Строка, содержащая математическое выражение.
+ * @return double Результат вычисления, округлённый до double, или NaN в
+ * случае ошибки.
+ */
+double calculateExpressionExact(const QString &input) {
+  double result = NAN;
+  program prog = {};
+  if (compile_program(input.toStdString().c_str(), &prog) == OK) {
+    prog.precision = P_DDOUBLE;
+    calc_program(&prog, get_x(), &result);
   }
+  remove_program(&prog);
   return result;
 }
 
@@ -74,17 +141,25 @@ double calculateExpression(const QString &input) {
  * @brief Обрабатывает нажатие на кнопку "=".
  *
  * Функция считывает текущее математическое выражение из текстового поля,
- * вычисляет его и выводит результат обратно в текстовое поле. В случае ошибки
- * отображает сообщение об ошибке.
+ * вычисляет его и выводит результат обратно в текстовое поле. Если отмечен
+ * флажок повышенной точности, выражение вычисляется с двойной-двойной
+ * точностью и выводится с 16 значащими цифрами. В случае ошибки
+ * отображает сообщение об ошибке, а если вычисление не уложилось в лимиты
+ * kButtonLimits — сообщение LIMIT.
  */
 void MainWindow::on_pushButton_eq_clicked() {
   QString input = ui->outputEdit->text();
-  double result = calculateExpression(input);
+  bool exact = ui->checkBox_ddouble->isChecked();
+  budget *b = startBudget(kButtonLimits);
+  double result =
+      exact ? calculateExpressionExact(input) : calculateExpression(input);
 
-  if (std::isnan(result)) {
+  if (finishBudget(b) != OK) {
+    ui->outputEdit->setText("LIMIT");
+  } else if (std::isnan(result)) {
     ui->outputEdit->setText("ERROR");
   } else {
-    ui->outputEdit->setText(QString::number(result, 'g', 7));
+    ui->outputEdit->setText(QString::number(result, 'g', exact ? 16 : 7));
   }
 }
 
@@ -92,9 +167,13 @@ void MainWindow::on_pushButton_eq_clicked() {
  * @brief Обрабатывает нажатие на кнопку построения графика.
  *
  * Функция считывает значения X и Y из соответствующих полей интерфейса,
- * вычисляет значения функции в заданном диапазоне и строит график функции. В
- * случае ошибки в выражении или его вычислении пропускает соответствующую
- * точку.
+ * компилирует выражение один раз и вычисляет его сразу для всех точек
+ * заданного диапазона. Если отмечен флажок производной, значения f'(x)
+ * получаются в том же проходе и выводятся поверх графика. Если отмечен флажок
+ * интеграла, по тем же точкам строится первообразная F(x) = ∫ f от min x до
+ * x. В случае ошибки в выражении или его вычислении в графике остаются
+ * пропуски; точки, не уложившиеся в лимиты kButtonLimits, тоже остаются
+ * пропусками, а в строке состояния выводится предупреждение.
  */
 void MainWindow::on_pushButton_clicked() {
   double x_min = ui->doubleSpinBox_minx->value();
@@ -102,33 +181,49 @@ void MainWindow::on_pushButton_clicked() {
   double y_min = ui->doubleSpinBox_miny->value();
   double y_max = ui->doubleSpinBox_maxy->value();
   int numPoints = 9000;  // over 9000
+  bool derivative = ui->checkBox_derivative->isChecked();
 
-  QVector<double> x, y;
+  // NaN в векторе чтобы были пропуски в графике в случае ошибки
+  QVector<double> x(numPoints + 1), y(numPoints + 1, NAN),
+      dy(numPoints + 1, NAN);
   QString input = ui->outputEdit->text();
 
   double h = (x_max - x_min) / (numPoints);
+  for (int i = 0; i <= numPoints; ++i) x[i] = x_min + i * h;
 
-  for (int i = 0; i <= numPoints; ++i) {
-    double X = x_min + i * h;
-    x.push_back(X);
-    set_x(X);
-    double result = calculateExpression(input);
-    if (std::isnan(result)) {
-      // NaN  в векторе чтобы были пропуски в графике в таком случае
-      y.push_back(std::numeric_limits<double>::quiet_NaN());
+  budget *b = startBudget(kButtonLimits);
+  program prog = {};
+  if (compile_program(input.toStdString().c_str(), &prog) == OK) {
+    if (derivative) {
+      QVector<dual> d(x.size());
+      calc_program_dual_batch(&prog, x.data(), 1, d.data(), x.size());
+      for (int i = 0; i < x.size(); ++i) {
+        y[i] = d[i].v;
+        dy[i] = d[i].d1;
+      }
     } else {
-      y.push_back(result);
+      calc_program_batch(&prog, x.data(), y.data(), x.size());
     }
   }
+  remove_program(&prog);
+  if (finishBudget(b) != OK)
+    ui->statusbar->showMessage("LIMIT: вычисление прервано");
 
   setupGraph(x, y, x_min, x_max, y_min, y_max);
+  if (derivative) addOverlay(x, dy, QColor(192, 28, 40, 255));
+  if (ui->checkBox_antiderivative->isChecked()) {
+    QVector<double> F(x.size());
+    cumulative_integral(y.data(), y.size(), h, F.data());
+    addOverlay(x, F, QColor(26, 95, 180, 255));
+  }
 }
 
 /**
  * @brief Настраивает и отображает график.
  *
- * Функция устанавливает данные для графика, конфигурирует внешний вид, задает
- * диапазон отображения и отрисовывает график.
+ * Функция удаляет прежние графики, устанавливает данные для нового,
+ * конфигурирует внешний вид, задает диапазон отображения и отрисовывает
+ * график.
  *
  * @param x Вектор координат X.
  * @param y Вектор координат Y.
@@ -140,6 +235,7 @@ void MainWindow::on_pushButton_clicked() {
 void MainWindow::setupGraph(const QVector<double> &x, const QVector<double> &y,
                             double x_min, double x_max, double y_min,
                             double y_max) {
+  ui->graph->clearGraphs();
   ui->graph->addGraph();
   ui->graph->graph(0)->setData(x, y);
   ui->graph->xAxis->setRange(x_min, x_max);
@@ -152,7 +248,24 @@ void MainWindow::setupGraph(const QVector<double> &x, const QVector<double> &y,
   graphPen.setWidth(2);
   ui->graph->graph(0)->setPen(graphPen);
   ui->graph->replot();
-  set_x(ui->lcdNumber->value());
+}
+
+/**
+ * @brief Добавляет на график дополнительную кривую.
+ *
+ * Используется для вывода производной и первообразной поверх основного
+ * графика.
+ *
+ * @param x Вектор координат X.
+ * @param y Вектор координат Y.
+ * @param color Цвет кривой.
+ */
+void MainWindow::addOverlay(const QVector<double> &x, const QVector<double> &y,
+                            const QColor &color) {
+  QCPGraph *overlay = ui->graph->addGraph();
+  overlay->setData(x, y);
+  overlay->setPen(QPen(color, 1));
+  ui->graph->replot();
 }
 
 void MainWindow::addOperand() {
@@ -213,3 +326,128 @@ void MainWindow::on_actionCredit_triggered() {
 }
 
 void MainWindow::on_pushButton_10_clicked() { on_actionCredit_triggered(); }
+
+/**
+ * @brief Открывает депозитный калькулятор вместо основного окна.
+ */
+void MainWindow::on_actionDeposit_triggered() {
+  this->hide();
+  dw.show();
+}
+
+/**
+ * @brief Обрабатывает нажатие на кнопку поиска нулей и экстремумов.
+ *
+ * Функция строит график выражения и ищет на отрезке [min x, max x] его нули,
+ * минимумы и максимумы. Найденные точки отмечаются на графике, а их
+ * количество выводится в строке состояния.
+ */
+void MainWindow::on_pushButton_roots_clicked() {
+  on_pushButton_clicked();
+  double x_min = ui->doubleSpinBox_minx->value();
+  double x_max = ui->doubleSpinBox_maxx->value();
+
+  budget *b = startBudget(kButtonLimits);
+  program prog = {};
+  QVector<root> roots(1024);
+  int n = ERROR;
+  if (compile_program(ui->outputEdit->text().toStdString().c_str(), &prog) ==
+      OK)
+    n = find_roots(&prog, x_min, x_max, 0, 0, roots.data(), roots.size());
+  remove_program(&prog);
+  if (finishBudget(b) != OK) n = LIMITED;
+  if (n < 0) {
+    ui->statusbar->showMessage(n == LIMITED ? "LIMIT" : "ERROR");
+    return;
+  }
+
+  QVector<double> zx, zy, ex, ey;
+  for (int i = 0; i < n; ++i) {
+    if (roots[i].kind == R_ZERO) {
+      zx.push_back(roots[i].x);
+      zy.push_back(roots[i].y);
+    } else {
+      ex.push_back(roots[i].x);
+      ey.push_back(roots[i].y);
+    }
+  }
+  QCPGraph *zeros = ui->graph->addGraph();
+  zeros->setData(zx, zy);
+  zeros->setLineStyle(QCPGraph::lsNone);
+  zeros->setScatterStyle(
+      QCPScatterStyle(QCPScatterStyle::ssCircle, QColor(192, 28, 40), 7));
+  QCPGraph *extrema = ui->graph->addGraph();
+  extrema->setData(ex, ey);
+  extrema->setLineStyle(QCPGraph::lsNone);
+  extrema->setScatterStyle(
+      QCPScatterStyle(QCPScatterStyle::ssDiamond, QColor(26, 95, 180), 7));
+  ui->graph->replot();
+  ui->statusbar->showMessage("Нулей: " + QString::number(zx.size()) +
+                             ", экстремумов: " + QString::number(ex.size()));
+}
+
+/**
+ * @brief Обрабатывает нажатие на кнопку вычисления интеграла.
+ *
+ * Функция вычисляет определённый интеграл выражения на отрезке
+ * [min x, max x] и выводит его значение с оценкой погрешности в строке
+ * состояния.
+ */
+void MainWindow::on_pushButton_integral_clicked() {
+  double x_min = ui->doubleSpinBox_minx->value();
+  double x_max = ui->doubleSpinBox_maxx->value();
+  double result = NAN, err = NAN;
+
+  budget *b = startBudget(kButtonLimits);
+  program prog = {};
+  int error = compile_program(ui->outputEdit->text().toStdString().c_str(),
+                              &prog);
+  if (error == OK) error = integrate_program(&prog, x_min, x_max, 0, &result,
+                                             &err);
+  remove_program(&prog);
+  if (finishBudget(b) != OK) error = LIMITED;
+
+  if (error == LIMITED) {
+    ui->statusbar->showMessage("LIMIT");
+  } else if (std::isnan(result)) {
+    ui->statusbar->showMessage("ERROR");
+  } else {
+    ui->statusbar->showMessage(
+        "∫ = " + QString::number(result, 'g', 12) + " ± " +
+        QString::number(err, 'g', 2) + (error == OK ? "" : " (неточно)"));
+  }
+}
+
+/**
+ * @brief Обновляет предпросмотр результата при изменении выражения.
+ *
+ * Вызывается на каждое изменение текста в поле ввода. Выражение разбирается
+ * инкрементально: заново обрабатываются только лексемы около места правки.
+ * Под кнопками выводится значение при текущем x и небольшой график по
+ * диапазону X из полей построения графика. Вычисление ограничено лимитами
+ * kPreviewLimits, чтобы тяжёлое выражение не задерживало набор.
+ *
+ * @param text Новый текст выражения.
+ */
+void MainWindow::updatePreview(const QString &text) {
+  const int numPoints = 200;
+  QVector<double> x(numPoints + 1), y(numPoints + 1, NAN);
+  double x_min = ui->doubleSpinBox_minx->value();
+  double x_max = ui->doubleSpinBox_maxx->value();
+  double h = (x_max - x_min) / numPoints;
+  for (int i = 0; i <= numPoints; ++i) x[i] = x_min + i * h;
+
+  double result = NAN;
+  budget *b = startBudget(kPreviewLimits);
+  if (preview_update(&pv, text.toStdString().c_str()) == OK) {
+    calc_program(&pv.prog, get_x(), &result);
+    calc_program_batch(&pv.prog, x.data(), y.data(), x.size());
+  }
+  finishBudget(b);
+  ui->label_preview->setText(
+      std::isnan(result) ? QString() : "= " + QString::number(result, 'g', 7));
+  ui->previewPlot->graph(0)->setData(x, y);
+  ui->previewPlot->xAxis->setRange(x_min, x_max);
+  ui->previewPlot->graph(0)->rescaleValueAxis();
+  ui->previewPlot->replot();
+}
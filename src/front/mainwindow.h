@@ -4,13 +4,20 @@
 #include <QMainWindow>
 
 #include "creditwindow.h"
+#include "depositwindow.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
+#include "../lib/s21_budget.h"
 #include "../lib/s21_datatypes.h"
+#include "../lib/s21_dual.h"
+#include "../lib/s21_integral.h"
 #include "../lib/s21_lexeme_parser.h"
 #include "../lib/s21_polish.h"
+#include "../lib/s21_preview.h"
+#include "../lib/s21_program.h"
+#include "../lib/s21_roots.h"
 #include "../lib/s21_validate.h"
 #ifdef __cplusplus
 }
@@ -47,14 +54,26 @@ class MainWindow : public QMainWindow {
   void on_pushButton_last_exp_clicked();
 
   void on_actionCredit_triggered();
+
+  void on_actionDeposit_triggered();
   void setupGraph(const QVector<double> &x, const QVector<double> &y,
                   double x_min, double x_max, double y_min, double y_max);
+  void addOverlay(const QVector<double> &x, const QVector<double> &y,
+                  const QColor &color);
 
   void on_pushButton_10_clicked();
 
+  void on_pushButton_roots_clicked();
+
+  void on_pushButton_integral_clicked();
+
+  void updatePreview(const QString &text);
+
  private:
   CreditWindow cw;
+  DepositWindow dw;
   Ui::MainWindow *ui;
   QString lastUsedString = "0";
+  preview pv;
 };
 #endif  // MAINWINDOW_H
@@ -0,0 +1,53 @@
+#include "schedulemodel.h"
+
+#include <cmath>
+
+ScheduleModel::ScheduleModel(QObject *parent) : QAbstractTableModel(parent) {}
+
+/*!
+ * \brief Пересчитывает график; буфер растёт только при увеличении срока.
+ *
+ * \return OK или ERROR; при ошибке модель становится пустой.
+ */
+int ScheduleModel::recalculate(double loanAmount, int loanTerm,
+                               double interestRate, int type) {
+  beginResetModel();
+  if (loanTerm > 0 && buffer.size() < CREDIT_COLUMNS * loanTerm)
+    buffer.resize(CREDIT_COLUMNS * loanTerm);
+  bindScheduleMinor(&sched, buffer.data(), buffer.size() / CREDIT_COLUMNS);
+  int error = calculateScheduleMinor(std::llround(loanAmount * 100), loanTerm,
+                                     interestRate, type, CREDIT_ROUND_HALF_UP,
+                                     &sched);
+  endResetModel();
+  return error;
+}
+
+int ScheduleModel::rowCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : sched.count;
+}
+
+int ScheduleModel::columnCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : CREDIT_COLUMNS;
+}
+
+QVariant ScheduleModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() >= sched.count) return QVariant();
+  if (role == Qt::TextAlignmentRole)
+    return int(Qt::AlignRight | Qt::AlignVCenter);
+  if (role != Qt::DisplayRole) return QVariant();
+  const long long *column[CREDIT_COLUMNS] = {sched.payment, sched.principal,
+                                             sched.interest, sched.balance};
+  long long kopecks = column[index.column()][index.row()];
+  return QString("%1.%2").arg(kopecks / 100).arg(kopecks % 100, 2, 10,
+                                                 QChar('0'));
+}
+
+QVariant ScheduleModel::headerData(int section, Qt::Orientation orientation,
+                                   int role) const {
+  if (role != Qt::DisplayRole) return QVariant();
+  if (orientation == Qt::Vertical) return section + 1;
+  static const char *titles[CREDIT_COLUMNS] = {"Платёж", "Долг", "Проценты",
+                                               "Остаток"};
+  if (section >= CREDIT_COLUMNS) return QVariant();
+  return QString::fromUtf8(titles[section]);
+}
@@ -0,0 +1,45 @@
+#ifndef SCHEDULEMODEL_H
+#define SCHEDULEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "../lib/s21_creditcal.h"
+#include "../lib/s21_datatypes.h"
+#ifdef __cplusplus
+}
+#endif
+
+/*!
+ * \brief Модель графика платежей для QTableView.
+ *
+ * Хранит столбцы графика в одном переиспользуемом буфере и отдаёт
+ * представлению строки по запросу, поэтому форматируются только видимые
+ * ячейки, а не весь график целиком. График считается в целых копейках с
+ * округлением в каждом месяце, как в выписке банка.
+ */
+class ScheduleModel : public QAbstractTableModel {
+  Q_OBJECT
+
+ public:
+  explicit ScheduleModel(QObject *parent = nullptr);
+
+  int recalculate(double loanAmount, int loanTerm, double interestRate,
+                  int type);
+  const loan_schedule_minor &schedule() const { return sched; }
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const override;
+
+ private:
+  QVector<long long> buffer;
+  loan_schedule_minor sched = {};
+};
+
+#endif  // SCHEDULEMODEL_H
@@ -0,0 +1,538 @@
+/*!
+ * \file s21_aggregate.h
+ * \brief Агрегаты sum, prod, min и max по диапазону индекса
+ *
+ * Запись sum(k, 1, 1000000, 1/k^2) складывает значения тела для всех целых
+ * k от первой границы до второй включительно; prod перемножает их, min и max
+ * выбирают наименьшее и наибольшее. Границы и тело компилируются в
+ * отдельные программы один раз, а на месте агрегата во внешней программе
+ * остаётся одна инструкция S_AGGVALUE.
+ *
+ * Диапазон индекса делится на блоки по AGG_BLOCK значений; тело вычисляется
+ * пакетно для целого блока, блоки распределяются по потокам общего пула.
+ * Суммы блоков и итоговая сумма накапливаются с компенсацией (алгоритм
+ * Ноймайера) строго в порядке блоков, поэтому результат не зависит от числа
+ * потоков.
+ */
+#include "s21_aggregate.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "s21_budget.h"
+#include "s21_lexeme_parser.h"
+#include "s21_pool.h"
+
+//! Отметка в карте слотов: переменная в программе не используется.
+#define AGG_UNUSED -1
+
+//! Наибольшее по модулю значение границы, при котором все целые числа
+//! диапазона точно представимы в double (2^53).
+#define AGG_MAX_BOUND 9007199254740992.0
+
+/*!
+ * \struct agg_job
+ * \brief Задание пула: вычисление блоков одного агрегата.
+ */
+typedef struct agg_job {
+  const aggregate *agg;
+  double vars[S21_MAX_VARS];
+  int index_slot;
+  double first;
+  long long count;
+  double *part;
+  double *comp;
+  budget *budget;
+} agg_job;
+
+/*!
+ * \brief Возвращает слот переменной во внешней программе, при необходимости
+ * добавляя его.
+ *
+ * \return Номер слота или ERROR, если слоты закончились.
+ */
+static int outer_slot(program *prog, char name) {
+  int slot = program_var_slot(prog, name);
+  if (slot == ERROR && prog->nvars < S21_MAX_VARS) {
+    slot = prog->nvars;
+    prog->vars[prog->nvars++] = name;
+  }
+  return slot;
+}
+
+/*!
+ * \brief Строит карту слотов программы аргумента во внешнюю программу.
+ *
+ * \param prog Внешняя программа.
+ * \param sub Программа аргумента.
+ * \param index Имя индекса или 0, если индекс в аргументе не связан.
+ * \param map Карта для заполнения.
+ * \return OK или ERROR, если во внешней программе закончились слоты.
+ */
+static int map_slots(program *prog, const program *sub, char index,
+                     int *map) {
+  int error = OK;
+  for (int v = 0; v < S21_MAX_VARS; v++) map[v] = AGG_UNUSED;
+  for (int v = 0; error == OK && v < sub->nvars; v++) {
+    if (index && sub->vars[v] == index) {
+      map[v] = AGG_INDEX;
+    } else if (program_uses_slot(sub, v)) {
+      map[v] = outer_slot(prog, sub->vars[v]);
+      if (map[v] == ERROR) error = ERROR;
+    }
+  }
+  return error;
+}
+
+/*!
+ * \brief Отсоединяет аргумент от списка лексем и компилирует его.
+ *
+ * \param first Самая левая лексема аргумента.
+ * \param last Самая правая лексема аргумента.
+ * \param sub Программа для записи.
+ * \return OK или ERROR.
+ */
+static int compile_part(stack *first, stack *last, program *sub) {
+  first->next = NULL;
+  last->prew = NULL;
+  return compile_lexemes(last, sub);
+}
+
+/*!
+ * \brief Собирает один агрегат: находит его аргументы, компилирует их и
+ * заменяет всю запись лексемой S_AGGVALUE.
+ *
+ * \param head Указатель на вершину списка лексем.
+ * \param name Лексема имени агрегата.
+ * \param prog Внешняя программа.
+ * \return OK или ERROR при неверной записи агрегата.
+ */
+static int collect_aggregate(stack **head, stack *name, program *prog) {
+  stack *delim[5] = {name->prew};
+  stack *first[4] = {NULL}, *last[4] = {NULL};
+  int nparts = 0, depth = 0;
+  int error = delim[0] && delim[0]->type == S_OPERAND &&
+                      delim[0]->ival == '('
+                  ? OK
+                  : ERROR;
+  stack *start = error == OK ? delim[0]->prew : NULL;
+  for (stack *p = start; error == OK && p && nparts < 4; p = p->prew) {
+    int is_close = p->type == S_OPERAND && p->ival == ')';
+    int is_comma = p->type == S_OPERAND && p->ival == ',';
+    if (p->type == S_OPERAND && p->ival == '(') {
+      depth++;
+    } else if (is_close && depth > 0) {
+      depth--;
+    } else if ((is_close || is_comma) && depth == 0) {
+      // пустой аргумент, лишний аргумент или не хватает аргументов
+      if (p == start || (is_comma && nparts == 3) ||
+          (is_close && nparts < 3))
+        error = ERROR;
+      first[nparts] = start;
+      last[nparts] = p->next;
+      delim[++nparts] = p;
+      start = p->prew;
+    }
+  }
+  if (nparts != 4 || first[0] != last[0] || first[0]->type != S_XOPERAND)
+    error = ERROR;
+  if (error != OK) return ERROR;
+
+  aggregate *grown = realloc(prog->aggs, sizeof(aggregate) * (prog->naggs + 1));
+  if (grown == NULL) return ERROR;
+  prog->aggs = grown;
+  aggregate a = {0};
+  for (int v = 0; v < S21_MAX_VARS; v++)
+    a.lo_map[v] = a.hi_map[v] = a.body_map[v] = AGG_UNUSED;
+  a.kind = name->ival;
+  a.index = (char)first[0]->ival;
+
+  // вырезаем запись агрегата из списка, оставляя на её месте лексему имени
+  stack *close = delim[4];
+  name->prew = close->prew;
+  if (close->prew)
+    close->prew->next = name;
+  else
+    *head = name;
+  name->type = S_AGGVALUE;
+  name->ival = prog->naggs;
+  free(first[0]);
+  error = compile_part(first[1], last[1], &a.lo);
+  if (compile_part(first[2], last[2], &a.hi) != OK) error = ERROR;
+  if (compile_part(first[3], last[3], &a.body) != OK) error = ERROR;
+  for (int i = 0; i < 5; i++) free(delim[i]);
+
+  if (error == OK) error = map_slots(prog, &a.lo, 0, a.lo_map);
+  if (error == OK) error = map_slots(prog, &a.hi, 0, a.hi_map);
+  if (error == OK) error = map_slots(prog, &a.body, a.index, a.body_map);
+  a.constant = TRUE;
+  for (int v = 0; v < S21_MAX_VARS; v++)
+    if (a.lo_map[v] >= 0 || a.hi_map[v] >= 0 || a.body_map[v] >= 0)
+      a.constant = FALSE;
+  // даже неудачный агрегат сохраняется, чтобы remove_program освободил его
+  prog->aggs[prog->naggs++] = a;
+  return error;
+}
+
+/*!
+ * \brief Собирает все агрегаты в списке лексем.
+ *
+ * Каждая запись вида sum(k, от, до, тело) заменяется одной лексемой
+ * S_AGGVALUE, а границы и тело компилируются в программы агрегата
+ * prog->aggs. Переменные границ и тела, кроме индекса, становятся
+ * переменными внешней программы. Вложенные агрегаты собираются при
+ * компиляции тела.
+ *
+ * \param st Указатель на вершину списка лексем; вершина может измениться.
+ * \param prog Внешняя программа.
+ * \return OK или ERROR при неверной записи агрегата.
+ */
+int compile_aggregates(stack **st, program *prog) {
+  int error = OK;
+  stack *lex = *st;
+  while (lex && lex->next) lex = lex->next;
+  for (; lex && error == OK; lex = lex->prew)
+    if (lex->type == S_AGGREGATE) error = collect_aggregate(st, lex, prog);
+  return error;
+}
+
+/*!
+ * \brief Переносит значения внешних переменных в слоты программы
+ * аргумента.
+ */
+static void map_values(const int *map, int nvars, const double *outer,
+                       double *sub) {
+  for (int v = 0; v < nvars; v++) sub[v] = map[v] >= 0 ? outer[map[v]] : 0;
+}
+
+/*!
+ * \brief Переводит границы агрегата в первое значение индекса и число
+ * значений.
+ *
+ * \return OK или ERROR для бесконечных, слишком больших границ или слишком
+ * длинного диапазона.
+ */
+static int index_range(double lo, double hi, double *first,
+                       long long *count) {
+  if (!(fabs(lo) <= AGG_MAX_BOUND && fabs(hi) <= AGG_MAX_BOUND)) return ERROR;
+  *first = ceil(lo);
+  double n = floor(hi) - *first + 1;
+  *count = n > 0 ? (long long)n : 0;
+  return *count <= AGG_MAX_COUNT ? OK : ERROR;
+}
+
+/*!
+ * \brief Добавляет слагаемое к сумме с компенсацией (алгоритм Ноймайера).
+ */
+static void neumaier_add(double *sum, double *comp, double value) {
+  double t = *sum + value;
+  if (fabs(*sum) >= fabs(value))
+    *comp += (*sum - t) + value;
+  else
+    *comp += (value - t) + *sum;
+  *sum = t;
+}
+
+/*!
+ * \brief Добавляет значение к результату агрегата.
+ *
+ * NaN в min и max поглощает остальные значения, как и в sum и prod.
+ */
+static void accumulate(int kind, double *value, double *comp, double y) {
+  if (kind == A_SUM) {
+    neumaier_add(value, comp, y);
+  } else if (kind == A_PROD) {
+    *value *= y;
+  } else if (isnan(*value) || isnan(y)) {
+    *value = NAN;
+  } else if (kind == A_MIN ? y < *value : y > *value) {
+    *value = y;
+  }
+}
+
+/*!
+ * \brief Начальное значение результата агрегата.
+ */
+static double start_value(int kind) {
+  double value = 0;
+  if (kind == A_PROD) value = 1;
+  if (kind == A_MIN) value = INFINITY;
+  if (kind == A_MAX) value = -INFINITY;
+  return value;
+}
+
+/*!
+ * \brief Вычисляет блоки агрегата с from по to (функция пула).
+ *
+ * Поток пула вычисляет блоки в бюджете вызвавшего потока; после исчерпания
+ * бюджета оставшиеся блоки не вычисляются.
+ */
+static void agg_range(void *arg, int from, int to) {
+  agg_job *job = arg;
+  budget *prev = budget_enter(job->budget);
+  const program *body = &job->agg->body;
+  int kind = job->agg->kind;
+  double *buf = malloc(sizeof(double) * AGG_BLOCK * (body->nvars + 1));
+  const double *cols[S21_MAX_VARS] = {NULL};
+  double *index_col = buf && job->index_slot >= 0
+                          ? buf + AGG_BLOCK * (job->index_slot + 1)
+                          : NULL;
+  for (int v = 0; buf && v < body->nvars; v++) {
+    double *col = buf + AGG_BLOCK * (v + 1);
+    if (v != job->index_slot && job->vars[v] != 0)
+      for (int k = 0; k < AGG_BLOCK; k++) col[k] = job->vars[v];
+    if (v == job->index_slot || job->vars[v] != 0) cols[v] = col;
+  }
+  for (int b = from; b < to; b++) {
+    long long offset = (long long)b * AGG_BLOCK;
+    int len = job->count - offset < AGG_BLOCK ? (int)(job->count - offset)
+                                              : AGG_BLOCK;
+    double value = start_value(kind), comp = 0;
+    if (buf == NULL || budget_status(job->budget) != OK) {
+      value = NAN;
+    } else {
+      for (int k = 0; index_col && k < len; k++)
+        index_col[k] = job->first + (double)(offset + k);
+      calc_program_batch_vars(body, cols, buf, len);
+      for (int k = 0; k < len; k++) accumulate(kind, &value, &comp, buf[k]);
+    }
+    job->part[b] = value;
+    job->comp[b] = comp;
+  }
+  free(buf);
+  budget_enter(prev);
+}
+
+/*!
+ * \brief Вычисляет агрегат программы.
+ *
+ * \param prog Внешняя программа.
+ * \param index Номер агрегата в prog->aggs.
+ * \param vars Значения переменных внешней программы по слотам.
+ * \param result Указатель для записи результата.
+ * \return OK, ERROR (границы не конечны, диапазон длиннее AGG_MAX_COUNT,
+ * min или max по пустому диапазону) или LIMITED при исчерпании текущего
+ * бюджета потока; при ошибке результат — NaN.
+ */
+int calc_aggregate(const program *prog, int index, const double *vars,
+                   double *result) {
+  const aggregate *a = &prog->aggs[index];
+  double sub[S21_MAX_VARS];
+  double lo = NAN, hi = NAN;
+  map_values(a->lo_map, a->lo.nvars, vars, sub);
+  calc_program_vars(&a->lo, sub, &lo);
+  map_values(a->hi_map, a->hi.nvars, vars, sub);
+  calc_program_vars(&a->hi, sub, &hi);
+
+  agg_job job = {.agg = a,
+                 .index_slot = program_var_slot(&a->body, a->index),
+                 .budget = budget_current()};
+  map_values(a->body_map, a->body.nvars, vars, job.vars);
+  int error = index_range(lo, hi, &job.first, &job.count);
+  if (error == OK && job.count == 0 && (a->kind == A_MIN || a->kind == A_MAX))
+    error = ERROR;
+  int nblocks = (int)((job.count + AGG_BLOCK - 1) / AGG_BLOCK);
+  if (error == OK) {
+    job.part = malloc(sizeof(double) * (nblocks + 1));
+    job.comp = malloc(sizeof(double) * (nblocks + 1));
+    if (job.part == NULL || job.comp == NULL) error = ERROR;
+  }
+  double value = start_value(a->kind), comp = 0;
+  if (error == OK) {
+    pool_run(pool_shared(), nblocks, agg_range, &job);
+    for (int b = 0; b < nblocks; b++) {
+      accumulate(a->kind, &value, &comp, job.part[b]);
+      comp += job.comp[b];
+    }
+  }
+  free(job.part);
+  free(job.comp);
+  if (budget_status(job.budget) != OK) error = LIMITED;
+  *result = error == OK ? value + comp : NAN;
+  return error;
+}
+
+/*!
+ * \brief Вычисляет агрегат для блока точек пакетного вычисления.
+ *
+ * \param prog Внешняя программа.
+ * \param index Номер агрегата.
+ * \param cols Столбцы переменных внешней программы (NULL — нули).
+ * \param start Номер первой точки блока в столбцах.
+ * \param n Количество точек.
+ * \param fixed Значения постоянных агрегатов от fix_aggregates или NULL.
+ * \param y Массив для записи результатов.
+ */
+void calc_aggregate_batch(const program *prog, int index,
+                          const double *const *cols, int start, int n,
+                          const double *fixed, double *y) {
+  if (fixed && prog->aggs[index].constant) {
+    for (int k = 0; k < n; k++) y[k] = fixed[index];
+    return;
+  }
+  double vars[S21_MAX_VARS] = {0};
+  for (int k = 0; k < n; k++) {
+    for (int v = 0; v < prog->nvars; v++)
+      vars[v] = cols[v] ? cols[v][start + k] : 0;
+    calc_aggregate(prog, index, vars, &y[k]);
+  }
+}
+
+/*!
+ * \brief Заранее вычисляет агрегаты, не зависящие от переменных программы.
+ *
+ * \param prog Программа.
+ * \return Массив значений по номерам агрегатов (для остальных агрегатов —
+ * NaN) или NULL, если агрегатов нет. Массив нужно освободить.
+ */
+double *fix_aggregates(const program *prog) {
+  double *fixed = prog->naggs ? malloc(sizeof(double) * prog->naggs) : NULL;
+  double vars[S21_MAX_VARS] = {0};
+  for (int i = 0; fixed && i < prog->naggs; i++) {
+    fixed[i] = NAN;
+    if (prog->aggs[i].constant) calc_aggregate(prog, i, vars, &fixed[i]);
+  }
+  return fixed;
+}
+
+/*!
+ * \brief Переносит значения двойной-двойной точности в слоты аргумента.
+ */
+static void map_values_dd(const int *map, int nvars, const ddouble *outer,
+                          ddouble *sub) {
+  for (int v = 0; v < nvars; v++)
+    sub[v] = map[v] >= 0 ? outer[map[v]] : dd_from(0);
+}
+
+/*!
+ * \brief Сравнивает числа двойной-двойной точности.
+ */
+static int dd_less(ddouble a, ddouble b) {
+  return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+/*!
+ * \brief Вычисляет агрегат с двойной-двойной точностью.
+ *
+ * Значения тела вычисляются и накапливаются последовательно в порядке
+ * индекса.
+ *
+ * \param prog Внешняя программа.
+ * \param index Номер агрегата.
+ * \param vars Значения переменных внешней программы.
+ * \param result Указатель для записи результата.
+ * \return OK или ERROR, как у calc_aggregate.
+ */
+int calc_aggregate_dd(const program *prog, int index, const ddouble *vars,
+                      ddouble *result) {
+  const aggregate *a = &prog->aggs[index];
+  ddouble sub[S21_MAX_VARS], lo = dd_from(0), hi = dd_from(0);
+  map_values_dd(a->lo_map, a->lo.nvars, vars, sub);
+  calc_program_dd(&a->lo, sub, &lo);
+  map_values_dd(a->hi_map, a->hi.nvars, vars, sub);
+  calc_program_dd(&a->hi, sub, &hi);
+
+  double first = 0;
+  long long count = 0;
+  int error = index_range(lo.hi + lo.lo, hi.hi + hi.lo, &first, &count);
+  if (error == OK && count == 0 && (a->kind == A_MIN || a->kind == A_MAX))
+    error = ERROR;
+  map_values_dd(a->body_map, a->body.nvars, vars, sub);
+  int slot = program_var_slot(&a->body, a->index);
+  ddouble value = dd_from(start_value(a->kind));
+  for (long long i = 0; error == OK && i < count; i++) {
+    ddouble y = dd_from(0);
+    if (slot >= 0) sub[slot] = dd_from(first + (double)i);
+    if (calc_program_dd(&a->body, sub, &y) == LIMITED) error = LIMITED;
+    if (a->kind == A_SUM)
+      value = dd_add(value, y);
+    else if (a->kind == A_PROD)
+      value = dd_mul(value, y);
+    else if (isnan(value.hi) || isnan(y.hi))
+      value = dd_from(NAN);
+    else if (a->kind == A_MIN ? dd_less(y, value) : dd_less(value, y))
+      value = y;
+  }
+  if (budget_status(budget_current()) != OK) error = LIMITED;
+  *result = error == OK ? value : dd_from(NAN);
+  return error;
+}
+
+/*!
+ * \brief Вычисляет агрегат вместе с производными по x.
+ *
+ * Границы считаются постоянными: при малом изменении x набор значений
+ * индекса не меняется.
+ *
+ * \param prog Внешняя программа.
+ * \param index Номер агрегата.
+ * \param vars Дуальные значения переменных внешней программы.
+ * \param order Порядок производных (1 или 2).
+ * \param result Указатель для записи результата.
+ * \return OK или ERROR, как у calc_aggregate.
+ */
+int calc_aggregate_dual(const program *prog, int index, const dual *vars,
+                        int order, dual *result) {
+  const aggregate *a = &prog->aggs[index];
+  dual sub[S21_MAX_VARS] = {{0}}, lo = {0}, hi = {0};
+  for (int v = 0; v < a->lo.nvars; v++)
+    if (a->lo_map[v] >= 0) sub[v] = vars[a->lo_map[v]];
+  calc_program_dual_vars(&a->lo, sub, order, &lo);
+  memset(sub, 0, sizeof(sub));
+  for (int v = 0; v < a->hi.nvars; v++)
+    if (a->hi_map[v] >= 0) sub[v] = vars[a->hi_map[v]];
+  calc_program_dual_vars(&a->hi, sub, order, &hi);
+
+  double first = 0;
+  long long count = 0;
+  int error = index_range(lo.v, hi.v, &first, &count);
+  if (error == OK && count == 0 && (a->kind == A_MIN || a->kind == A_MAX))
+    error = ERROR;
+  memset(sub, 0, sizeof(sub));
+  for (int v = 0; v < a->body.nvars; v++)
+    if (a->body_map[v] >= 0) sub[v] = vars[a->body_map[v]];
+  int slot = program_var_slot(&a->body, a->index);
+  dual value = {start_value(a->kind), 0, 0};
+  double comp = 0;
+  for (long long i = 0; error == OK && i < count; i++) {
+    dual y = {0}, index_value = {first + (double)i, 0, 0};
+    if (slot >= 0) sub[slot] = index_value;
+    if (calc_program_dual_vars(&a->body, sub, order, &y) == LIMITED)
+      error = LIMITED;
+    if (a->kind == A_SUM) {
+      neumaier_add(&value.v, &comp, y.v);
+      value.d1 += y.d1;
+      value.d2 += y.d2;
+    } else if (a->kind == A_PROD) {
+      value.d2 = value.d2 * y.v + 2 * value.d1 * y.d1 + value.v * y.d2;
+      value.d1 = value.d1 * y.v + value.v * y.d1;
+      value.v *= y.v;
+    } else if (isnan(value.v) || isnan(y.v)) {
+      value.v = NAN;
+    } else if (a->kind == A_MIN ? y.v < value.v : y.v > value.v) {
+      value = y;
+    }
+  }
+  value.v += comp;
+  if (budget_status(budget_current()) != OK) error = LIMITED;
+  dual failed = {NAN, NAN, NAN};
+  *result = error == OK ? value : failed;
+  return error;
+}
+
+/*!
+ * \brief Освобождает агрегаты программы.
+ *
+ * \param prog Указатель на программу.
+ */
+void remove_aggregates(program *prog) {
+  for (int i = 0; i < prog->naggs; i++) {
+    remove_program(&prog->aggs[i].lo);
+    remove_program(&prog->aggs[i].hi);
+    remove_program(&prog->aggs[i].body);
+  }
+  free(prog->aggs);
+  prog->aggs = NULL;
+  prog->naggs = 0;
+}
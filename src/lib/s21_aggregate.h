@@ -0,0 +1,51 @@
+#ifndef S21_AGGREGATE_H
+#define S21_AGGREGATE_H
+
+#include "s21_datatypes.h"
+#include "s21_ddouble.h"
+#include "s21_dual.h"
+#include "s21_program.h"
+
+//! Число значений индекса в одном блоке. Разбиение на блоки не зависит от
+//! числа потоков, поэтому и результат от него не зависит.
+#define AGG_BLOCK 4096
+
+//! Наибольшее число значений индекса в одном агрегате.
+#define AGG_MAX_COUNT 1000000000LL
+
+//! Отметка в карте слотов: слот тела агрегата занимает индекс.
+#define AGG_INDEX -2
+
+/*!
+ * \struct aggregate
+ * \brief Агрегат sum(k, от, до, тело), prod, min или max.
+ *
+ * Границы и тело компилируются в отдельные программы. Карты слотов
+ * связывают слоты этих программ со слотами внешней программы; в карте тела
+ * слот индекса отмечен AGG_INDEX.
+ */
+typedef struct aggregate {
+  int kind;
+  char index;
+  program lo;
+  program hi;
+  program body;
+  int lo_map[S21_MAX_VARS];
+  int hi_map[S21_MAX_VARS];
+  int body_map[S21_MAX_VARS];
+  int constant;
+} aggregate;
+
+int compile_aggregates(stack **st, program *prog);
+int calc_aggregate(const program *prog, int index, const double *vars,
+                   double *result);
+void calc_aggregate_batch(const program *prog, int index,
+                          const double *const *cols, int start, int n,
+                          const double *fixed, double *y);
+double *fix_aggregates(const program *prog);
+int calc_aggregate_dd(const program *prog, int index, const ddouble *vars,
+                      ddouble *result);
+int calc_aggregate_dual(const program *prog, int index, const dual *vars,
+                        int order, dual *result);
+void remove_aggregates(program *prog);
+#endif
@@ -0,0 +1,173 @@
+/*!
+ * \file s21_budget.h
+ * \brief Лимиты, срок и отмена вычислений
+ *
+ * Операции сначала копятся в счётчике потока и списываются с общего
+ * атомарного счётчика бюджета порциями не меньше BUDGET_FLUSH_OPS, а часы
+ * читаются только когда общий счётчик переходит через кратное
+ * BUDGET_CLOCK_OPS. Поэтому проверка стоит пары сравнений на программу или
+ * блок точек, а лимит операций и срок соблюдаются с точностью до нескольких
+ * тысяч операций на поток. Флаг отмены проверяется при каждом списании.
+ * Лимиты числа лексем и вложенности скобок проверяются при компиляции, до
+ * построения программы.
+ */
+#include "s21_budget.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*!
+ * \brief Внутреннее устройство бюджета.
+ */
+struct budget {
+  eval_limits limits;
+  long long deadline;
+  atomic_llong used;
+  atomic_int status;
+};
+
+//! Текущий бюджет потока или NULL, если вычисления не ограничены.
+static _Thread_local budget *current = NULL;
+
+//! Операции текущего бюджета, ещё не списанные с его общего счётчика.
+static _Thread_local long long pending = 0;
+
+/*!
+ * \brief Возвращает показание монотонных часов, нс.
+ */
+static long long now_ns() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+/*!
+ * \brief Создаёт бюджет; отсчёт срока начинается сразу.
+ *
+ * \param limits Лимиты вычисления.
+ * \param b Указатель для записи бюджета; освобождается budget_destroy.
+ * \return OK или ERROR.
+ */
+int budget_create(const eval_limits *limits, budget **b) {
+  *b = limits ? malloc(sizeof(budget)) : NULL;
+  if (*b == NULL) return ERROR;
+  (*b)->limits = *limits;
+  (*b)->deadline =
+      limits->timeout_ms > 0 ? now_ns() + limits->timeout_ms * 1000000LL : 0;
+  atomic_init(&(*b)->used, 0);
+  atomic_init(&(*b)->status, OK);
+  return OK;
+}
+
+/*!
+ * \brief Делает бюджет текущим для вызывающего потока.
+ *
+ * \param b Бюджет или NULL, чтобы снять ограничения.
+ * \return Прежний бюджет потока; его нужно вернуть тем же вызовом.
+ */
+budget *budget_enter(budget *b) {
+  budget *prev = current;
+  if (prev && pending)
+    atomic_fetch_add_explicit(&prev->used, pending, memory_order_relaxed);
+  pending = 0;
+  current = b;
+  return prev;
+}
+
+/*!
+ * \brief Возвращает текущий бюджет потока или NULL.
+ */
+budget *budget_current() { return current; }
+
+/*!
+ * \brief Проверяет, исчерпан ли бюджет после списания операций.
+ *
+ * \param b Бюджет.
+ * \param before Счётчик операций до списания.
+ * \param used Счётчик операций после списания.
+ */
+static int exceeded(const budget *b, long long before, long long used) {
+  const eval_limits *lim = &b->limits;
+  int over = lim->max_ops > 0 && used > lim->max_ops;
+  if (b->deadline && before / BUDGET_CLOCK_OPS != used / BUDGET_CLOCK_OPS &&
+      now_ns() > b->deadline)
+    over = TRUE;
+  return over;
+}
+
+/*!
+ * \brief Списывает операции с текущего бюджета потока.
+ *
+ * \param ops Число операций.
+ * \return OK или LIMITED, если бюджет исчерпан, срок вышел или вычисление
+ * отменено. Без текущего бюджета всегда OK.
+ */
+int budget_charge(long long ops) {
+  budget *b = current;
+  if (b == NULL) return OK;
+  int status = atomic_load_explicit(&b->status, memory_order_relaxed);
+  if (status == OK && b->limits.cancel &&
+      __atomic_load_n(b->limits.cancel, __ATOMIC_RELAXED))
+    status = LIMITED;
+  pending += ops;
+  if (status == OK && pending >= BUDGET_FLUSH_OPS) {
+    long long before =
+        atomic_fetch_add_explicit(&b->used, pending, memory_order_relaxed);
+    if (exceeded(b, before, before + pending)) status = LIMITED;
+    pending = 0;
+  }
+  if (status == LIMITED)
+    atomic_store_explicit(&b->status, LIMITED, memory_order_relaxed);
+  return status;
+}
+
+/*!
+ * \brief Проверяет по текущему бюджету число лексем и вложенность скобок,
+ * а заодно срок и флаг отмены.
+ *
+ * \param st Вершина списка лексем.
+ * \return OK или LIMITED; в последнем случае бюджет становится исчерпанным.
+ */
+int budget_check_lexemes(const stack *st) {
+  budget *b = current;
+  if (b == NULL) return OK;
+  int count = 0, depth = 0, deepest = 0;
+  // список идёт справа налево, поэтому вложенность открывает ')'
+  for (; st; st = st->next) {
+    count++;
+    if (st->type == S_OPERAND && st->ival == ')' && ++depth > deepest)
+      deepest = depth;
+    if (st->type == S_OPERAND && st->ival == '(') depth--;
+  }
+  const eval_limits *lim = &b->limits;
+  if ((lim->max_tokens > 0 && count > lim->max_tokens) ||
+      (lim->max_depth > 0 && deepest > lim->max_depth) ||
+      (lim->cancel && __atomic_load_n(lim->cancel, __ATOMIC_RELAXED)) ||
+      (b->deadline && now_ns() > b->deadline))
+    atomic_store_explicit(&b->status, LIMITED, memory_order_relaxed);
+  return atomic_load_explicit(&b->status, memory_order_relaxed);
+}
+
+/*!
+ * \brief Возвращает состояние бюджета.
+ *
+ * \param b Бюджет или NULL.
+ * \return OK или LIMITED; для NULL — OK.
+ */
+int budget_status(const budget *b) {
+  return b ? atomic_load_explicit(&b->status, memory_order_relaxed) : OK;
+}
+
+/*!
+ * \brief Возвращает число списанных с бюджета операций (без операций,
+ * которые потоки ещё копят у себя).
+ */
+long long budget_used(const budget *b) {
+  return b ? atomic_load_explicit(&b->used, memory_order_relaxed) : 0;
+}
+
+/*!
+ * \brief Освобождает бюджет. Бюджет не должен оставаться текущим.
+ */
+void budget_destroy(budget *b) { free(b); }
@@ -0,0 +1,49 @@
+#ifndef S21_BUDGET_H
+#define S21_BUDGET_H
+
+#include "s21_datatypes.h"
+
+//! Через сколько списанных операций бюджет сверяется с часами.
+#define BUDGET_CLOCK_OPS 16384
+
+//! Сколько операций поток копит у себя, прежде чем списать их с общего
+//! счётчика бюджета.
+#define BUDGET_FLUSH_OPS 1024
+
+/*!
+ * \struct eval_limits
+ * \brief Лимиты одного вычисления. Нулевое поле означает отсутствие
+ * ограничения.
+ *
+ * Флаг cancel читается атомарно и записывать его нужно тоже атомарно,
+ * например __atomic_store_n; ненулевое значение прерывает вычисление.
+ */
+typedef struct eval_limits {
+  int max_tokens;
+  int max_depth;
+  long long max_ops;
+  long long timeout_ms;
+  const int *cancel;
+} eval_limits;
+
+/*!
+ * \struct budget
+ * \brief Бюджет вычисления: лимиты, срок и счётчик выполненных операций.
+ *
+ * Бюджет делается текущим для потока функцией budget_enter, после чего
+ * компиляция и все вычислители списывают с него операции: один раз на
+ * вычисление программы, блок пакетного вычисления или блок агрегата, а не на
+ * каждую инструкцию. Исчерпанный бюджет остаётся исчерпанным, и вычисление
+ * завершается с кодом LIMITED. Агрегаты передают бюджет потокам пула.
+ */
+typedef struct budget budget;
+
+int budget_create(const eval_limits *limits, budget **b);
+budget *budget_enter(budget *b);
+budget *budget_current();
+int budget_charge(long long ops);
+int budget_check_lexemes(const stack *st);
+int budget_status(const budget *b);
+long long budget_used(const budget *b);
+void budget_destroy(budget *b);
+#endif
@@ -2,10 +2,71 @@
  *@file s21_creditcal.h
  *@brief Методы для работы с кредитным калькулятором
  */
+#include "s21_creditcal.h"
+
+#include <limits.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "s21_datatypes.h"
+#include "s21_pool.h"
+
+//! Делитель процентов месяца: 12 месяцев * 100% * 10^6 долей ставки.
+#define CREDIT_RATE_DENOM (12LL * 100 * 1000000)
+
+//! Предел сумм графика в копейках (2^62): платежи и итоги меньше него
+//! помещаются в long long с запасом на округления.
+#define CREDIT_MINOR_LIMIT 0x1p62
+
+/**
+ * @brief Задание пакетного расчёта для потоков пула.
+ */
+typedef struct sweep_job {
+  const double* rates;
+  const int* terms;
+  const double* amounts;
+  int nterms;
+  int namounts;
+  loan_sweep* sweep;
+} sweep_job;
+
+/**
+ * @brief Рассчитывает аннуитетный коэффициент — платёж на единицу долга.
+ *
+ * Степень (1 + r)^-n считается одним вызовом exp(-n * log1p(r)), а знаменатель
+ * через expm1, чтобы не терять точность на малых ставках. При нулевой ставке
+ * коэффициент равен 1 / n.
+ *
+ * @param rate Месячная ставка (доля, не проценты).
+ * @param loanTerm Срок кредита в месяцах; после досрочного погашения со
+ * снижением срока он может быть дробным.
+ * @return double Аннуитетный коэффициент.
+ */
+static double annuityFactor(double rate, double loanTerm) {
+  if (rate == 0) return 1.0 / loanTerm;
+  return rate / -expm1(-loanTerm * log1p(rate));
+}
+
+/**
+ * @brief Рассчитывает срок в месяцах, за который аннуитетный платёж гасит
+ * остаток долга, — обратная к annuityFactor задача.
+ *
+ * Из balance * r / (1 - (1 + r)^-n) = payment следует
+ * n = -log(1 - balance * r / payment) / log(1 + r). Срок дробный: последний
+ * платёж меньше остальных. Если платёж не покрывает проценты, результат —
+ * бесконечность или NAN.
+ *
+ * @param balance Остаток долга.
+ * @param payment Ежемесячный платёж.
+ * @param rate Месячная ставка (доля, не проценты).
+ * @return double Срок в месяцах.
+ */
+static double annuityTerm(double balance, double payment, double rate) {
+  if (rate == 0) return balance / payment;
+  return -log1p(-balance * rate / payment) / log1p(rate);
+}
+
 /**
  * @brief Рассчитывает дифференцированные платежи по кредиту.
  *
@@ -40,9 +101,510 @@ double* calculateDifferentialPayments(double loanAmount, int loanTerm,
  */
 double calculateAnnuityPayment(double loanAmount, int loanTerm,
                                double interestRate) {
-  double monthlyInterestRate = interestRate / 12 / 100;
-  double annuityFactor = monthlyInterestRate *
-                         pow(1 + monthlyInterestRate, loanTerm) /
-                         (pow(1 + monthlyInterestRate, loanTerm) - 1);
-  return loanAmount * annuityFactor;
+  return loanAmount * annuityFactor(interestRate / 12 / 100, loanTerm);
+}
+
+/**
+ * @brief Разбивает один буфер на столбцы графика платежей.
+ *
+ * @param schedule График для настройки.
+ * @param buffer Буфер не меньше CREDIT_COLUMNS * capacity элементов.
+ * @param capacity Наибольшее число периодов в графике.
+ */
+void bindSchedule(loan_schedule* schedule, double* buffer, int capacity) {
+  schedule->payment = buffer;
+  schedule->principal = buffer + capacity;
+  schedule->interest = buffer + 2 * capacity;
+  schedule->balance = buffer + 3 * capacity;
+  schedule->capacity = capacity;
+  schedule->count = 0;
+  schedule->accumulate = 0;
+}
+
+/**
+ * @brief Записывает значение в столбец графика или прибавляет к нему.
+ *
+ * @param column Столбец или NULL, если он не нужен.
+ * @param at Номер месяца.
+ * @param value Значение.
+ * @param accumulate Прибавлять ли значение к столбцу.
+ */
+static inline void putColumn(double* column, int at, double value,
+                             int accumulate) {
+  if (column == NULL) return;
+  if (accumulate)
+    column[at] += value;
+  else
+    column[at] = value;
+}
+
+/**
+ * @brief Проверяет досрочные погашения: месяцы в пределах срока и по
+ * неубыванию, неотрицательные суммы, известный режим.
+ */
+static int checkPrepayments(const loan_prepayment* events, int nevents,
+                            int loanTerm) {
+  if (nevents < 0 || (nevents > 0 && events == NULL)) return ERROR;
+  int last = 1;
+  for (int e = 0; e < nevents; ++e) {
+    if (events[e].month < last || events[e].month > loanTerm ||
+        !(events[e].amount >= 0) ||
+        (events[e].mode != CREDIT_REDUCE_TERM &&
+         events[e].mode != CREDIT_REDUCE_PAYMENT))
+      return ERROR;
+    last = events[e].month;
+  }
+  return OK;
+}
+
+/**
+ * @brief Рассчитывает полный график платежей по кредиту за один проход.
+ *
+ * Для каждого месяца записываются платёж, погашаемая часть долга,
+ * проценты и остаток долга после платежа. В последнем месяце гасится
+ * весь остаток, поэтому ошибки округления не накапливаются и график
+ * заканчивается нулевым остатком. Память не выделяется.
+ *
+ * @param loanAmount Общая сумма кредита.
+ * @param loanTerm Срок кредита в месяцах.
+ * @param interestRate Годовая процентная ставка.
+ * @param type CREDIT_ANNUITY или CREDIT_DIFFERENTIAL.
+ * @param schedule График с буферами вызывающего (см. bindSchedule).
+ * @return int OK или ERROR при неверных параметрах или нехватке места в
+ * буферах.
+ */
+int calculateSchedule(double loanAmount, int loanTerm, double interestRate,
+                      int type, loan_schedule* schedule) {
+  return calculatePrepaidSchedule(loanAmount, loanTerm, interestRate, type,
+                                  NULL, 0, schedule);
+}
+
+/**
+ * @brief Рассчитывает график платежей с досрочными погашениями.
+ *
+ * События обрабатываются по ходу того же прохода, что и обычный график:
+ * погашение уменьшает остаток после платежа своего месяца, и дальше график
+ * продолжается от нового остатка. В режиме CREDIT_REDUCE_PAYMENT платёж
+ * (или доля долга при дифференцированных платежах) пересчитывается на
+ * оставшийся срок, в режиме CREDIT_REDUCE_TERM он сохраняется и кредит
+ * гасится раньше. Поэтому расчёт стоит O(месяцев + событий). Досрочная
+ * сумма входит в платёж и погашаемую часть долга своего месяца; сумма сверх
+ * остатка не списывается.
+ *
+ * @param loanAmount Общая сумма кредита.
+ * @param loanTerm Срок кредита в месяцах.
+ * @param interestRate Годовая процентная ставка.
+ * @param type CREDIT_ANNUITY или CREDIT_DIFFERENTIAL.
+ * @param events Досрочные погашения, упорядоченные по месяцу.
+ * @param nevents Число погашений.
+ * @param schedule График с буферами вызывающего; count — фактический срок.
+ * @return int OK или ERROR при неверных параметрах, неупорядоченных
+ * событиях или нехватке места в буферах.
+ */
+int calculatePrepaidSchedule(double loanAmount, int loanTerm,
+                             double interestRate, int type,
+                             const loan_prepayment* events, int nevents,
+                             loan_schedule* schedule) {
+  // отрицательная ставка — ошибка, а не нулевая ставка кривой
+  rate_segment fixed = {1, interestRate >= 0 ? interestRate : NAN};
+  rate_curve curve = {&fixed, 1, 0};
+  return calculateCurveSchedule(loanAmount, loanTerm, &curve, type, events,
+                                nevents, schedule);
+}
+
+/**
+ * @brief Проверяет кривую ставок: первый отрезок начинается с первого
+ * месяца, начала отрезков возрастают, ставки конечны.
+ */
+static int checkCurve(const rate_curve* curve) {
+  if (curve == NULL || curve->count < 1 || curve->segments == NULL ||
+      curve->segments[0].month != 1 || !isfinite(curve->spread))
+    return ERROR;
+  for (int i = 0; i < curve->count; ++i)
+    if (!isfinite(curve->segments[i].rate) ||
+        (i > 0 && curve->segments[i].month <= curve->segments[i - 1].month))
+      return ERROR;
+  return OK;
+}
+
+/**
+ * @brief Рассчитывает график платежей по кривой ставок с досрочными
+ * погашениями.
+ *
+ * Ставка отрезка — значение индекса плюс надбавка curve->spread, но не
+ * меньше нуля. В начале каждого отрезка месячная ставка и аннуитетный
+ * коэффициент считаются один раз, и платёж пересчитывается на остаток долга
+ * и оставшийся срок; внутри отрезка месяцы идут без пересчёта. Досрочные
+ * погашения обрабатываются как в calculatePrepaidSchedule. Оставшийся срок
+ * отсчитывается до конца договора, а после погашения со снижением срока —
+ * до месяца, в который сохранённый платёж гасит кредит, поэтому смена
+ * ставки не растягивает сокращённый срок обратно. Весь график — один
+ * линейный проход, O(месяцев + отрезков + событий).
+ *
+ * @param loanAmount Общая сумма кредита.
+ * @param loanTerm Срок кредита в месяцах.
+ * @param curve Кривая ставок.
+ * @param type CREDIT_ANNUITY или CREDIT_DIFFERENTIAL.
+ * @param events Досрочные погашения, упорядоченные по месяцу, или NULL.
+ * @param nevents Число погашений.
+ * @param schedule График с буферами вызывающего; count — фактический срок.
+ * @return int OK или ERROR при неверных параметрах, кривой или событиях или
+ * нехватке места в буферах.
+ */
+int calculateCurveSchedule(double loanAmount, int loanTerm,
+                           const rate_curve* curve, int type,
+                           const loan_prepayment* events, int nevents,
+                           loan_schedule* schedule) {
+  if (schedule == NULL) return ERROR;
+  schedule->count = 0;
+  schedule->totalPayment = 0;
+  schedule->totalInterest = 0;
+  int store = schedule->payment || schedule->principal ||
+              schedule->interest || schedule->balance;
+  if (loanTerm < 1 || !(loanAmount >= 0) || checkCurve(curve) != OK ||
+      (type != CREDIT_ANNUITY && type != CREDIT_DIFFERENTIAL) ||
+      (store && schedule->capacity < loanTerm) ||
+      checkPrepayments(events, nevents, loanTerm) != OK)
+    return ERROR;
+
+  const rate_segment* segments = curve->segments;
+  double rate, annuity;
+  double share = loanAmount / loanTerm;
+  double balance = loanAmount;
+  // месяц (дробный), к которому платёж графика гасит кредит
+  double horizon = loanTerm;
+  int month = 0, e = 0, seg = 0, paid = FALSE;
+  while (month < loanTerm && !paid) {
+    rate = fmax(segments[seg].rate + curve->spread, 0) / 12 / 100;
+    annuity = balance * annuityFactor(rate, fmax(horizon - month, 1));
+    // внутри отрезка ставка и платёж не меняются до досрочного погашения
+    int end = ++seg < curve->count && segments[seg].month <= loanTerm
+                  ? segments[seg].month - 1
+                  : loanTerm;
+    while (month < end && !paid) {
+      double interest = balance * rate;
+      double principal = type == CREDIT_ANNUITY ? annuity - interest : share;
+      if (month == loanTerm - 1 || principal > balance) principal = balance;
+      balance -= principal;
+      month++;
+      for (; e < nevents && events[e].month == month; ++e) {
+        double extra = fmin(events[e].amount, balance);
+        balance -= extra;
+        principal += extra;
+        if (month == loanTerm || balance <= 0) continue;
+        if (events[e].mode == CREDIT_REDUCE_PAYMENT) {
+          annuity = balance * annuityFactor(rate, fmax(horizon - month, 1));
+          share = balance / fmax(horizon - month, 1);
+        } else {
+          double left = type == CREDIT_ANNUITY
+                            ? annuityTerm(balance, annuity, rate)
+                            : balance / share;
+          // fmin отбрасывает NAN, если платёж не покрывает проценты
+          horizon = fmin(month + left, horizon);
+        }
+      }
+      int acc = schedule->accumulate;
+      putColumn(schedule->payment, month - 1, principal + interest, acc);
+      putColumn(schedule->principal, month - 1, principal, acc);
+      putColumn(schedule->interest, month - 1, interest, acc);
+      putColumn(schedule->balance, month - 1, balance, acc);
+      schedule->totalPayment += principal + interest;
+      schedule->totalInterest += interest;
+      paid = loanAmount > 0 && balance <= 0;
+    }
+  }
+  schedule->count = month;
+  return OK;
+}
+
+/**
+ * @brief Разбивает один буфер на столбцы графика платежей в копейках.
+ *
+ * @param schedule График для настройки.
+ * @param buffer Буфер не меньше CREDIT_COLUMNS * capacity элементов.
+ * @param capacity Наибольшее число периодов в графике.
+ */
+void bindScheduleMinor(loan_schedule_minor* schedule, long long* buffer,
+                       int capacity) {
+  schedule->payment = buffer;
+  schedule->principal = buffer + capacity;
+  schedule->interest = buffer + 2 * capacity;
+  schedule->balance = buffer + 3 * capacity;
+  schedule->capacity = capacity;
+  schedule->count = 0;
+}
+
+/**
+ * @brief Округляет частное неотрицательного числа и положительного делителя
+ * до целого по остатку деления.
+ *
+ * @param q Частное, округлённое вниз.
+ * @param r Остаток.
+ * @param den Делитель.
+ * @param rounding Способ округления (CREDIT_ROUND_...).
+ * @return long long Округлённое частное.
+ */
+static inline long long roundQuotient(long long q, long long r, long long den,
+                                      int rounding) {
+  if ((rounding == CREDIT_ROUND_HALF_UP && 2 * r >= den) ||
+      (rounding == CREDIT_ROUND_HALF_EVEN &&
+       (2 * r > den || (2 * r == den && (q & 1)))) ||
+      (rounding == CREDIT_ROUND_UP && r > 0))
+    q++;
+  return q;
+}
+
+/**
+ * @brief Рассчитывает проценты месяца в копейках:
+ * balance * rateMicro / CREDIT_RATE_DENOM с округлением.
+ *
+ * Делитель — константа, поэтому компилятор заменяет деление умножением.
+ * Произведение почти всегда помещается в 64 бита; иначе считается в 128.
+ */
+static inline long long monthlyInterest(long long balance, long long rateMicro,
+                                        int rounding) {
+  long long num;
+  if (!__builtin_mul_overflow(balance, rateMicro, &num))
+    return roundQuotient(num / CREDIT_RATE_DENOM, num % CREDIT_RATE_DENOM,
+                         CREDIT_RATE_DENOM, rounding);
+  __int128 wide = (__int128)balance * rateMicro;
+  return roundQuotient((long long)(wide / CREDIT_RATE_DENOM),
+                       (long long)(wide % CREDIT_RATE_DENOM),
+                       CREDIT_RATE_DENOM, rounding);
+}
+
+/**
+ * @brief Округляет неотрицательную сумму в копейках до целой копейки.
+ */
+static long long roundMinor(double value, int rounding) {
+  double rounded = floor(value + 0.5);
+  if (rounding == CREDIT_ROUND_HALF_EVEN) rounded = nearbyint(value);
+  if (rounding == CREDIT_ROUND_UP) rounded = ceil(value);
+  if (rounding == CREDIT_ROUND_DOWN) rounded = floor(value);
+  return (long long)rounded;
+}
+
+/**
+ * @brief Рассчитывает график платежей в целых копейках с округлением в
+ * каждом периоде.
+ *
+ * Ставка переводится в миллионные доли процента, и проценты месяца
+ * считаются целочисленно: остаток * ставка / CREDIT_RATE_DENOM с округлением
+ * частного по rounding, без погрешностей double. Аннуитетный платёж (или доля
+ * долга при дифференцированных платежах) округляется тем же способом один
+ * раз, а последний платёж гасит весь остаток и поглощает накопленную разницу
+ * округлений. Поэтому сумма погашенного долга равна сумме кредита в точности.
+ *
+ * @param loanAmount Сумма кредита в копейках.
+ * @param loanTerm Срок кредита в месяцах.
+ * @param interestRate Годовая процентная ставка.
+ * @param type CREDIT_ANNUITY или CREDIT_DIFFERENTIAL.
+ * @param rounding Способ округления (CREDIT_ROUND_...).
+ * @param schedule График с буферами вызывающего (см. bindScheduleMinor).
+ * @return int OK или ERROR при неверных параметрах, нехватке места в буферах
+ * или если сумма платежей может не поместиться в long long.
+ */
+int calculateScheduleMinor(long long loanAmount, int loanTerm,
+                           double interestRate, int type, int rounding,
+                           loan_schedule_minor* schedule) {
+  if (schedule == NULL) return ERROR;
+  schedule->count = 0;
+  schedule->totalPayment = 0;
+  schedule->totalInterest = 0;
+  int store = schedule->payment || schedule->principal ||
+              schedule->interest || schedule->balance;
+  if (loanTerm < 1 || loanAmount < 0 || !(interestRate >= 0) ||
+      !(interestRate <= 1e6) ||
+      (type != CREDIT_ANNUITY && type != CREDIT_DIFFERENTIAL) ||
+      rounding < CREDIT_ROUND_HALF_UP || rounding > CREDIT_ROUND_DOWN ||
+      (store && schedule->capacity < loanTerm))
+    return ERROR;
+  // любой платёж не больше loanAmount * (1 + r), проценты — loanAmount * r
+  double rate = interestRate / 1200;
+  if ((double)loanAmount * (1 + rate) * loanTerm >= CREDIT_MINOR_LIMIT)
+    return ERROR;
+
+  long long rateMicro = llround(interestRate * 1e6);
+  long long level =
+      type == CREDIT_ANNUITY
+          ? roundMinor(loanAmount * annuityFactor(rate, loanTerm), rounding)
+          : roundQuotient(loanAmount / loanTerm, loanAmount % loanTerm,
+                          loanTerm, rounding);
+  long long balance = loanAmount;
+  int month = 0;
+  while (month < loanTerm) {
+    long long interest = monthlyInterest(balance, rateMicro, rounding);
+    long long principal = type == CREDIT_ANNUITY ? level - interest : level;
+    if (principal < 0) principal = 0;
+    if (month == loanTerm - 1 || principal > balance) principal = balance;
+    balance -= principal;
+    if (schedule->payment) schedule->payment[month] = principal + interest;
+    if (schedule->principal) schedule->principal[month] = principal;
+    if (schedule->interest) schedule->interest[month] = interest;
+    if (schedule->balance) schedule->balance[month] = balance;
+    schedule->totalPayment += principal + interest;
+    schedule->totalInterest += interest;
+    month++;
+    if (loanAmount > 0 && balance == 0) break;
+  }
+  schedule->count = month;
+  return OK;
+}
+
+/**
+ * @brief Вычисляет чистую приведённую стоимость потоков кредита и её
+ * производную по месячной ставке.
+ *
+ * Потоки — сумма кредита за вычетом разовой комиссии в момент выдачи и
+ * платежи с ежемесячной комиссией в конце месяцев. Многочлен от
+ * дисконтирующего множителя v = 1 / (1 + i) и его производная считаются по
+ * схеме Горнера за один проход.
+ *
+ * @param received Сумма, полученная заёмщиком.
+ * @param payments Платежи по месяцам.
+ * @param count Число платежей.
+ * @param monthlyFee Ежемесячная комиссия.
+ * @param rate Месячная ставка i > -1.
+ * @param derivative Указатель для записи производной по i.
+ * @return double Приведённая стоимость.
+ */
+static double loanNpv(double received, const double* payments, int count,
+                      double monthlyFee, double rate, double* derivative) {
+  double v = 1 / (1 + rate);
+  double value = 0, slope = 0;
+  for (int k = count - 1; k >= 0; --k) {
+    slope = slope * v + value;
+    value = value * v - (payments[k] + monthlyFee);
+  }
+  // свободный член многочлена — полученная заёмщиком сумма
+  slope = slope * v + value;
+  value = value * v + received;
+  *derivative = -slope * v * v;
+  return value;
+}
+
+/**
+ * @brief Рассчитывает эффективную годовую ставку кредита с учётом комиссий.
+ *
+ * Ищется месячная ставка i, при которой приведённая стоимость потоков
+ * равна нулю (внутренняя норма доходности), методом Ньютона с аналитической
+ * производной. Корень всё время остаётся в вилке, где стоимость меняет знак:
+ * шаг Ньютона, выходящий из вилки, заменяется делением пополам. Результат —
+ * (1 + i)^12 - 1 в процентах.
+ *
+ * @param loanAmount Сумма кредита.
+ * @param schedule График со столбцом платежей.
+ * @param fees Комиссии или NULL, если их нет.
+ * @param effectiveRate Указатель для записи ставки, % годовых.
+ * @return int OK или ERROR, если графика нет или у потоков нет ставки.
+ */
+int calculateEffectiveRate(double loanAmount, const loan_schedule* schedule,
+                           const loan_fees* fees, double* effectiveRate) {
+  *effectiveRate = NAN;
+  if (schedule == NULL || schedule->payment == NULL || schedule->count < 1)
+    return ERROR;
+  const loan_fees none = {0, 0};
+  if (fees == NULL) fees = &none;
+  double received = loanAmount - fees->upfront;
+  const double* payments = schedule->payment;
+  int count = schedule->count;
+  double paid = count * fees->monthly;
+  for (int k = 0; k < count; ++k) paid += payments[k];
+  if (!(received > 0) || !(paid > 0) || !isfinite(paid)) return ERROR;
+
+  // стоимость растёт по ставке: платежи дисконтируются сильнее; при
+  // ставке -0.999 она отрицательна, а при огромной стремится к received > 0
+  double lo = -0.999, hi = 1e6, slope = 0;
+  double rate = 2 * (paid / received - 1) / (count + 1);
+  if (!(rate > lo && rate < hi)) rate = 0;
+  int error = ERROR;
+  for (int it = 0; it < CREDIT_IRR_ITERATIONS && error != OK; ++it) {
+    double npv =
+        loanNpv(received, payments, count, fees->monthly, rate, &slope);
+    if (npv < 0)
+      lo = rate;
+    else
+      hi = rate;
+    double next = rate - npv / slope;
+    if (!(next > lo && next < hi)) next = (lo + hi) / 2;
+    if (npv == 0 || fabs(next - rate) <= CREDIT_IRR_EPS * (1 + fabs(rate)))
+      error = OK;
+    else
+      rate = next;
+  }
+  if (error == OK) {
+    *effectiveRate = expm1(12 * log1p(rate)) * 100;
+  }
+  return error;
+}
+
+/**
+ * @brief Заполняет строки тензора для пар (ставка, срок) с номерами от from
+ * до to (не включая).
+ *
+ * Коэффициент считается один раз на пару, а внутренний цикл по суммам —
+ * одни умножения без ветвлений, который компилятор векторизует.
+ */
+static void sweepRange(void* arg, int from, int to) {
+  const sweep_job* job = arg;
+  const loan_sweep* sweep = job->sweep;
+  int namounts = job->namounts;
+  for (int pair = from; pair < to; ++pair) {
+    int term = job->terms[pair % job->nterms];
+    double factor =
+        annuityFactor(job->rates[pair / job->nterms] / 12 / 100, term);
+    long offset = (long)pair * namounts;
+    double* payment = sweep->payment ? sweep->payment + offset : NULL;
+    double* total = sweep->total ? sweep->total + offset : NULL;
+    double* overpay = sweep->overpay ? sweep->overpay + offset : NULL;
+    const double* amounts = job->amounts;
+    if (payment)
+      for (int k = 0; k < namounts; ++k) payment[k] = amounts[k] * factor;
+    if (total)
+      for (int k = 0; k < namounts; ++k)
+        total[k] = amounts[k] * factor * term;
+    if (overpay)
+      for (int k = 0; k < namounts; ++k)
+        overpay[k] = amounts[k] * (factor * term - 1);
+  }
+}
+
+/**
+ * @brief Рассчитывает аннуитетные платежи для всех сочетаний ставок, сроков
+ * и сумм кредита.
+ *
+ * Результаты лежат в тензоре [ставка][срок][сумма]: элемент для rates[i],
+ * terms[j] и amounts[k] имеет номер (i * nterms + j) * namounts + k.
+ * Пары (ставка, срок) делятся между потоками общего пула (см. pool_shared).
+ * Память не выделяется; столбец результата, равный NULL, не заполняется.
+ *
+ * @param rates Годовые процентные ставки.
+ * @param nrates Число ставок.
+ * @param terms Сроки кредита в месяцах.
+ * @param nterms Число сроков.
+ * @param amounts Суммы кредита.
+ * @param namounts Число сумм.
+ * @param sweep Буферы вызывающего по nrates * nterms * namounts элементов.
+ * @return int OK или ERROR при неверных параметрах (отрицательной или
+ * нечисловой ставке, сроке меньше месяца); буферы тогда не изменяются.
+ */
+int calculateSweep(const double* rates, int nrates, const int* terms,
+                   int nterms, const double* amounts, int namounts,
+                   loan_sweep* sweep) {
+  if (sweep == NULL || nrates < 0 || nterms < 0 || namounts < 0 ||
+      (nrates && rates == NULL) || (nterms && terms == NULL) ||
+      (namounts && amounts == NULL) || (long long)nrates * nterms > INT_MAX)
+    return ERROR;
+  for (int i = 0; i < nrates; ++i)
+    if (!isfinite(rates[i]) || rates[i] < 0) return ERROR;
+  for (int j = 0; j < nterms; ++j)
+    if (terms[j] < 1) return ERROR;
+  sweep_job job = {.rates = rates,
+                   .terms = terms,
+                   .amounts = amounts,
+                   .nterms = nterms,
+                   .namounts = namounts,
+                   .sweep = sweep};
+  if (namounts > 0) pool_run(pool_shared(), nrates * nterms, sweepRange, &job);
+  return OK;
 }
@@ -5,10 +5,152 @@
 extern "C" {
 #endif
 
+//! Вид платежей по кредиту: аннуитетные (равные).
+#define CREDIT_ANNUITY 0
+
+//! Вид платежей по кредиту: дифференцированные (равные доли долга).
+#define CREDIT_DIFFERENTIAL 1
+
+//! Досрочное погашение сокращает срок кредита.
+#define CREDIT_REDUCE_TERM 0
+
+//! Досрочное погашение уменьшает ежемесячный платёж.
+#define CREDIT_REDUCE_PAYMENT 1
+
+//! Округление до ближайшей копейки, половина — от нуля.
+#define CREDIT_ROUND_HALF_UP 0
+
+//! Округление до ближайшей копейки, половина — к чётной (банковское).
+#define CREDIT_ROUND_HALF_EVEN 1
+
+//! Округление вверх до копейки.
+#define CREDIT_ROUND_UP 2
+
+//! Округление вниз до копейки.
+#define CREDIT_ROUND_DOWN 3
+
+//! Наибольшее число итераций при поиске эффективной ставки.
+#define CREDIT_IRR_ITERATIONS 100
+
+//! Относительная точность эффективной месячной ставки.
+#define CREDIT_IRR_EPS 1e-12
+
+//! Число столбцов графика платежей.
+#define CREDIT_COLUMNS 4
+
+/**
+ * @brief График платежей по кредиту в виде отдельных столбцов.
+ *
+ * Столбцы принадлежат вызывающему: движок только заполняет их, поэтому
+ * один набор буферов можно переиспользовать для любого числа расчётов.
+ * Столбец, равный NULL, не заполняется. Итоги считаются всегда. Если
+ * accumulate не равен нулю, значения прибавляются к столбцам, а не
+ * записываются в них, — так графики многих кредитов складываются в общие
+ * столбцы без промежуточных буферов.
+ */
+typedef struct loan_schedule {
+  double *payment;
+  double *principal;
+  double *interest;
+  double *balance;
+  int capacity;
+  int count;
+  int accumulate;
+  double totalPayment;
+  double totalInterest;
+} loan_schedule;
+
+/**
+ * @brief График платежей в целых копейках (минимальных единицах валюты).
+ *
+ * Устроен как loan_schedule, но все суммы — точные целые числа, как в
+ * выписке банка (см. calculateScheduleMinor).
+ */
+typedef struct loan_schedule_minor {
+  long long *payment;
+  long long *principal;
+  long long *interest;
+  long long *balance;
+  int capacity;
+  int count;
+  long long totalPayment;
+  long long totalInterest;
+} loan_schedule_minor;
+
+/**
+ * @brief Досрочное погашение: сумма вносится вместе с платежом месяца month
+ * (от 1 до срока кредита).
+ */
+typedef struct loan_prepayment {
+  int month;
+  double amount;
+  int mode;
+} loan_prepayment;
+
+/**
+ * @brief Отрезок кривой ставок: годовая ставка (или значение индекса) в
+ * процентах действует с месяца month (от 1) до начала следующего отрезка.
+ */
+typedef struct rate_segment {
+  int month;
+  double rate;
+} rate_segment;
+
+/**
+ * @brief Кривая ставок: кусочно-постоянная ставка или индекс плюс надбавка.
+ *
+ * Для ступенчатой ставки spread равен нулю; для плавающей отрезки задают
+ * значения индекса на датах пересмотра, а spread — надбавку к нему.
+ */
+typedef struct rate_curve {
+  const rate_segment *segments;
+  int count;
+  double spread;
+} rate_curve;
+
+/**
+ * @brief Комиссии по кредиту: разовая при выдаче и ежемесячная с каждым
+ * платежом.
+ */
+typedef struct loan_fees {
+  double upfront;
+  double monthly;
+} loan_fees;
+
+/**
+ * @brief Буферы пакетного расчёта аннуитетных платежей (см. calculateSweep).
+ */
+typedef struct loan_sweep {
+  double *payment;
+  double *total;
+  double *overpay;
+} loan_sweep;
+
 double* calculateDifferentialPayments(double loanAmount, int loanTerm,
                                       double interestRate);
 double calculateAnnuityPayment(double loanAmount, int loanTerm,
                                double interestRate);
+void bindSchedule(loan_schedule* schedule, double* buffer, int capacity);
+int calculateSchedule(double loanAmount, int loanTerm, double interestRate,
+                      int type, loan_schedule* schedule);
+int calculatePrepaidSchedule(double loanAmount, int loanTerm,
+                             double interestRate, int type,
+                             const loan_prepayment* events, int nevents,
+                             loan_schedule* schedule);
+int calculateCurveSchedule(double loanAmount, int loanTerm,
+                           const rate_curve* curve, int type,
+                           const loan_prepayment* events, int nevents,
+                           loan_schedule* schedule);
+void bindScheduleMinor(loan_schedule_minor* schedule, long long* buffer,
+                       int capacity);
+int calculateScheduleMinor(long long loanAmount, int loanTerm,
+                           double interestRate, int type, int rounding,
+                           loan_schedule_minor* schedule);
+int calculateEffectiveRate(double loanAmount, const loan_schedule* schedule,
+                           const loan_fees* fees, double* effectiveRate);
+int calculateSweep(const double* rates, int nrates, const int* terms,
+                   int nterms, const double* amounts, int namounts,
+                   loan_sweep* sweep);
 
 #ifdef __cplusplus
 }
@@ -101,6 +101,9 @@ int print_lexeme(stack *st, char out[]) {
     case S_OPERAND:
       r = sprintf(out, "%c", st->ival);
       break;
+    case S_AGGREGATE:
+      r = sprintf(out, "%s", s21_aggregates[st->ival]);
+      break;
     case S_FUNC:
       r = sprintf(out, "%s", s21_tfuncs[st->ival]);
     default:
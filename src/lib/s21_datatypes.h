@@ -19,15 +19,26 @@
 //! Тип данных стека: унарный операнд.
 #define S_UOPERAND '~'
 
-//! Тип данных стека: переменная 'x'.
+//! Тип данных стека: переменная ('x' или, при разборе с переменными, другая
+//! буква).
 #define S_XOPERAND 'x'
 
 //! Тип данных стека: функция.
 #define S_FUNC '?'
 
+//! Тип данных стека: имя агрегата (sum, prod, min, max) до компиляции.
+#define S_AGGREGATE 'A'
+
+//! Тип данных стека: значение скомпилированного агрегата; ival — его номер
+//! в программе.
+#define S_AGGVALUE 'a'
+
 //! Код ошибки.
 #define ERROR -1
 
+//! Код завершения: вычисление превысило лимит или было отменено.
+#define LIMITED -2
+
 //! Булево значение "истина".
 #define TRUE 1
 
@@ -57,6 +68,7 @@ typedef struct stack {
 
 stack *st_push(stack *, stack);
 stack *parse_all(const char *line);
+stack *parse_all_vars(const char *line);
 stack *st_pop(stack **head);
 stack *st_rpop(stack **root);
 void remove_stack(stack **head);
@@ -0,0 +1,457 @@
+/*!
+ * \file s21_ddouble.h
+ * \brief Вычисления с двойной-двойной точностью
+ *
+ * Число представляется неупорядоченной суммой двух double (hi + lo), что
+ * даёт около 32 значащих цифр. Сложение и умножение строятся на точных
+ * преобразованиях two_sum и two_prod и стоят лишь в несколько раз дороже
+ * обычных операций над double, в отличие от программной длинной арифметики.
+ * Этот режим нужен для выражений с катастрофическим сокращением разрядов,
+ * например (1 + x) ^ n - 1 при малых x.
+ */
+#include "s21_ddouble.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "s21_aggregate.h"
+#include "s21_budget.h"
+#include "s21_lexeme_parser.h"
+
+//! pi / 2 с двойной-двойной точностью.
+static const ddouble dd_pi_2 = {0x1.921fb54442d18p+0, 0x1.1a62633145c07p-54};
+
+//! ln(2) с двойной-двойной точностью.
+static const ddouble dd_ln2 = {0x1.62e42fefa39efp-1, 0x1.abc9e3b39803fp-56};
+
+//! ln(10) с двойной-двойной точностью.
+static const ddouble dd_ln10 = {0x1.26bb1bbb55516p+1, -0x1.f48ad494ea3e9p-53};
+
+//! Порог, ниже которого члены рядов Тейлора отбрасываются.
+#define DD_EPS 1e-34
+
+/*!
+ * \brief Точная сумма двух double: a + b = s.hi + s.lo.
+ */
+static ddouble two_sum(double a, double b) {
+  double s = a + b;
+  double bb = s - a;
+  ddouble r = {s, (a - (s - bb)) + (b - bb)};
+  return r;
+}
+
+/*!
+ * \brief Точная сумма двух double при условии |a| >= |b|.
+ */
+static ddouble quick_two_sum(double a, double b) {
+  double s = a + b;
+  ddouble r = {s, b - (s - a)};
+  return r;
+}
+
+/*!
+ * \brief Точное произведение двух double: a * b = p.hi + p.lo.
+ *
+ * При аппаратной поддержке используется fma, иначе — разбиение Деккера.
+ */
+static ddouble two_prod(double a, double b) {
+  double p = a * b;
+#ifdef FP_FAST_FMA
+  ddouble r = {p, fma(a, b, -p)};
+#else
+  const double split = 134217729.0;  // 2^27 + 1
+  double t = split * a;
+  double ah = t - (t - a), al = a - ah;
+  t = split * b;
+  double bh = t - (t - b), bl = b - bh;
+  ddouble r = {p, ((ah * bh - p) + ah * bl + al * bh) + al * bl};
+#endif
+  return r;
+}
+
+/*!
+ * \brief Преобразует double в число двойной-двойной точности.
+ */
+ddouble dd_from(double a) {
+  ddouble r = {a, 0};
+  return r;
+}
+
+/*!
+ * \brief Меняет знак числа.
+ */
+static ddouble dd_neg(ddouble a) {
+  ddouble r = {-a.hi, -a.lo};
+  return r;
+}
+
+/*!
+ * \brief Складывает два числа двойной-двойной точности.
+ */
+ddouble dd_add(ddouble a, ddouble b) {
+  ddouble s = two_sum(a.hi, b.hi);
+  if (!isfinite(s.hi)) return dd_from(s.hi);
+  ddouble t = two_sum(a.lo, b.lo);
+  s.lo += t.hi;
+  s = quick_two_sum(s.hi, s.lo);
+  s.lo += t.lo;
+  return quick_two_sum(s.hi, s.lo);
+}
+
+/*!
+ * \brief Вычитает два числа двойной-двойной точности.
+ */
+ddouble dd_sub(ddouble a, ddouble b) { return dd_add(a, dd_neg(b)); }
+
+/*!
+ * \brief Умножает два числа двойной-двойной точности.
+ */
+ddouble dd_mul(ddouble a, ddouble b) {
+  ddouble p = two_prod(a.hi, b.hi);
+  if (!isfinite(p.hi)) return dd_from(p.hi);
+  p.lo += a.hi * b.lo + a.lo * b.hi;
+  return quick_two_sum(p.hi, p.lo);
+}
+
+/*!
+ * \brief Делит два числа двойной-двойной точности.
+ *
+ * Частное уточняется тремя шагами длинного деления по старшим частям.
+ */
+ddouble dd_div(ddouble a, ddouble b) {
+  double q1 = a.hi / b.hi;
+  if (!isfinite(q1)) return dd_from(q1);
+  ddouble r = dd_sub(a, dd_mul(dd_from(q1), b));
+  double q2 = r.hi / b.hi;
+  r = dd_sub(r, dd_mul(dd_from(q2), b));
+  double q3 = r.hi / b.hi;
+  return dd_add(quick_two_sum(q1, q2), dd_from(q3));
+}
+
+/*!
+ * \brief Вычисляет квадратный корень (один шаг метода Ньютона от double).
+ */
+ddouble dd_sqrt(ddouble a) {
+  if (a.hi <= 0 || !isfinite(a.hi)) return dd_from(sqrt(a.hi));
+  double x = 1.0 / sqrt(a.hi);
+  double ax = a.hi * x;
+  ddouble diff = dd_sub(a, two_prod(ax, ax));
+  return dd_add(dd_from(ax), dd_from(diff.hi * (x * 0.5)));
+}
+
+/*!
+ * \brief Отбрасывает дробную часть числа.
+ */
+static ddouble dd_trunc(ddouble a) {
+  double hi = trunc(a.hi);
+  if (hi != a.hi || !isfinite(hi)) return dd_from(hi);
+  double lo = a.hi > 0 ? floor(a.lo) : ceil(a.lo);
+  return quick_two_sum(hi, lo);
+}
+
+/*!
+ * \brief Вычисляет экспоненту.
+ *
+ * Аргумент сводится к r = (a - k ln 2) / 512, для r суммируется ряд
+ * Тейлора exp(r) - 1, результат девять раз возводится в квадрат и умножается
+ * на 2^k.
+ */
+ddouble dd_exp(ddouble a) {
+  if (a.hi > 709.78) return dd_from(INFINITY);
+  if (a.hi < -745.13) return dd_from(0);
+  if (a.hi != a.hi) return a;
+  double k = floor(a.hi / dd_ln2.hi + 0.5);
+  ddouble r = dd_sub(a, dd_mul(dd_from(k), dd_ln2));
+  r.hi /= 512;
+  r.lo /= 512;
+
+  ddouble sum = r;
+  ddouble term = r;
+  for (int i = 2; fabs(term.hi) > DD_EPS; i++) {
+    term = dd_div(dd_mul(term, r), dd_from(i));
+    sum = dd_add(sum, term);
+  }
+  // (1 + s)^2 - 1 = 2s + s^2 сохраняет точность малых s
+  for (int i = 0; i < 9; i++)
+    sum = dd_add(dd_mul(sum, dd_from(2)), dd_mul(sum, sum));
+  sum = dd_add(sum, dd_from(1));
+  sum.hi = ldexp(sum.hi, (int)k);
+  sum.lo = ldexp(sum.lo, (int)k);
+  return sum;
+}
+
+/*!
+ * \brief Вычисляет натуральный логарифм (шаг Ньютона от double).
+ */
+ddouble dd_log(ddouble a) {
+  if (a.hi <= 0 || !isfinite(a.hi)) return dd_from(log(a.hi));
+  ddouble x = dd_from(log(a.hi));
+  x = dd_add(x, dd_mul(a, dd_exp(dd_neg(x))));
+  return dd_sub(x, dd_from(1));
+}
+
+/*!
+ * \brief Возводит число в степень.
+ *
+ * Целые показатели возводятся двоичным возведением в степень без перехода к
+ * логарифмам, остальные — через exp(b * ln(a)).
+ */
+ddouble dd_pow(ddouble a, ddouble b) {
+  ddouble r = dd_from(1);
+  if (b.lo == 0 && b.hi == trunc(b.hi) && fabs(b.hi) < 1e9) {
+    long n = (long)fabs(b.hi);
+    ddouble base = a;
+    while (n > 0) {
+      if (n & 1) r = dd_mul(r, base);
+      base = dd_mul(base, base);
+      n >>= 1;
+    }
+    if (b.hi < 0) r = dd_div(dd_from(1), r);
+  } else if (a.hi <= 0) {
+    r = dd_from(pow(a.hi, b.hi));
+  } else {
+    r = dd_exp(dd_mul(b, dd_log(a)));
+  }
+  return r;
+}
+
+/*!
+ * \brief Вычисляет остаток от деления a на b с знаком делимого.
+ */
+ddouble dd_fmod(ddouble a, ddouble b) {
+  ddouble n = dd_trunc(dd_div(a, b));
+  return dd_sub(a, dd_mul(n, b));
+}
+
+/*!
+ * \brief Вычисляет синус и косинус одного аргумента.
+ *
+ * Аргумент сводится к |r| <= pi / 4 вычитанием кратного pi / 2, затем для r
+ * суммируются ряды Тейлора, а четверть определяет знаки и перестановку.
+ */
+static void dd_sincos(ddouble a, ddouble *s, ddouble *c) {
+  if (!isfinite(a.hi)) {
+    *s = dd_from(NAN);
+    *c = dd_from(NAN);
+    return;
+  }
+  double j = round(a.hi / dd_pi_2.hi);
+  ddouble r = dd_sub(a, dd_mul(dd_from(j), dd_pi_2));
+  ddouble r2 = dd_mul(r, r);
+
+  ddouble sin_r = r, cos_r = dd_from(1);
+  ddouble ts = r, tc = dd_from(1);
+  for (int k = 1; fabs(ts.hi) > DD_EPS || fabs(tc.hi) > DD_EPS; k++) {
+    tc = dd_neg(dd_div(dd_mul(tc, r2), dd_from((2.0 * k - 1) * (2.0 * k))));
+    ts = dd_neg(dd_div(dd_mul(ts, r2), dd_from((2.0 * k) * (2.0 * k + 1))));
+    cos_r = dd_add(cos_r, tc);
+    sin_r = dd_add(sin_r, ts);
+  }
+
+  int quadrant = (int)fmod(j, 4);
+  if (quadrant < 0) quadrant += 4;
+  switch (quadrant) {
+    case 0:
+      *s = sin_r;
+      *c = cos_r;
+      break;
+    case 1:
+      *s = cos_r;
+      *c = dd_neg(sin_r);
+      break;
+    case 2:
+      *s = dd_neg(sin_r);
+      *c = dd_neg(cos_r);
+      break;
+    default:
+      *s = dd_neg(cos_r);
+      *c = sin_r;
+      break;
+  }
+}
+
+/*!
+ * \brief Вычисляет синус.
+ */
+ddouble dd_sin(ddouble a) {
+  ddouble s, c;
+  dd_sincos(a, &s, &c);
+  return s;
+}
+
+/*!
+ * \brief Вычисляет косинус.
+ */
+ddouble dd_cos(ddouble a) {
+  ddouble s, c;
+  dd_sincos(a, &s, &c);
+  return c;
+}
+
+/*!
+ * \brief Вычисляет арктангенс (шаг Ньютона для tan(z) = a от double).
+ */
+ddouble dd_atan(ddouble a) {
+  if (isinf(a.hi)) return a.hi > 0 ? dd_pi_2 : dd_neg(dd_pi_2);
+  if (a.hi != a.hi) return a;
+  ddouble z = dd_from(atan(a.hi));
+  ddouble s, c;
+  dd_sincos(z, &s, &c);
+  // z - (tan z - a) / sec^2 z = z + cos z * (a cos z - sin z)
+  return dd_add(z, dd_mul(c, dd_sub(dd_mul(a, c), s)));
+}
+
+/*!
+ * \brief Вычисляет арксинус через арктангенс.
+ */
+static ddouble dd_asin(ddouble a) {
+  ddouble one = dd_from(1);
+  if (fabs(a.hi) > 1) return dd_from(NAN);
+  if (fabs(a.hi) == 1 && a.lo == 0) return a.hi > 0 ? dd_pi_2 : dd_neg(dd_pi_2);
+  return dd_atan(dd_div(a, dd_sqrt(dd_sub(one, dd_mul(a, a)))));
+}
+
+/*!
+ * \brief Применяет бинарный оператор к двум числам двойной-двойной точности.
+ *
+ * \param op Код оператора ('+', '-', '*', '/', '^', '%').
+ * \param a Левый операнд.
+ * \param b Правый операнд.
+ * \return Результат операции.
+ */
+ddouble dd_bioperand(int op, ddouble a, ddouble b) {
+  ddouble r = dd_from(0);
+  switch (op) {
+    case '+':
+      r = dd_add(a, b);
+      break;
+    case '-':
+      r = dd_sub(a, b);
+      break;
+    case '*':
+      r = dd_mul(a, b);
+      break;
+    case '/':
+      r = dd_div(a, b);
+      break;
+    case '^':
+      r = dd_pow(a, b);
+      break;
+    case '%':
+      r = dd_fmod(a, b);
+      break;
+    default:
+      break;
+  }
+  return r;
+}
+
+/*!
+ * \brief Применяет унарный оператор или функцию к числу двойной-двойной
+ * точности.
+ *
+ * \param op Код унарного оператора ('+', '-') или номер функции из s21_tfuncs.
+ * \param a Аргумент.
+ * \return Результат применения оператора.
+ */
+ddouble dd_uoperand(int op, ddouble a) {
+  ddouble r = a;
+  ddouble s, c;
+  switch (op) {
+    case '-':
+      r = dd_neg(a);
+      break;
+    case F_SIN:
+      r = dd_sin(a);
+      break;
+    case F_COS:
+      r = dd_cos(a);
+      break;
+    case F_TAN:
+      dd_sincos(a, &s, &c);
+      r = dd_div(s, c);
+      break;
+    case F_ACOS:
+      r = dd_sub(dd_pi_2, dd_asin(a));
+      break;
+    case F_ASIN:
+      r = dd_asin(a);
+      break;
+    case F_ATAN:
+      r = dd_atan(a);
+      break;
+    case F_SQRT:
+      r = dd_sqrt(a);
+      break;
+    case F_LN:
+      r = dd_log(a);
+      break;
+    case F_LOG:
+      r = dd_div(dd_log(a), dd_ln10);
+      break;
+    default:
+      break;
+  }
+  return r;
+}
+
+/*!
+ * \brief Восстанавливает десятичную константу с двойной-двойной точностью.
+ *
+ * При разборе строки число с точкой округляется до double, и, например,
+ * 0.1 перестаёт быть ровно одной десятой. Зная число знаков после точки,
+ * можно восстановить исходную десятичную дробь N / 10^k.
+ *
+ * \param value Значение константы, округлённое до double.
+ * \param fractional Число знаков после точки в записи константы.
+ * \return Константа с двойной-двойной точностью.
+ */
+ddouble dd_const(double value, int fractional) {
+  if (fractional <= 0 || fractional > 22) return dd_from(value);
+  double scale = pow(10, fractional);  // точно представимо при k <= 22
+  ddouble scaled = two_prod(value, scale);
+  double n = round(scaled.hi + scaled.lo);
+  // для больших N ошибка разбора может превысить половину единицы
+  if (fabs(n) > 1e15) return dd_from(value);
+  return dd_div(dd_from(n), dd_from(scale));
+}
+
+/*!
+ * \brief Вычисляет программу с двойной-двойной точностью.
+ *
+ * \param prog Указатель на скомпилированную программу.
+ * \param vars Значения переменных по слотам программы (x — слот 0).
+ * \param result Указатель для записи результата.
+ * \return OK при успешном вычислении, ERROR при делении на ноль или пустой
+ * программе, LIMITED при исчерпании текущего бюджета потока.
+ */
+int calc_program_dd(const program *prog, const ddouble *vars,
+                    ddouble *result) {
+  if (prog == NULL || prog->size == 0) return ERROR;
+  if (budget_charge(prog->size) != OK) {
+    *result = dd_from(NAN);
+    return LIMITED;
+  }
+  int error = OK;
+  ddouble st[S21_MAX_DEPTH];
+  int top = -1;
+  for (int i = 0; i < prog->size; i++) {
+    const instr *in = &prog->code[i];
+    if (in->type == S_DOUBLE) {
+      st[++top] = two_sum(prog->consts[in->ival], prog->consts_lo[in->ival]);
+    } else if (in->type == S_XOPERAND) {
+      st[++top] = vars[in->ival];
+    } else if (in->type == S_AGGVALUE) {
+      int status = calc_aggregate_dd(prog, in->ival, vars, &st[++top]);
+      if (status != OK && error != LIMITED) error = status;
+    } else if (in->type == S_OPERAND) {
+      if (in->ival == '/' && st[top].hi == 0) error = ERROR;
+      st[top - 1] = dd_bioperand(in->ival, st[top - 1], st[top]);
+      top--;
+    } else {
+      st[top] = dd_uoperand(in->ival, st[top]);
+    }
+  }
+  *result = st[0];
+  return error;
+}
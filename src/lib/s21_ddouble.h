@@ -0,0 +1,36 @@
+#ifndef S21_DDOUBLE_H
+#define S21_DDOUBLE_H
+
+#include "s21_program.h"
+
+/*!
+ * \struct ddouble
+ * \brief Число двойной-двойной точности: сумма hi + lo двух double.
+ *
+ * |lo| не превышает половины единицы последнего разряда hi, поэтому пара
+ * хранит около 32 значащих десятичных цифр.
+ */
+typedef struct ddouble {
+  double hi;
+  double lo;
+} ddouble;
+
+ddouble dd_from(double a);
+ddouble dd_add(ddouble a, ddouble b);
+ddouble dd_sub(ddouble a, ddouble b);
+ddouble dd_mul(ddouble a, ddouble b);
+ddouble dd_div(ddouble a, ddouble b);
+ddouble dd_sqrt(ddouble a);
+ddouble dd_exp(ddouble a);
+ddouble dd_log(ddouble a);
+ddouble dd_pow(ddouble a, ddouble b);
+ddouble dd_fmod(ddouble a, ddouble b);
+ddouble dd_sin(ddouble a);
+ddouble dd_cos(ddouble a);
+ddouble dd_atan(ddouble a);
+ddouble dd_bioperand(int op, ddouble a, ddouble b);
+ddouble dd_uoperand(int op, ddouble a);
+ddouble dd_const(double value, int fractional);
+int calc_program_dd(const program *prog, const ddouble *vars,
+                    ddouble *result);
+#endif
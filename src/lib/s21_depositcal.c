@@ -0,0 +1,183 @@
+/**
+ *@file s21_depositcal.h
+ *@brief Методы для работы с депозитным калькулятором
+ *
+ * Проценты начисляются ежедневно по ставке interestRate / 365 на остаток
+ * вклада и выплачиваются (или капитализируются) в конце каждого периода.
+ * Остаток меняется только при пополнениях, снятиях и капитализации, поэтому
+ * между событиями несколько целых периодов считаются сразу, в замкнутом
+ * виде: с капитализацией остаток растёт в (1 + r * p)^m раз, без неё
+ * проценты равны остаток * r * p * m. Стоимость расчёта зависит только от
+ * числа событий, а не от числа дней или периодов.
+ */
+#include "s21_depositcal.h"
+
+#include <math.h>
+#include <stddef.h>
+
+#include "s21_datatypes.h"
+
+/**
+ * @brief Состояние вклада при проходе по событиям.
+ */
+typedef struct deposit_state {
+  double balance;
+  double accrued;
+  double rate;
+  int day;
+  int period;
+  int nextPayout;
+  int capitalization;
+  deposit_result* result;
+} deposit_state;
+
+/**
+ * @brief Проверяет список событий: дни в пределах срока и по неубыванию,
+ * неотрицательные суммы.
+ */
+static int checkEvents(const deposit_event* events, int count, int term) {
+  if (count < 0 || (count > 0 && events == NULL)) return ERROR;
+  int last = 0;
+  for (int i = 0; i < count; ++i) {
+    if (events[i].day < last || events[i].day > term ||
+        !(events[i].amount >= 0) || !isfinite(events[i].amount))
+      return ERROR;
+    last = events[i].day;
+  }
+  return OK;
+}
+
+/**
+ * @brief Выплачивает или капитализирует проценты, накопленные за период.
+ */
+static void payOut(deposit_state* s) {
+  s->result->interest += s->accrued;
+  if (s->capitalization)
+    s->balance += s->accrued;
+  else
+    s->result->paidOut += s->accrued;
+  s->accrued = 0;
+}
+
+/**
+ * @brief Начисляет проценты с текущего дня до дня day.
+ *
+ * Сначала закрывается начатый период, затем целые периоды считаются одной
+ * формулой, и остаток дней копится до следующей выплаты.
+ *
+ * @param s Состояние вклада.
+ * @param day День, до которого начисляются проценты.
+ */
+static void accrueUntil(deposit_state* s, int day) {
+  if (s->nextPayout <= day) {
+    s->accrued += s->balance * s->rate * (s->nextPayout - s->day);
+    payOut(s);
+    s->day = s->nextPayout;
+    int whole = (day - s->day) / s->period;
+    if (whole > 0) {
+      double interest;
+      if (s->capitalization) {
+        interest = s->balance * expm1(whole * log1p(s->rate * s->period));
+        s->balance += interest;
+      } else {
+        interest = s->balance * s->rate * s->period * whole;
+        s->result->paidOut += interest;
+      }
+      s->result->interest += interest;
+      s->day += whole * s->period;
+    }
+    s->nextPayout = s->day + s->period;
+  }
+  s->accrued += s->balance * s->rate * (day - s->day);
+  s->day = day;
+}
+
+/**
+ * @brief Рассчитывает доходность вклада с пополнениями и снятиями.
+ *
+ * Пополнения и снятия сливаются в один упорядоченный по дням проход. Снятие
+ * больше остатка уменьшает остаток до нуля. В последний день срока
+ * выплачиваются проценты неполного периода.
+ *
+ * @param params Условия вклада.
+ * @param result Указатель для записи итогов.
+ * @return int OK или ERROR при неверных условиях или неупорядоченных
+ * событиях.
+ */
+int calculateDeposit(const deposit_params* params, deposit_result* result) {
+  if (params == NULL || result == NULL) return ERROR;
+  result->interest = 0;
+  result->tax = 0;
+  result->paidOut = 0;
+  result->balance = 0;
+  const deposit_params* p = params;
+  if (p->term < 1 || !(p->amount >= 0) || !isfinite(p->amount) ||
+      !(p->interestRate >= 0) || !(p->taxRate >= 0 && p->taxRate <= 100) ||
+      !(p->taxFree >= 0) || p->period < 0 ||
+      checkEvents(p->replenishments, p->nreplenishments, p->term) != OK ||
+      checkEvents(p->withdrawals, p->nwithdrawals, p->term) != OK)
+    return ERROR;
+
+  int period = p->period == DEPOSIT_AT_END || p->period > p->term
+                   ? p->term
+                   : p->period;
+  deposit_state s = {.balance = p->amount,
+                     .rate = p->interestRate / 100 / DEPOSIT_YEAR_DAYS,
+                     .period = period,
+                     .nextPayout = period,
+                     .capitalization = p->capitalization,
+                     .result = result};
+  int r = 0, w = 0;
+  while (r < p->nreplenishments || w < p->nwithdrawals) {
+    int day = p->term;
+    if (r < p->nreplenishments) day = p->replenishments[r].day;
+    if (w < p->nwithdrawals && p->withdrawals[w].day < day)
+      day = p->withdrawals[w].day;
+    accrueUntil(&s, day);
+    for (; r < p->nreplenishments && p->replenishments[r].day == day; ++r)
+      s.balance += p->replenishments[r].amount;
+    for (; w < p->nwithdrawals && p->withdrawals[w].day == day; ++w)
+      s.balance = fmax(s.balance - p->withdrawals[w].amount, 0);
+  }
+  accrueUntil(&s, p->term);
+  payOut(&s);
+  result->balance = s.balance;
+  result->tax = fmax(result->interest - p->taxFree, 0) * p->taxRate / 100;
+  return OK;
+}
+
+/**
+ * @brief Начисляет проценты на конец дня по счетам книги вкладов.
+ *
+ * Каждый счёт считается тем же расчётом, что и отдельный вклад
+ * (calculateDeposit) без событий, и результат округляется до копеек.
+ *
+ * @param accounts Счета.
+ * @param count Число счетов.
+ * @param accruals Массив на count итогов; для неверного счёта обе суммы
+ * равны DEPOSIT_INVALID.
+ * @return int OK или ERROR, если хотя бы один счёт неверен.
+ */
+int accrueDeposits(const deposit_account* accounts, long count,
+                   deposit_accrual* accruals) {
+  int error = OK;
+  for (long i = 0; i < count; ++i) {
+    const deposit_account* a = &accounts[i];
+    deposit_params params = {
+        .amount = a->balance,
+        .term = a->days,
+        .interestRate = a->interestRate,
+        .taxRate = a->taxRate,
+        .period = a->capitalization ? DEPOSIT_DAILY : DEPOSIT_AT_END,
+        .capitalization = a->capitalization};
+    deposit_result result;
+    if (calculateDeposit(&params, &result) == OK) {
+      accruals[i].interest = llround(result.interest * 100);
+      accruals[i].tax = llround(result.tax * 100);
+    } else {
+      accruals[i].interest = accruals[i].tax = DEPOSIT_INVALID;
+      error = ERROR;
+    }
+  }
+  return error;
+}
@@ -0,0 +1,108 @@
+#ifndef S21_DEPOSITCAL_H
+#define S21_DEPOSITCAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! Число дней в году для начисления процентов.
+#define DEPOSIT_YEAR_DAYS 365
+
+//! Периодичность выплат: ежедневно.
+#define DEPOSIT_DAILY 1
+
+//! Периодичность выплат: еженедельно.
+#define DEPOSIT_WEEKLY 7
+
+//! Периодичность выплат: ежемесячно (период — 30 дней).
+#define DEPOSIT_MONTHLY 30
+
+//! Периодичность выплат: ежеквартально (период — 91 день).
+#define DEPOSIT_QUARTERLY 91
+
+//! Периодичность выплат: раз в полгода (период — 182 дня).
+#define DEPOSIT_HALF_YEARLY 182
+
+//! Периодичность выплат: ежегодно.
+#define DEPOSIT_YEARLY DEPOSIT_YEAR_DAYS
+
+//! Периодичность выплат: в конце срока.
+#define DEPOSIT_AT_END 0
+
+//! Результат начисления по неверному счёту (верные суммы неотрицательны).
+#define DEPOSIT_INVALID -1
+
+/**
+ * @brief Счёт книги вкладов для начисления на конец дня; в двоичном файле
+ * счета лежат подряд в порядке байтов машины.
+ *
+ * Проценты начисляются за days дней (обычно 1, после выходных больше);
+ * с капитализацией — ежедневной.
+ */
+typedef struct deposit_account {
+  double balance;
+  double interestRate;
+  double taxRate;
+  int days;
+  int capitalization;
+} deposit_account;
+
+/**
+ * @brief Итог начисления по счёту в копейках: проценты и налог с них.
+ */
+typedef struct deposit_accrual {
+  long long interest;
+  long long tax;
+} deposit_accrual;
+
+/**
+ * @brief Пополнение или частичное снятие: сумма вносится или снимается в
+ * конце дня day (от 0 до срока вклада).
+ */
+typedef struct deposit_event {
+  int day;
+  double amount;
+} deposit_event;
+
+/**
+ * @brief Условия вклада.
+ *
+ * Срок задаётся в днях, ставки — в процентах годовых. period — длина
+ * периода выплат в днях (DEPOSIT_DAILY ... DEPOSIT_YEARLY) или
+ * DEPOSIT_AT_END. Налог берётся с процентов сверх необлагаемой суммы
+ * taxFree. Списки пополнений и снятий упорядочены по дню.
+ */
+typedef struct deposit_params {
+  double amount;
+  int term;
+  double interestRate;
+  double taxRate;
+  double taxFree;
+  int period;
+  int capitalization;
+  const deposit_event *replenishments;
+  int nreplenishments;
+  const deposit_event *withdrawals;
+  int nwithdrawals;
+} deposit_params;
+
+/**
+ * @brief Итоги вклада: начисленные проценты, налог, выплаченные (не
+ * капитализированные) проценты и сумма на вкладе к концу срока.
+ */
+typedef struct deposit_result {
+  double interest;
+  double tax;
+  double paidOut;
+  double balance;
+} deposit_result;
+
+int calculateDeposit(const deposit_params* params, deposit_result* result);
+int accrueDeposits(const deposit_account* accounts, long count,
+                   deposit_accrual* accruals);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // S21_DEPOSITCAL_H
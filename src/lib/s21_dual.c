@@ -0,0 +1,315 @@
+/*!
+ * \file s21_dual.h
+ * \brief Вычисление программы с автоматическим дифференцированием
+ *
+ * Программа вычисляется на дуальных числах (прямой режим автоматического
+ * дифференцирования): вместе со значением f(x) за один проход получаются
+ * f'(x) и, при необходимости, f''(x). Производные точные, в отличие от
+ * конечных разностей, и не требуют дополнительных вычислений выражения.
+ */
+#include "s21_dual.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "s21_aggregate.h"
+#include "s21_budget.h"
+#include "s21_lexeme_parser.h"
+#include "s21_polish.h"
+
+/*!
+ * \brief Применяет правило дифференцирования сложной функции.
+ *
+ * Для f(u) записывает в u значение f, первую производную f'(u) * u' и
+ * вторую f''(u) * u'^2 + f'(u) * u''. Нулевые производные аргумента не
+ * умножаются, чтобы константа не превращалась в NaN там, где f' бесконечна.
+ *
+ * \param u Аргумент, в него же записывается результат.
+ * \param f0 Значение f(u).
+ * \param f1 Значение f'(u).
+ * \param f2 Значение f''(u).
+ * \param order Порядок производных (1 или 2).
+ */
+static void dual_chain(dual *u, double f0, double f1, double f2, int order) {
+  double d1 = u->d1 != 0 ? f1 * u->d1 : 0;
+  if (order > 1) {
+    double d2 = u->d1 != 0 ? f2 * u->d1 * u->d1 : 0;
+    if (u->d2 != 0) d2 += f1 * u->d2;
+    u->d2 = d2;
+  }
+  u->v = f0;
+  u->d1 = d1;
+}
+
+/*!
+ * \brief Применяет унарный оператор или функцию к дуальному числу.
+ *
+ * \param op Код унарного оператора или номер функции.
+ * \param a Аргумент, в него же записывается результат.
+ * \param order Порядок производных (1 или 2).
+ */
+static void dual_uoperand(int op, dual *a, int order) {
+  double u = a->v;
+  double t = 0;
+  switch (op) {
+    case '-':
+      a->v = -a->v;
+      a->d1 = -a->d1;
+      a->d2 = -a->d2;
+      break;
+    case F_SIN:
+      dual_chain(a, sin(u), cos(u), -sin(u), order);
+      break;
+    case F_COS:
+      dual_chain(a, cos(u), -sin(u), -cos(u), order);
+      break;
+    case F_TAN:
+      t = tan(u);
+      dual_chain(a, t, 1 + t * t, 2 * t * (1 + t * t), order);
+      break;
+    case F_ACOS:
+      t = 1 - u * u;
+      dual_chain(a, acos(u), -1 / sqrt(t), -u / (t * sqrt(t)), order);
+      break;
+    case F_ASIN:
+      t = 1 - u * u;
+      dual_chain(a, asin(u), 1 / sqrt(t), u / (t * sqrt(t)), order);
+      break;
+    case F_ATAN:
+      t = 1 + u * u;
+      dual_chain(a, atan(u), 1 / t, -2 * u / (t * t), order);
+      break;
+    case F_SQRT:
+      t = sqrt(u);
+      dual_chain(a, t, 0.5 / t, -0.25 / (t * t * t), order);
+      break;
+    case F_LN:
+      dual_chain(a, log(u), 1 / u, -1 / (u * u), order);
+      break;
+    case F_LOG:
+      dual_chain(a, log10(u), 1 / (u * M_LN10), -1 / (u * u * M_LN10), order);
+      break;
+    default:
+      break;
+  }
+}
+
+/*!
+ * \brief Возводит дуальное число в степень.
+ *
+ * Если показатель не зависит от x, используется степенное правило, которое
+ * работает и для отрицательного основания с целым показателем. Иначе
+ * степень дифференцируется как exp(b * ln(a)).
+ *
+ * \param a Основание, в него же записывается результат.
+ * \param b Показатель степени.
+ * \param order Порядок производных (1 или 2).
+ */
+static void dual_pow(dual *a, const dual *b, int order) {
+  if (b->d1 == 0 && b->d2 == 0) {
+    double p = b->v;
+    // при нулевом коэффициенте производная равна нулю и в нуле, где
+    // pow(0, p - 1) или pow(0, p - 2) бесконечны
+    double c2 = p * (p - 1);
+    dual_chain(a, pow(a->v, p), p == 0 ? 0 : p * pow(a->v, p - 1),
+               c2 == 0 ? 0 : c2 * pow(a->v, p - 2), order);
+  } else {
+    double f = pow(a->v, b->v);
+    double la = log(a->v);
+    double g1 = b->d1 * la + b->v * a->d1 / a->v;
+    if (order > 1) {
+      double g2 = b->d2 * la + 2 * b->d1 * a->d1 / a->v +
+                  b->v * (a->d2 * a->v - a->d1 * a->d1) / (a->v * a->v);
+      a->d2 = f * (g2 + g1 * g1);
+    }
+    a->d1 = f * g1;
+    a->v = f;
+  }
+}
+
+/*!
+ * \brief Применяет бинарный оператор к двум дуальным числам.
+ *
+ * \param op Код оператора.
+ * \param a Левый операнд, в него же записывается результат.
+ * \param b Правый операнд.
+ * \param order Порядок производных (1 или 2).
+ */
+static void dual_bioperand(int op, dual *a, const dual *b, int order) {
+  double q = 0;
+  switch (op) {
+    case '+':
+      a->v += b->v;
+      a->d1 += b->d1;
+      a->d2 += b->d2;
+      break;
+    case '-':
+      a->v -= b->v;
+      a->d1 -= b->d1;
+      a->d2 -= b->d2;
+      break;
+    case '*':
+      if (order > 1) a->d2 = a->d2 * b->v + 2 * a->d1 * b->d1 + a->v * b->d2;
+      a->d1 = a->d1 * b->v + a->v * b->d1;
+      a->v *= b->v;
+      break;
+    case '/':
+      q = a->v / b->v;
+      a->d1 = (a->d1 - q * b->d1) / b->v;
+      if (order > 1) a->d2 = (a->d2 - 2 * a->d1 * b->d1 - q * b->d2) / b->v;
+      a->v = q;
+      break;
+    case '^':
+      dual_pow(a, b, order);
+      break;
+    case '%':
+      q = trunc(a->v / b->v);
+      a->v = fmod(a->v, b->v);
+      a->d1 -= q * b->d1;
+      a->d2 -= q * b->d2;
+      break;
+    default:
+      break;
+  }
+}
+
+/*!
+ * \brief Выполняет одну инструкцию программы над стеком дуальных чисел.
+ *
+ * \param prog Указатель на программу.
+ * \param in Указатель на инструкцию.
+ * \param st Стек дуальных чисел.
+ * \param top Указатель на индекс вершины стека.
+ * \param x Значение переменной x.
+ * \param vars Дуальные значения переменных по слотам или NULL: тогда
+ * производная берётся по x, а остальные переменные равны нулю.
+ * \param order Порядок производных (1 или 2).
+ */
+static void dual_step(const program *prog, const instr *in, dual *st,
+                      int *top, double x, const dual *vars, int order) {
+  if (in->type == S_DOUBLE) {
+    dual c = {prog->consts[in->ival], 0, 0};
+    st[++(*top)] = c;
+  } else if (in->type == S_XOPERAND) {
+    dual v = {in->ival == 0 ? x : 0, in->ival == 0, 0};
+    st[++(*top)] = vars ? vars[in->ival] : v;
+  } else if (in->type == S_AGGVALUE) {
+    dual seeded[S21_MAX_VARS] = {{x, 1, 0}};
+    calc_aggregate_dual(prog, in->ival, vars ? vars : seeded, order,
+                        &st[++(*top)]);
+  } else if (in->type == S_OPERAND) {
+    (*top)--;
+    dual_bioperand(in->ival, &st[*top], &st[*top + 1], order);
+  } else {
+    dual_uoperand(in->ival, &st[*top], order);
+  }
+}
+
+/*!
+ * \brief Вычисляет программу на дуальных числах в одной точке.
+ */
+static int dual_run(const program *prog, double x, const dual *vars,
+                    int order, dual *result) {
+  if (prog == NULL || prog->size == 0) return ERROR;
+  dual failed = {NAN, NAN, NAN};
+  if (budget_charge(prog->size) != OK) {
+    *result = failed;
+    return LIMITED;
+  }
+  int error = OK;
+  dual st[S21_MAX_DEPTH];
+  int top = -1;
+  for (int i = 0; i < prog->size; i++) {
+    const instr *in = &prog->code[i];
+    if (in->type == S_OPERAND && in->ival == '/' && st[top].v == 0)
+      error = ERROR;
+    dual_step(prog, in, st, &top, x, vars, order);
+  }
+  *result = st[0];
+  // агрегаты сообщают об исчерпании бюджета только через сам бюджет
+  if (prog->naggs && budget_status(budget_current()) != OK) error = LIMITED;
+  return error;
+}
+
+/*!
+ * \brief Вычисляет значение программы и её производные в точке x.
+ *
+ * \param prog Указатель на скомпилированную программу.
+ * \param x Значение переменной x.
+ * \param order Порядок производных: 1 — только f'(x), 2 — ещё и f''(x).
+ * \param result Указатель на дуальное число для записи результата.
+ * \return OK при успешном вычислении, ERROR при делении на ноль или пустой
+ * программе, LIMITED при исчерпании текущего бюджета потока.
+ */
+int calc_program_dual(const program *prog, double x, int order,
+                      dual *result) {
+  return dual_run(prog, x, NULL, order, result);
+}
+
+/*!
+ * \brief Вычисляет значение программы и её производные для заданных
+ * дуальных значений переменных.
+ *
+ * Производные берутся по тому параметру, по которому продифференцированы
+ * значения vars (обычно vars[0] = {x, 1, 0}).
+ *
+ * \param prog Указатель на скомпилированную программу.
+ * \param vars Дуальные значения переменных по слотам.
+ * \param order Порядок производных: 1 или 2.
+ * \param result Указатель на дуальное число для записи результата.
+ * \return OK при успешном вычислении, ERROR при делении на ноль или пустой
+ * программе, LIMITED при исчерпании текущего бюджета потока.
+ */
+int calc_program_dual_vars(const program *prog, const dual *vars, int order,
+                           dual *result) {
+  return dual_run(prog, 0, vars, order, result);
+}
+
+/*!
+ * \brief Вычисляет значение программы и её производные для массива точек.
+ *
+ * Как и calc_program_batch, обрабатывает точки блоками по S21_CHUNK,
+ * выполняя каждую инструкцию сразу для всего блока.
+ *
+ * \param prog Указатель на скомпилированную программу.
+ * \param x Массив значений переменной x.
+ * \param order Порядок производных: 1 или 2.
+ * \param y Массив для записи результатов, не меньше n элементов.
+ * \param n Количество точек.
+ * \return OK при успешном вычислении, LIMITED при исчерпании текущего
+ * бюджета потока, иначе ERROR.
+ */
+int calc_program_dual_batch(const program *prog, const double *x, int order,
+                            dual *y, int n) {
+  if (prog == NULL || prog->size == 0 || n < 0) return ERROR;
+  dual *regs = malloc(sizeof(dual) * prog->depth * S21_CHUNK);
+  if (regs == NULL) return ERROR;
+
+  int error = OK;
+  for (int start = 0; start < n; start += S21_CHUNK) {
+    int len = n - start < S21_CHUNK ? n - start : S21_CHUNK;
+    if (error == OK && budget_charge((long long)prog->size * len) != OK)
+      error = LIMITED;
+    if (error == LIMITED) {
+      dual failed = {NAN, NAN, NAN};
+      for (int k = 0; k < len; k++) y[start + k] = failed;
+      continue;
+    }
+    int top = -1;
+    for (int i = 0; i < prog->size; i++) {
+      const instr *in = &prog->code[i];
+      int next = top;
+      for (int k = 0; k < len; k++) {
+        // регистры блока лежат по точкам: у каждой точки свой стек
+        next = top;
+        dual_step(prog, in, regs + k * prog->depth, &next, x[start + k],
+                  NULL, order);
+      }
+      top = next;
+    }
+    for (int k = 0; k < len; k++) y[start + k] = regs[k * prog->depth];
+  }
+  free(regs);
+  if (budget_status(budget_current()) != OK) error = LIMITED;
+  return error;
+}
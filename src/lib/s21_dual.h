@@ -0,0 +1,22 @@
+#ifndef S21_DUAL_H
+#define S21_DUAL_H
+
+#include "s21_program.h"
+
+/*!
+ * \struct dual
+ * \brief Значение функции вместе с первой и второй производными по x.
+ */
+typedef struct dual {
+  double v;
+  double d1;
+  double d2;
+} dual;
+
+int calc_program_dual(const program *prog, double x, int order,
+                      dual *result);
+int calc_program_dual_vars(const program *prog, const dual *vars, int order,
+                           dual *result);
+int calc_program_dual_batch(const program *prog, const double *x, int order,
+                            dual *y, int n);
+#endif
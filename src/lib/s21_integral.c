@@ -0,0 +1,232 @@
+/*!
+ * \file s21_integral.h
+ * \brief Адаптивное численное интегрирование скомпилированных выражений
+ *
+ * Интеграл вычисляется квадратурой Гаусса–Кронрода по 15 точкам (G7K15):
+ * разница между правилами Кронрода и Гаусса служит оценкой погрешности на
+ * каждом подынтервале. Подынтервалы с наибольшей погрешностью делятся
+ * пополам, причём узлы всех новых подынтервалов вычисляются за один вызов
+ * пакетного вычислителя.
+ */
+#include "s21_integral.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "s21_budget.h"
+
+//! Число узлов квадратуры Кронрода на подынтервале.
+#define I_NODES 15
+
+//! Узлы Кронрода (положительная половина, последний — центр).
+static const double xgk[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.000000000000000000000000000000000};
+
+//! Веса Кронрода для узлов xgk.
+static const double wgk[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+
+//! Веса Гаусса для узлов xgk[1], xgk[3], xgk[5] и центра.
+static const double wg[4] = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+
+/*!
+ * \struct segment
+ * \brief Подынтервал с оценкой интеграла и погрешности на нём.
+ */
+typedef struct segment {
+  double a;
+  double b;
+  double value;
+  double err;
+} segment;
+
+/*!
+ * \brief Вычисляет интеграл и погрешность на группе подынтервалов.
+ *
+ * Узлы всех подынтервалов группы собираются в один массив и вычисляются
+ * одним вызовом calc_program_batch.
+ *
+ * \param prog Указатель на программу.
+ * \param segs Массив подынтервалов.
+ * \param idx Индексы подынтервалов, которые нужно вычислить.
+ * \param count Количество индексов.
+ * \param x Буфер узлов, не меньше count * I_NODES элементов.
+ * \param y Буфер значений, не меньше count * I_NODES элементов.
+ */
+static void eval_segments(const program *prog, segment *segs, const int *idx,
+                          int count, double *x, double *y) {
+  for (int i = 0; i < count; i++) {
+    const segment *s = &segs[idx[i]];
+    double c = 0.5 * (s->a + s->b);
+    double h = 0.5 * (s->b - s->a);
+    double *px = x + i * I_NODES;
+    for (int j = 0; j < 7; j++) {
+      px[j] = c - h * xgk[j];
+      px[7 + j] = c + h * xgk[j];
+    }
+    px[14] = c;
+  }
+  calc_program_batch(prog, x, y, count * I_NODES);
+
+  for (int i = 0; i < count; i++) {
+    segment *s = &segs[idx[i]];
+    const double *py = y + i * I_NODES;
+    double h = 0.5 * (s->b - s->a);
+    double kronrod = wgk[7] * py[14];
+    double gauss = wg[3] * py[14];
+    for (int j = 0; j < 7; j++) {
+      double pair = py[j] + py[7 + j];
+      kronrod += wgk[j] * pair;
+      if (j % 2 == 1) gauss += wg[j / 2] * pair;
+    }
+    s->value = kronrod * h;
+    s->err = fabs((kronrod - gauss) * h);
+  }
+}
+
+/*!
+ * \brief Вычисляет определённый интеграл выражения по переменной x.
+ *
+ * \param prog Указатель на скомпилированную программу.
+ * \param a Нижний предел интегрирования.
+ * \param b Верхний предел интегрирования.
+ * \param eps Требуемая относительная точность (0 — I_DEFAULT_EPS). Для
+ * интегралов меньше единицы по модулю точность считается абсолютной.
+ * \param result Указатель для записи значения интеграла.
+ * \param abserr Указатель для записи оценки абсолютной погрешности (может
+ * быть NULL).
+ * \return OK, если требуемая точность достигнута, LIMITED при исчерпании
+ * текущего бюджета потока, иначе ERROR (в result и abserr при этом
+ * записывается лучшая полученная оценка).
+ */
+int integrate_program(const program *prog, double a, double b, double eps,
+                      double *result, double *abserr) {
+  if (prog == NULL || prog->size == 0) return ERROR;
+  if (eps <= 0) eps = I_DEFAULT_EPS;
+
+  segment *segs = malloc(sizeof(segment) * I_MAX_INTERVALS);
+  int *idx = malloc(sizeof(int) * I_MAX_INTERVALS);
+  double *x = malloc(sizeof(double) * I_MAX_INTERVALS * I_NODES);
+  double *y = malloc(sizeof(double) * I_MAX_INTERVALS * I_NODES);
+  int error = (segs && idx && x && y) ? OK : ERROR;
+  double value = NAN, err = NAN;
+
+  if (error == OK) {
+    segment whole = {a, b, 0, 0};
+    segs[0] = whole;
+    idx[0] = 0;
+    int nseg = 1;
+    eval_segments(prog, segs, idx, 1, x, y);
+    while (1) {
+      value = 0;
+      err = 0;
+      for (int i = 0; i < nseg; i++) {
+        value += segs[i].value;
+        err += segs[i].err;
+      }
+      double target = eps * fmax(1, fabs(value));
+      if (!isfinite(value) || !isfinite(err)) {
+        error = ERROR;
+        break;
+      }
+      if (err <= target) break;
+
+      // делим подынтервалы, погрешность которых больше их доли допуска
+      int count = 0;
+      int limit = nseg;
+      for (int i = 0; i < limit && nseg < I_MAX_INTERVALS; i++) {
+        if (segs[i].err <= target / limit) continue;
+        double mid = 0.5 * (segs[i].a + segs[i].b);
+        segment right = {mid, segs[i].b, 0, 0};
+        segs[i].b = mid;
+        segs[nseg] = right;
+        idx[count++] = i;
+        idx[count++] = nseg++;
+      }
+      if (count == 0) {
+        error = ERROR;
+        break;
+      }
+      eval_segments(prog, segs, idx, count, x, y);
+    }
+  }
+
+  if (budget_status(budget_current()) != OK) error = LIMITED;
+  *result = value;
+  if (abserr) *abserr = err;
+  free(segs);
+  free(idx);
+  free(x);
+  free(y);
+  return error;
+}
+
+/*!
+ * \brief Вычисляет интеграл по одному шагу равномерной сетки.
+ *
+ * Внутри сетки используется формула четвёртого порядка по четырём соседним
+ * точкам, у краёв — односторонняя формула третьего порядка, рядом с
+ * пропусками — формула трапеций.
+ *
+ * \param y Значения функции на сетке.
+ * \param n Количество точек.
+ * \param i Номер левого конца шага.
+ * \param h Шаг сетки.
+ * \return Интеграл от y на [x_i, x_{i+1}] или NaN, если концы не определены.
+ */
+static double step_integral(const double *y, int n, int i, double h) {
+  double r = NAN;
+  if (!isfinite(y[i]) || !isfinite(y[i + 1])) return r;
+  int left = i > 0 && isfinite(y[i - 1]);
+  int right = i + 2 < n && isfinite(y[i + 2]);
+  if (left && right)
+    r = h / 24 * (13 * (y[i] + y[i + 1]) - y[i - 1] - y[i + 2]);
+  else if (right)
+    r = h / 12 * (5 * y[i] + 8 * y[i + 1] - y[i + 2]);
+  else if (left)
+    r = h / 12 * (5 * y[i + 1] + 8 * y[i] - y[i - 1]);
+  else
+    r = h / 2 * (y[i] + y[i + 1]);
+  return r;
+}
+
+/*!
+ * \brief Вычисляет первообразную F(x) = ∫ f от x_0 до x по значениям на
+ * равномерной сетке.
+ *
+ * Первообразная считается за один проход префиксной суммой интегралов по
+ * шагам сетки, поэтому повторно интегрировать от x_0 для каждой точки не
+ * нужно. Суммирование компенсированное (Кэхэн), чтобы ошибка округления не
+ * накапливалась на длинных сетках. Шаги, где функция не определена,
+ * пропускаются: в этих точках F равна NaN, а дальше накопление продолжается.
+ *
+ * \param y Значения функции в точках x_0 + i * h.
+ * \param n Количество точек.
+ * \param h Шаг сетки.
+ * \param F Массив для записи первообразной, не меньше n элементов.
+ * \return OK или ERROR при неверных аргументах.
+ */
+int cumulative_integral(const double *y, int n, double h, double *F) {
+  if (y == NULL || F == NULL || n < 1) return ERROR;
+  double sum = 0, carry = 0;
+  F[0] = isfinite(y[0]) ? 0 : NAN;
+  for (int i = 0; i + 1 < n; i++) {
+    double step = step_integral(y, n, i, h);
+    if (isfinite(step)) {
+      double t = step - carry;
+      double next = sum + t;
+      carry = (next - sum) - t;
+      sum = next;
+    }
+    F[i + 1] = isfinite(y[i + 1]) ? sum : NAN;
+  }
+  return OK;
+}
@@ -0,0 +1,15 @@
+#ifndef S21_INTEGRAL_H
+#define S21_INTEGRAL_H
+
+#include "s21_program.h"
+
+//! Требуемая относительная точность интегрирования по умолчанию.
+#define I_DEFAULT_EPS 1e-10
+
+//! Максимальное число подынтервалов адаптивного интегрирования.
+#define I_MAX_INTERVALS 4096
+
+int integrate_program(const program *prog, double a, double b, double eps,
+                      double *result, double *abserr);
+int cumulative_integral(const double *y, int n, double h, double *F);
+#endif
@@ -16,6 +16,8 @@
 const char* s21_tfuncs[] = {"sin",  "cos", "tan", "acos", "asin", "atan",
                             "sqrt", "ln",  "log", "mod",  "\0"};
 
+const char* s21_aggregates[] = {"sum", "prod", "min", "max", "\0"};
+
 /*!
  * \brief Добавляет лексему в стек.
  *
@@ -34,15 +36,14 @@ void add_lexeme(stack** head, stack buffer) {
 }
 
 /*!
- * \brief Анализирует строку и создает стек лексем.
- *
- * Функция обрабатывает входную строку и преобразует ее в стек лексем,
- * представляющих числа, функции и операторы.
+ * \brief Разбирает строку в стек лексем.
  *
  * \param line Входная строка для анализа.
+ * \param vars TRUE, если кроме x разрешены переменные из одной строчной
+ * латинской буквы.
  * \return Указатель на вершину стека лексем или NULL в случае ошибки.
  */
-stack* parse_all(const char* line) {
+static stack* parse_line(const char* line, int vars) {
   stack* head = NULL;
   int error = OK;
   error = comma_check(line);
@@ -56,6 +57,8 @@ stack* parse_all(const char* line) {
 
     if (code == ERROR) code = parse_number(line, &head);
     if (code == ERROR) code = parse_func(line, &head);
+    if (code == ERROR) code = parse_aggregate(line, &head);
+    if (code == ERROR && vars) code = parse_variable(*line, &head);
     if (code == ERROR) code = parse_operator(*line, &head);
 
     if (code != ERROR)
@@ -69,6 +72,45 @@ stack* parse_all(const char* line) {
   return error == OK ? head : NULL;
 }
 
+/*!
+ * \brief Анализирует строку и создает стек лексем.
+ *
+ * Функция обрабатывает входную строку и преобразует ее в стек лексем,
+ * представляющих числа, функции и операторы.
+ *
+ * \param line Входная строка для анализа.
+ * \return Указатель на вершину стека лексем или NULL в случае ошибки.
+ */
+stack* parse_all(const char* line) { return parse_line(line, FALSE); }
+
+/*!
+ * \brief Анализирует строку с переменными и создает стек лексем.
+ *
+ * В отличие от parse_all, любая строчная латинская буква, не начинающая имя
+ * функции, считается переменной. Значения переменных подставляются при
+ * вычислении скомпилированной программы.
+ *
+ * \param line Входная строка для анализа.
+ * \return Указатель на вершину стека лексем или NULL в случае ошибки.
+ */
+stack* parse_all_vars(const char* line) { return parse_line(line, TRUE); }
+
+/*!
+ * \brief Анализирует символ на предмет является ли он переменной.
+ *
+ * \param ch Символ для анализа.
+ * \param head Двойной указатель на вершину стека.
+ * \return OK, если символ является переменной, иначе ERROR.
+ */
+int parse_variable(char ch, stack** head) {
+  if (ch == 'x' || ch < 'a' || ch > 'z') return ERROR;
+  stack buffer = {0};
+  buffer.type = S_XOPERAND;
+  buffer.ival = ch;
+  add_lexeme(head, buffer);
+  return OK;
+}
+
 /*!
  * \brief Анализирует строку на наличие функций.
  *
@@ -105,6 +147,32 @@ int parse_func(const char* line, stack** head) {
   return result;
 }
 
+/*!
+ * \brief Анализирует строку на наличие имени агрегата (sum, prod, min, max).
+ *
+ * Аргументы агрегата разбираются как обычные лексемы, разделённые запятыми;
+ * собирает их в отдельные программы compile_aggregates.
+ *
+ * \param line Строка для анализа.
+ * \param head Двойной указатель на вершину стека.
+ * \return Количество обработанных символов или ERROR, если имени агрегата
+ * нет.
+ */
+int parse_aggregate(const char* line, stack** head) {
+  int result = ERROR;
+  for (int i = 0; result == ERROR && s21_aggregates[i][0]; i++) {
+    size_t length = strlen(s21_aggregates[i]);
+    if (!strncmp(line, s21_aggregates[i], length)) {
+      stack buffer = {0};
+      buffer.type = S_AGGREGATE;
+      buffer.ival = i;
+      add_lexeme(head, buffer);
+      result = (int)length;
+    }
+  }
+  return result;
+}
+
 /*!
  * \brief Проверяет корректность расстановки скобок в выражении.
  *
@@ -158,12 +226,13 @@ int parse_operator(char ch, stack** head) {
 
   else if (ch == '-' || ch == '+') {
     // Унарный оператор, если стек пуст, предыдущий символ - открывающая скобка,
-    // или предыдущий символ - оператор умножения, деления, остатка от деления
-    // или возведения в степень
-    if ((*head) == NULL || ((**head).type == S_OPERAND &&
-                            ((**head).ival == '(' || (**head).ival == '*' ||
-                             (**head).ival == '/' || (**head).ival == '%' ||
-                             (**head).ival == '^'))) {
+    // запятая между аргументами агрегата или оператор умножения, деления,
+    // остатка от деления или возведения в степень
+    if ((*head) == NULL ||
+        ((**head).type == S_OPERAND &&
+         ((**head).ival == '(' || (**head).ival == ',' ||
+          (**head).ival == '*' || (**head).ival == '/' ||
+          (**head).ival == '%' || (**head).ival == '^'))) {
       buffer.type = S_UOPERAND;
     }
     // В противном случае обрабатываем как бинарный оператор
@@ -191,7 +260,7 @@ int parse_operator(char ch, stack** head) {
  * \return TRUE, если символ является оператором, иначе FALSE.
  */
 int is_operator(char ch) {
-  char* list = "+-*/()x^";
+  char* list = "+-*/()x^,";
   while (*list != '\0') {
     if (ch == *list) return TRUE;
     list++;
@@ -245,6 +314,8 @@ int parse_number(const char* str, stack** head) {
         data.type = 'f';
         dvalue = ivalue + (dvalue / pow(10, fractional));
         data.dval = dvalue;
+        // число знаков после точки нужно для точного восстановления константы
+        data.ival = fractional;
         break;
       }
       dvalue *= 10;
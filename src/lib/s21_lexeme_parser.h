@@ -3,6 +3,23 @@
 
 #include "s21_datatypes.h"
 extern const char* s21_tfuncs[];
+extern const char* s21_aggregates[];
+
+//! Номера функций в таблице s21_tfuncs.
+enum s21_func {
+  F_SIN,
+  F_COS,
+  F_TAN,
+  F_ACOS,
+  F_ASIN,
+  F_ATAN,
+  F_SQRT,
+  F_LN,
+  F_LOG
+};
+
+//! Виды агрегатов в таблице s21_aggregates.
+enum s21_aggregate { A_SUM, A_PROD, A_MIN, A_MAX };
 
 int parse_number(const char* str, stack** head);
 int is_digit(char ch);
@@ -10,6 +27,8 @@ int is_operator(char ch);
 int comma_check(const char* line);
 int parse_operator(char ch, stack** head);
 int parse_func(const char* line, stack** head);
+int parse_aggregate(const char* line, stack** head);
+int parse_variable(char ch, stack** head);
 double get_x();
 int set_x(double x);
 #endif
\ No newline at end of file
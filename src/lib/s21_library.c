@@ -0,0 +1,303 @@
+/*!
+ * \file s21_library.h
+ * \brief Сохранение скомпилированных программ в файл и загрузка через mmap
+ *
+ * Библиотека программ — версионированный двоичный файл с инструкциями,
+ * константами и картой слотов переменных каждой программы. При загрузке
+ * файл отображается в память только для чтения, и программы ссылаются прямо
+ * на отображение: копирования нет, а страницы файла разделяются между всеми
+ * процессами, открывшими ту же библиотеку.
+ */
+#include "s21_library.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "s21_datatypes.h"
+#include "s21_lexeme_parser.h"
+
+/*!
+ * \struct lib_order
+ * \brief Программа при сортировке по имени перед записью.
+ */
+typedef struct lib_order {
+  const char *name;
+  int index;
+} lib_order;
+
+/*!
+ * \brief Сравнивает программы по имени для qsort.
+ */
+static int compare_order(const void *a, const void *b) {
+  return strcmp(((const lib_order *)a)->name, ((const lib_order *)b)->name);
+}
+
+/*!
+ * \brief Округляет смещение вверх до кратного 8.
+ */
+static uint64_t align8(uint64_t offset) { return (offset + 7) & ~(uint64_t)7; }
+
+/*!
+ * \brief Записывает count байт и дополняет запись нулями до кратной 8.
+ *
+ * \return OK или ERROR при ошибке записи.
+ */
+static int write_block(FILE *f, const void *data, size_t count) {
+  static const char zeros[8] = {0};
+  size_t pad = (size_t)(align8(count) - count);
+  int error = OK;
+  if (count && fwrite(data, 1, count, f) != count) error = ERROR;
+  if (pad && fwrite(zeros, 1, pad, f) != pad) error = ERROR;
+  return error;
+}
+
+/*!
+ * \brief Сохраняет программы в файл библиотеки.
+ *
+ * Файл сначала пишется во временный файл рядом и затем переименовывается,
+ * поэтому процессы, уже отобразившие старую версию библиотеки, продолжают
+ * работать с ней.
+ *
+ * \param path Путь к файлу библиотеки.
+ * \param progs Массив программ.
+ * \param names Уникальные имена программ.
+ * \param count Количество программ.
+ * \return OK или ERROR (повторяющиеся имена, пустая программа, программа
+ * с агрегатами, ошибка записи).
+ */
+int save_library(const char *path, const program *progs,
+                 const char *const *names, int count) {
+  if (count < 0) return ERROR;
+  lib_order *order = malloc(sizeof(lib_order) * (count + 1));
+  lib_entry *entries = calloc(count + 1, sizeof(lib_entry));
+  char *tmp = malloc(strlen(path) + 5);
+  int error = order && entries && tmp ? OK : ERROR;
+  for (int i = 0; error == OK && i < count; i++) {
+    order[i].name = names[i];
+    order[i].index = i;
+    // агрегаты хранятся в отдельных программах, формат их не поддерживает
+    if (progs[i].size == 0 || progs[i].naggs > 0) error = ERROR;
+  }
+  if (error == OK) qsort(order, count, sizeof(lib_order), compare_order);
+  for (int i = 1; error == OK && i < count; i++)
+    if (!strcmp(order[i - 1].name, order[i].name)) error = ERROR;
+
+  lib_header head = {LIB_MAGIC, LIB_VERSION, (uint32_t)count, LIB_BYTE_ORDER,
+                     (uint32_t)sizeof(instr), 0};
+  uint64_t offset = sizeof(lib_header) + sizeof(lib_entry) * count;
+  for (int i = 0; error == OK && i < count; i++) {
+    const program *p = &progs[order[i].index];
+    lib_entry *e = &entries[i];
+    e->name_length = (uint32_t)strlen(order[i].name);
+    e->size = (uint32_t)p->size;
+    e->nconsts = (uint32_t)p->nconsts;
+    e->depth = (uint32_t)p->depth;
+    e->precision = (uint32_t)p->precision;
+    e->nvars = (uint32_t)p->nvars;
+    memcpy(e->vars, p->vars, p->nvars);
+    e->name_offset = offset;
+    offset = align8(offset + e->name_length + 1);
+    e->code_offset = offset;
+    offset = align8(offset + sizeof(instr) * p->size);
+    e->consts_offset = offset;
+    offset = align8(offset + sizeof(double) * p->nconsts);
+    e->consts_lo_offset = offset;
+    offset = align8(offset + sizeof(double) * p->nconsts);
+  }
+  head.size = offset;
+
+  FILE *f = NULL;
+  if (error == OK) {
+    sprintf(tmp, "%s.tmp", path);
+    f = fopen(tmp, "wb");
+    if (f == NULL) error = ERROR;
+  }
+  if (error == OK) error = write_block(f, &head, sizeof(head));
+  if (error == OK) error = write_block(f, entries, sizeof(lib_entry) * count);
+  for (int i = 0; error == OK && i < count; i++) {
+    const program *p = &progs[order[i].index];
+    error = write_block(f, order[i].name, entries[i].name_length + 1);
+    if (error == OK) error = write_block(f, p->code, sizeof(instr) * p->size);
+    if (error == OK)
+      error = write_block(f, p->consts, sizeof(double) * p->nconsts);
+    if (error == OK)
+      error = write_block(f, p->consts_lo, sizeof(double) * p->nconsts);
+  }
+  if (f && fclose(f) != 0) error = ERROR;
+  if (f && error == OK && rename(tmp, path) != 0) error = ERROR;
+  if (f && error != OK) remove(tmp);
+  free(order);
+  free(entries);
+  free(tmp);
+  return error;
+}
+
+/*!
+ * \brief Проверяет, что блок данных лежит внутри файла и выровнен.
+ */
+static int block_fits(uint64_t offset, uint64_t length, uint64_t size) {
+  return offset % 8 == 0 && offset <= size && length <= size - offset;
+}
+
+/*!
+ * \brief Проверяет программу из файла так же, как её проверяет компилятор:
+ * коды инструкций, индексы констант и слотов и глубину стека.
+ *
+ * Повреждённый файл иначе мог бы вывести вычислитель за границы массивов.
+ */
+static int check_program(const program *p) {
+  int error = p->size > 0 && p->depth <= S21_MAX_DEPTH &&
+                      p->nvars >= 1 && p->nvars <= S21_MAX_VARS &&
+                      p->vars[0] == 'x' &&
+                      (p->precision == P_DOUBLE || p->precision == P_DDOUBLE)
+                  ? OK
+                  : ERROR;
+  int depth = 0;
+  for (int i = 0; error == OK && i < p->size; i++) {
+    const instr *in = &p->code[i];
+    if (in->type == S_DOUBLE && in->ival >= 0 && in->ival < p->nconsts) {
+      depth++;
+    } else if (in->type == S_XOPERAND && in->ival >= 0 &&
+               in->ival < p->nvars) {
+      depth++;
+    } else if (in->type == S_OPERAND && depth >= 2 && in->ival > 0 &&
+               in->ival < 128 && strchr("+-*/^%", in->ival)) {
+      depth--;
+    } else if (in->type == S_UOPERAND && depth >= 1 && in->ival == '-') {
+    } else if (in->type == S_FUNC && depth >= 1 && in->ival >= F_SIN &&
+               in->ival <= F_LOG) {
+    } else {
+      error = ERROR;
+    }
+    if (depth > p->depth) error = ERROR;
+  }
+  if (depth != 1) error = ERROR;
+  return error;
+}
+
+/*!
+ * \brief Открывает библиотеку программ, отображая файл в память.
+ *
+ * \param path Путь к файлу библиотеки.
+ * \param lib Указатель на библиотеку, которая будет заполнена. После
+ * использования её нужно закрыть функцией close_library.
+ * \return OK или ERROR (нет файла, другая версия формата или порядок байтов,
+ * повреждённые данные).
+ */
+int open_library(const char *path, program_library *lib) {
+  program_library l = {0};
+  int error = ERROR;
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd >= 0 && fstat(fd, &st) == 0 &&
+      (size_t)st.st_size >= sizeof(lib_header)) {
+    l.map_size = (size_t)st.st_size;
+    l.map = mmap(NULL, l.map_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (l.map == MAP_FAILED)
+      l.map = NULL;
+    else
+      error = OK;
+  }
+  if (fd >= 0) close(fd);
+
+  const lib_header *head = l.map;
+  if (error == OK &&
+      (memcmp(head->magic, LIB_MAGIC, sizeof(LIB_MAGIC)) ||
+       head->version != LIB_VERSION || head->byte_order != LIB_BYTE_ORDER ||
+       head->instr_size != sizeof(instr) || head->size != l.map_size ||
+       !block_fits(sizeof(lib_header),
+                   (uint64_t)sizeof(lib_entry) * head->count, l.map_size)))
+    error = ERROR;
+  if (error == OK) {
+    l.count = (int)head->count;
+    l.entries = (const lib_entry *)((const char *)l.map + sizeof(lib_header));
+    l.progs = calloc(l.count + 1, sizeof(program));
+    if (l.progs == NULL) error = ERROR;
+  }
+  for (int i = 0; error == OK && i < l.count; i++) {
+    const lib_entry *e = &l.entries[i];
+    uint64_t consts = (uint64_t)sizeof(double) * e->nconsts;
+    if (!block_fits(e->name_offset, (uint64_t)e->name_length + 1,
+                    l.map_size) ||
+        !block_fits(e->code_offset, (uint64_t)sizeof(instr) * e->size,
+                    l.map_size) ||
+        !block_fits(e->consts_offset, consts, l.map_size) ||
+        !block_fits(e->consts_lo_offset, consts, l.map_size) ||
+        e->nvars > S21_MAX_VARS || e->size > 1u << 30 ||
+        ((const char *)l.map)[e->name_offset + e->name_length] != '\0') {
+      error = ERROR;
+      continue;
+    }
+    program *p = &l.progs[i];
+    p->code = (instr *)((char *)l.map + e->code_offset);
+    p->size = (int)e->size;
+    p->consts = (double *)((char *)l.map + e->consts_offset);
+    p->consts_lo = (double *)((char *)l.map + e->consts_lo_offset);
+    p->nconsts = (int)e->nconsts;
+    p->depth = (int)e->depth;
+    p->precision = (int)e->precision;
+    p->nvars = (int)e->nvars;
+    memcpy(p->vars, e->vars, e->nvars);
+    error = check_program(p);
+  }
+
+  if (error != OK) close_library(&l);
+  *lib = l;
+  return error;
+}
+
+/*!
+ * \brief Возвращает имя программы библиотеки.
+ *
+ * \param lib Указатель на библиотеку.
+ * \param index Номер программы.
+ * \return Имя или NULL для неверного номера.
+ */
+const char *library_name(const program_library *lib, int index) {
+  if (index < 0 || index >= lib->count) return NULL;
+  return (const char *)lib->map + lib->entries[index].name_offset;
+}
+
+/*!
+ * \brief Ищет программу по имени (двоичным поиском по таблице).
+ *
+ * \param lib Указатель на библиотеку.
+ * \param name Имя программы.
+ * \return Номер программы в lib->progs или ERROR, если её нет.
+ */
+int library_find(const program_library *lib, const char *name) {
+  int lo = 0, hi = lib->count - 1;
+  int found = ERROR;
+  while (lo <= hi && found == ERROR) {
+    int mid = lo + (hi - lo) / 2;
+    int cmp = strcmp(library_name(lib, mid), name);
+    if (cmp == 0)
+      found = mid;
+    else if (cmp < 0)
+      lo = mid + 1;
+    else
+      hi = mid - 1;
+  }
+  return found;
+}
+
+/*!
+ * \brief Закрывает библиотеку программ.
+ *
+ * \param lib Указатель на библиотеку.
+ */
+void close_library(program_library *lib) {
+  if (lib == NULL) return;
+  if (lib->map) munmap(lib->map, lib->map_size);
+  free(lib->progs);
+  lib->map = NULL;
+  lib->map_size = 0;
+  lib->entries = NULL;
+  lib->progs = NULL;
+  lib->count = 0;
+}
@@ -0,0 +1,76 @@
+#ifndef S21_LIBRARY_H
+#define S21_LIBRARY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "s21_program.h"
+
+//! Сигнатура файла библиотеки программ.
+#define LIB_MAGIC "S21PLIB"
+
+//! Версия формата файла библиотеки программ.
+#define LIB_VERSION 1
+
+/*!
+ * \struct lib_header
+ * \brief Заголовок файла библиотеки программ.
+ *
+ * За заголовком идёт таблица из count записей lib_entry, отсортированных по
+ * имени, затем данные программ. Все смещения отсчитываются от начала файла
+ * и кратны 8, поэтому инструкции и константы читаются прямо из отображения
+ * файла в память. Поле byte_order хранит LIB_BYTE_ORDER в порядке байтов
+ * записавшей машины.
+ */
+typedef struct lib_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+  uint32_t byte_order;
+  uint32_t instr_size;
+  uint64_t size;
+} lib_header;
+
+//! Контрольное значение порядка байтов.
+#define LIB_BYTE_ORDER 0x01020304u
+
+/*!
+ * \struct lib_entry
+ * \brief Запись таблицы программ: имя, параметры и смещения данных.
+ */
+typedef struct lib_entry {
+  uint64_t name_offset;
+  uint64_t code_offset;
+  uint64_t consts_offset;
+  uint64_t consts_lo_offset;
+  uint32_t name_length;
+  uint32_t size;
+  uint32_t nconsts;
+  uint32_t depth;
+  uint32_t precision;
+  uint32_t nvars;
+  char vars[32];
+} lib_entry;
+
+/*!
+ * \struct program_library
+ * \brief Библиотека программ, отображённая в память.
+ *
+ * Программы progs указывают прямо в отображение и принадлежат библиотеке:
+ * их нельзя освобождать функцией remove_program или изменять.
+ */
+typedef struct program_library {
+  void *map;
+  size_t map_size;
+  const lib_entry *entries;
+  program *progs;
+  int count;
+} program_library;
+
+int save_library(const char *path, const program *progs,
+                 const char *const *names, int count);
+int open_library(const char *path, program_library *lib);
+int library_find(const program_library *lib, const char *name);
+const char *library_name(const program_library *lib, int index);
+void close_library(program_library *lib);
+#endif
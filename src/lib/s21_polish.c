@@ -16,6 +16,7 @@
 #include <stdlib.h>
 
 #include "s21_datatypes.h"
+#include "s21_lexeme_parser.h"
 
 /*!
  * \brief Определяет приоритет оператора в стеке.
@@ -74,7 +75,7 @@ stack *to_polish(stack **head) {
 
   while ((lex = st_rpop(root)) != NULL) {
     if (lex->type == S_INTEGER || lex->type == S_DOUBLE ||
-        lex->type == S_XOPERAND) {
+        lex->type == S_XOPERAND || lex->type == S_AGGVALUE) {
       result = st_push(result, *lex);
     } else if (lex->type == S_OPERAND || lex->type == S_UOPERAND ||
                lex->type == S_FUNC) {
@@ -164,42 +165,55 @@ int calc_polish(stack *postfix, double *result) {
 int calc_uoperand(stack *num, stack *op) {
   int error = OK;
   if (op->ival == '+') return error;
-  switch (op->ival) {
+  if (op->ival == F_SQRT && num->dval < 0) error = ERROR;
+  num->dval = apply_uoperand(op->ival, num->dval);
+  return error;
+}
+
+/*!
+ * \brief Применяет унарный оператор или функцию к числу.
+ *
+ * \param op Код унарного оператора ('+', '-') или номер функции из s21_tfuncs.
+ * \param a Аргумент.
+ * \return Результат применения оператора.
+ */
+double apply_uoperand(int op, double a) {
+  double r = a;
+  switch (op) {
     case '-':
-      num->dval *= -1;
+      r = -a;
       break;
-    case 0:
-      num->dval = sin(num->dval);
+    case F_SIN:
+      r = sin(a);
       break;
-    case 1:
-      num->dval = cos(num->dval);
+    case F_COS:
+      r = cos(a);
       break;
-    case 2:
-      num->dval = tan(num->dval);
+    case F_TAN:
+      r = tan(a);
       break;
-    case 3:
-      num->dval = acos(num->dval);
+    case F_ACOS:
+      r = acos(a);
       break;
-    case 4:
-      num->dval = asin(num->dval);
+    case F_ASIN:
+      r = asin(a);
       break;
-    case 5:
-      num->dval = atan(num->dval);
+    case F_ATAN:
+      r = atan(a);
       break;
-    case 6:
-      if (num->dval < 0) error = ERROR;
-      num->dval = sqrt(num->dval);
+    case F_SQRT:
+      r = sqrt(a);
       break;
-    case 7:
-      num->dval = log(num->dval);
+    case F_LN:
+      r = log(a);
       break;
-    case 8:
-      num->dval = log10(num->dval);
+    case F_LOG:
+      r = log10(a);
       break;
     default:
       break;
   }
-  return error;
+  return r;
 }
 
 /*!
@@ -213,10 +227,23 @@ int calc_uoperand(stack *num, stack *op) {
  * \return Структура stack, содержащая результат операции.
  */
 stack calc_bioperand(stack *x, stack *y, stack *op) {
-  double a = x->dval;
-  double b = y->dval;
+  stack result = {0};
+  result.type = S_DOUBLE;
+  result.dval = apply_bioperand(op->ival, x->dval, y->dval);
+  return result;
+}
+
+/*!
+ * \brief Применяет бинарный оператор к двум числам.
+ *
+ * \param op Код оператора ('+', '-', '*', '/', '^', '%').
+ * \param a Левый операнд.
+ * \param b Правый операнд.
+ * \return Результат операции.
+ */
+double apply_bioperand(int op, double a, double b) {
   double r = 0;
-  switch (op->ival) {
+  switch (op) {
     case '+':
       r = a + b;
       break;
@@ -238,8 +265,5 @@ stack calc_bioperand(stack *x, stack *y, stack *op) {
     default:
       break;
   }
-  stack result = {0};
-  result.type = S_DOUBLE;
-  result.dval = r;
-  return result;
-}
\ No newline at end of file
+  return r;
+}
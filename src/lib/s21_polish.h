@@ -6,4 +6,6 @@ stack *to_polish(stack **head);
 int calc_polish(stack *postfix, double *result);
 stack calc_bioperand(stack *x, stack *y, stack *op);
 int calc_uoperand(stack *num, stack *op);
+double apply_bioperand(int op, double a, double b);
+double apply_uoperand(int op, double a);
 #endif
\ No newline at end of file
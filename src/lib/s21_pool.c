@@ -0,0 +1,382 @@
+/*!
+ * \file s21_pool.h
+ * \brief Пул потоков с перехватом работы для пакетных вычислений
+ *
+ * Вызывающий поток сам работает как поток 0 пула, поэтому пул из N потоков
+ * запускает N - 1 дополнительных. В начале задания элементы делятся поровну
+ * между деками всех потоков; дальше нагрузка выравнивается перехватом: если
+ * одни элементы считаются намного дольше других, освободившиеся потоки
+ * забирают оставшуюся работу у занятых.
+ */
+#define _GNU_SOURCE
+
+#include "s21_pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "s21_datatypes.h"
+
+//! Сколько неудачных попыток перехвата поток уступает процессор, прежде
+//! чем начать засыпать между попытками.
+#define POOL_SPIN 64
+
+//! Пауза между попытками перехвата после POOL_SPIN неудач, нс.
+#define POOL_NAP_NS 20000
+
+/*!
+ * \struct pool_range
+ * \brief Диапазон элементов задания.
+ */
+typedef struct pool_range {
+  int from;
+  int to;
+} pool_range;
+
+/*!
+ * \struct pool_deque
+ * \brief Дек диапазонов одного потока. Владелец работает с нижним концом
+ * (bottom), остальные потоки перехватывают с верхнего (top).
+ */
+typedef struct pool_deque {
+  pthread_mutex_t lock;
+  pool_range items[POOL_DEQUE];
+  int top;
+  int bottom;
+} pool_deque;
+
+/*!
+ * \struct pool_worker
+ * \brief Поток пула.
+ */
+typedef struct pool_worker {
+  work_pool *pool;
+  int index;
+  pthread_t id;
+} pool_worker;
+
+struct work_pool {
+  int threads;
+  int started;
+  pool_worker *workers;
+  pool_deque *deques;
+  pthread_mutex_t run;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  unsigned generation;
+  int active;
+  int stop;
+  pool_func func;
+  void *arg;
+  int max_grain;
+  atomic_long remaining;
+};
+
+/*!
+ * \brief Возвращает число потоков по количеству доступных процессоров.
+ *
+ * \return Число потоков, не меньше 1.
+ */
+int default_threads() {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (int)n : 1;
+}
+
+/*!
+ * \brief Кладёт диапазон на нижний конец дека.
+ *
+ * \return OK или ERROR, если дек заполнен.
+ */
+static int deque_push(pool_deque *d, pool_range r) {
+  int error = ERROR;
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom - d->top < POOL_DEQUE) {
+    d->items[d->bottom++ % POOL_DEQUE] = r;
+    error = OK;
+  }
+  pthread_mutex_unlock(&d->lock);
+  return error;
+}
+
+/*!
+ * \brief Снимает диапазон с нижнего конца дека (для владельца) или с
+ * верхнего (для перехвата).
+ *
+ * \return OK или ERROR, если дек пуст.
+ */
+static int deque_take(pool_deque *d, int steal, pool_range *r) {
+  int error = ERROR;
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom > d->top) {
+    *r = steal ? d->items[d->top++ % POOL_DEQUE]
+               : d->items[--d->bottom % POOL_DEQUE];
+    error = OK;
+  }
+  if (d->bottom == d->top) d->bottom = d->top = 0;
+  pthread_mutex_unlock(&d->lock);
+  return error;
+}
+
+/*!
+ * \brief Ищет работу: сначала в своём деке, затем в деках других потоков,
+ * начиная со случайного.
+ */
+static int find_work(work_pool *pool, int self, unsigned *seed,
+                     pool_range *r) {
+  int error = deque_take(&pool->deques[self], FALSE, r);
+  *seed = *seed * 1103515245u + 12345u;
+  int start = (int)((*seed >> 16) % (unsigned)pool->threads);
+  for (int i = 0; error != OK && i < pool->threads; i++) {
+    int victim = (start + i) % pool->threads;
+    if (victim != self) error = deque_take(&pool->deques[victim], TRUE, r);
+  }
+  return error;
+}
+
+/*!
+ * \brief Возвращает монотонное время в наносекундах.
+ */
+static double now_ns() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/*!
+ * \brief Обрабатывает диапазон: делит его до размера порции, кладя верхние
+ * половины в свой дек, и обрабатывает нижнюю порцию.
+ *
+ * \param pool Пул.
+ * \param self Номер потока.
+ * \param r Диапазон.
+ * \param cost Оценка времени обработки одного элемента, нс (0 — ещё не
+ * измерено); обновляется по результату.
+ */
+static void run_range(work_pool *pool, int self, pool_range r, double *cost) {
+  int grain = 1;
+  if (*cost > 0) {
+    double g = POOL_TARGET_NS / *cost;
+    grain = g < pool->max_grain ? (int)g : pool->max_grain;
+    if (grain < 1) grain = 1;
+  }
+  while (r.to - r.from > grain) {
+    pool_range upper = {r.from + (r.to - r.from) / 2, r.to};
+    if (deque_push(&pool->deques[self], upper) != OK) break;
+    r.to = upper.from;
+  }
+  double start = now_ns();
+  pool->func(pool->arg, r.from, r.to);
+  double per_item = (now_ns() - start) / (r.to - r.from);
+  // скользящее среднее сглаживает выбросы отдельных элементов
+  *cost = *cost > 0 ? 0.75 * *cost + 0.25 * per_item : per_item;
+  if (*cost <= 0) *cost = 1;
+  atomic_fetch_sub(&pool->remaining, r.to - r.from);
+}
+
+/*!
+ * \brief Выполняет текущее задание пула, пока не обработаны все элементы.
+ */
+static void work(work_pool *pool, int self) {
+  double cost = 0;
+  unsigned seed = (unsigned)self * 2654435761u + 1;
+  int misses = 0;
+  while (atomic_load(&pool->remaining) > 0) {
+    pool_range r;
+    if (find_work(pool, self, &seed, &r) == OK) {
+      run_range(pool, self, r, &cost);
+      misses = 0;
+    } else if (++misses < POOL_SPIN) {
+      sched_yield();
+    } else {
+      struct timespec nap = {0, POOL_NAP_NS};
+      nanosleep(&nap, NULL);
+    }
+  }
+}
+
+/*!
+ * \brief Поток пула: ждёт задание, выполняет его и сообщает о завершении.
+ */
+static void *worker_main(void *arg) {
+  pool_worker *w = arg;
+  work_pool *pool = w->pool;
+  unsigned seen = 0;
+  pthread_mutex_lock(&pool->lock);
+  while (!pool->stop) {
+    if (pool->generation == seen) {
+      pthread_cond_wait(&pool->wake, &pool->lock);
+      continue;
+    }
+    seen = pool->generation;
+    pthread_mutex_unlock(&pool->lock);
+    work(pool, w->index);
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->active == 0) pthread_cond_signal(&pool->done);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+/*!
+ * \brief Закрепляет поток за процессором (только в Linux).
+ */
+static void pin_thread(pthread_t id, int cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu % default_threads(), &set);
+  pthread_setaffinity_np(id, sizeof(set), &set);
+#else
+  (void)id;
+  (void)cpu;
+#endif
+}
+
+/*!
+ * \brief Создаёт пул потоков.
+ *
+ * \param threads Число потоков вместе с вызывающим (0 — по числу
+ * процессоров).
+ * \param pin TRUE, чтобы закрепить дополнительные потоки за процессорами
+ * 1, 2, ... (вызывающий поток не закрепляется).
+ * \param pool Указатель для записи пула. После использования пул нужно
+ * удалить функцией pool_destroy.
+ * \return OK или ERROR, если не удалось выделить память. Если не удалось
+ * запустить часть потоков, пул работает с меньшим их числом.
+ */
+int pool_create(int threads, int pin, work_pool **pool) {
+  if (threads <= 0) threads = default_threads();
+  work_pool *p = calloc(1, sizeof(work_pool));
+  if (p) p->workers = calloc(threads, sizeof(pool_worker));
+  if (p) p->deques = calloc(threads, sizeof(pool_deque));
+  if (p == NULL || p->workers == NULL || p->deques == NULL) {
+    if (p) free(p->workers);
+    if (p) free(p->deques);
+    free(p);
+    *pool = NULL;
+    return ERROR;
+  }
+  pthread_mutex_init(&p->run, NULL);
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->wake, NULL);
+  pthread_cond_init(&p->done, NULL);
+  p->threads = 1;
+  for (int i = 1; i < threads; i++) {
+    pool_worker *w = &p->workers[p->threads];
+    w->pool = p;
+    w->index = p->threads;
+    if (pthread_create(&w->id, NULL, worker_main, w) == 0) {
+      if (pin) pin_thread(w->id, w->index);
+      p->threads++;
+    }
+  }
+  p->started = p->threads - 1;
+  // деки не используются до первого задания, поэтому их можно
+  // инициализировать после запуска потоков
+  for (int i = 0; i < p->threads; i++)
+    pthread_mutex_init(&p->deques[i].lock, NULL);
+  *pool = p;
+  return OK;
+}
+
+/*!
+ * \brief Обрабатывает элементы от 0 до n в потоках пула.
+ *
+ * Функция возвращается, когда обработаны все элементы. Если пул уже занят
+ * другим заданием (например, при вызове изнутри func), или пул не задан,
+ * элементы обрабатываются в вызывающем потоке.
+ *
+ * \param pool Пул или NULL.
+ * \param n Количество элементов.
+ * \param func Функция обработки диапазона элементов.
+ * \param arg Аргумент func.
+ */
+void pool_run(work_pool *pool, int n, pool_func func, void *arg) {
+  if (n <= 0) return;
+  if (pool == NULL || pool->threads == 1 || n == 1 ||
+      pthread_mutex_trylock(&pool->run) != 0) {
+    func(arg, 0, n);
+    return;
+  }
+  pool->func = func;
+  pool->arg = arg;
+  pool->max_grain = n / (pool->threads * 4);
+  if (pool->max_grain < 1) pool->max_grain = 1;
+  atomic_store(&pool->remaining, n);
+  for (int i = 0; i < pool->threads; i++) {
+    pool_range r = {(int)((long long)n * i / pool->threads),
+                    (int)((long long)n * (i + 1) / pool->threads)};
+    if (r.to > r.from) deque_push(&pool->deques[i], r);
+  }
+  pthread_mutex_lock(&pool->lock);
+  pool->generation++;
+  pool->active = pool->started;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+
+  work(pool, 0);
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->active > 0) pthread_cond_wait(&pool->done, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+  pthread_mutex_unlock(&pool->run);
+}
+
+/*!
+ * \brief Возвращает число потоков пула вместе с вызывающим.
+ */
+int pool_threads(const work_pool *pool) { return pool ? pool->threads : 1; }
+
+/*!
+ * \brief Останавливает потоки и удаляет пул.
+ *
+ * \param pool Пул или NULL.
+ */
+void pool_destroy(work_pool *pool) {
+  if (pool == NULL) return;
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = TRUE;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+  for (int i = 1; i <= pool->started; i++)
+    pthread_join(pool->workers[i].id, NULL);
+  for (int i = 0; i < pool->threads; i++)
+    pthread_mutex_destroy(&pool->deques[i].lock);
+  pthread_mutex_destroy(&pool->run);
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->wake);
+  pthread_cond_destroy(&pool->done);
+  free(pool->workers);
+  free(pool->deques);
+  free(pool);
+}
+
+//! Общий пул библиотеки.
+static work_pool *shared_pool = NULL;
+
+//! Признак однократного создания общего пула.
+static pthread_once_t shared_once = PTHREAD_ONCE_INIT;
+
+/*!
+ * \brief Создаёт общий пул по числу процессоров.
+ */
+static void create_shared() { pool_create(0, FALSE, &shared_pool); }
+
+/*!
+ * \brief Возвращает общий пул библиотеки, создавая его при первом вызове.
+ *
+ * Пул размером по числу процессоров живёт до завершения программы. Им
+ * пользуются параллельные функции библиотеки (поиск корней, пакетное
+ * вычисление многих программ).
+ *
+ * \return Общий пул или NULL, если его не удалось создать.
+ */
+work_pool *pool_shared() {
+  pthread_once(&shared_once, create_shared);
+  return shared_pool;
+}
@@ -0,0 +1,34 @@
+#ifndef S21_POOL_H
+#define S21_POOL_H
+
+//! Желаемая длительность одной порции работы, нс. Порции короче тратят
+//! время на планирование, длиннее — хуже делятся между потоками.
+#define POOL_TARGET_NS 50000
+
+//! Ёмкость дека заданий одного потока.
+#define POOL_DEQUE 128
+
+/*!
+ * \brief Функция обработки элементов с номерами от from до to (не включая).
+ */
+typedef void (*pool_func)(void *arg, int from, int to);
+
+/*!
+ * \struct work_pool
+ * \brief Пул потоков с перехватом работы (work stealing).
+ *
+ * У каждого потока свой дек диапазонов элементов. Поток берёт диапазон с
+ * нижнего конца своего дека, делит его пополам, пока тот больше порции, и
+ * кладёт верхние половины обратно. Освободившийся поток забирает самый
+ * крупный диапазон с верхнего конца дека другого потока. Размер порции
+ * подбирается по измеренному времени обработки одного элемента.
+ */
+typedef struct work_pool work_pool;
+
+int pool_create(int threads, int pin, work_pool **pool);
+void pool_run(work_pool *pool, int n, pool_func func, void *arg);
+int pool_threads(const work_pool *pool);
+void pool_destroy(work_pool *pool);
+work_pool *pool_shared();
+int default_threads();
+#endif
@@ -0,0 +1,197 @@
+/*!
+ * \file s21_portfolio.h
+ * \brief Денежные потоки портфеля кредитов по календарным месяцам
+ *
+ * График каждого кредита строится тем же ядром, что и в кредитном
+ * калькуляторе (см. calculateSchedule), но в режиме накопления: столбцы
+ * графика указывают прямо в частичные итоги блока со сдвигом на месяц выдачи
+ * кредита, поэтому графики отдельных кредитов нигде не хранятся. Кредиты
+ * делятся на блоки, блоки обрабатываются потоками общего пула, а частичные
+ * итоги блоков складываются по порядку в конце.
+ */
+#include "s21_portfolio.h"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "s21_datatypes.h"
+#include "s21_pool.h"
+
+/*!
+ * \struct portfolio_job
+ * \brief Задание потоков: кредиты, разбиение на блоки и частичные итоги.
+ */
+typedef struct portfolio_job {
+  const loan_record *loans;
+  size_t count;
+  size_t block;
+  int months;
+  double *parts;
+  atomic_int error;
+} portfolio_job;
+
+/*!
+ * \brief Проверяет кредиты и находит горизонт портфеля.
+ *
+ * \return Число месяцев до последнего платежа или ERROR.
+ */
+static int portfolio_horizon(const loan_record *loans, size_t count) {
+  long long months = 0;
+  for (size_t i = 0; i < count; i++) {
+    const loan_record *l = &loans[i];
+    if (l->term < 1 || l->start < 0 || !(l->amount >= 0) ||
+        !(l->rate >= 0) ||
+        (l->type != CREDIT_ANNUITY && l->type != CREDIT_DIFFERENTIAL))
+      return ERROR;
+    if ((long long)l->start + l->term > months)
+      months = (long long)l->start + l->term;
+  }
+  return months > PORTFOLIO_MAX_MONTHS ? ERROR : (int)months;
+}
+
+/*!
+ * \brief Складывает графики кредитов блоков с from по to в частичные итоги
+ * этих блоков.
+ */
+static void portfolio_range(void *arg, int from, int to) {
+  portfolio_job *job = arg;
+  for (int b = from; b < to; b++) {
+    double *part = job->parts + (size_t)b * 3 * job->months;
+    size_t first = b * job->block;
+    size_t last = first + job->block < job->count ? first + job->block
+                                                  : job->count;
+    for (size_t i = first; i < last; i++) {
+      const loan_record *l = &job->loans[i];
+      loan_schedule s = {.principal = part + l->start,
+                         .interest = part + job->months + l->start,
+                         .balance = part + 2 * job->months + l->start,
+                         .capacity = job->months - l->start,
+                         .accumulate = TRUE};
+      if (calculateSchedule(l->amount, l->term, l->rate, l->type, &s) != OK)
+        atomic_store(&job->error, ERROR);
+    }
+  }
+}
+
+/*!
+ * \brief Рассчитывает итоги портфеля по календарным месяцам.
+ *
+ * \param loans Кредиты портфеля.
+ * \param count Число кредитов.
+ * \param totals Указатель для записи итогов; освобождаются portfolio_free.
+ * \return OK или ERROR при неверном кредите, слишком длинном горизонте или
+ * нехватке памяти.
+ */
+int portfolio_run(const loan_record *loans, size_t count,
+                  portfolio_totals *totals) {
+  memset(totals, 0, sizeof(*totals));
+  int months = count ? portfolio_horizon(loans, count) : 0;
+  if (months == ERROR) return ERROR;
+
+  portfolio_job job = {.loans = loans, .count = count, .months = months};
+  atomic_init(&job.error, OK);
+  int nparts = (int)((count + PORTFOLIO_MIN_BLOCK - 1) / PORTFOLIO_MIN_BLOCK);
+  if (nparts > PORTFOLIO_PARTS) nparts = PORTFOLIO_PARTS;
+  job.block = nparts ? (count + nparts - 1) / nparts : 0;
+  job.parts = calloc((size_t)nparts * 3 * months + 1, sizeof(double));
+  double *sums = calloc((size_t)3 * months + 1, sizeof(double));
+  int error = job.parts && sums ? OK : ERROR;
+  if (error == OK) {
+    pool_run(pool_shared(), nparts, portfolio_range, &job);
+    error = atomic_load(&job.error);
+  }
+  for (int b = 0; error == OK && b < nparts; b++) {
+    const double *part = job.parts + (size_t)b * 3 * months;
+    for (int m = 0; m < 3 * months; m++) sums[m] += part[m];
+  }
+  free(job.parts);
+  if (error == OK) {
+    totals->principal = sums;
+    totals->interest = sums + months;
+    totals->balance = sums + 2 * months;
+    totals->months = months;
+  } else {
+    free(sums);
+  }
+  return error;
+}
+
+/*!
+ * \struct rate_job
+ * \brief Задание потоков для расчёта эффективных ставок.
+ */
+typedef struct rate_job {
+  const loan_record *loans;
+  const loan_fees *fees;
+  size_t count;
+  size_t block;
+  double *rates;
+  atomic_int error;
+} rate_job;
+
+/*!
+ * \brief Рассчитывает эффективные ставки кредитов блоков с from по to.
+ *
+ * Платежи кредита пишутся в один буфер блока, который переиспользуется для
+ * всех его кредитов.
+ */
+static void rate_range(void *arg, int from, int to) {
+  rate_job *job = arg;
+  double *payments = malloc(sizeof(double) * PORTFOLIO_MAX_MONTHS);
+  for (int b = from; b < to; b++) {
+    size_t first = b * job->block;
+    size_t last = first + job->block < job->count ? first + job->block
+                                                  : job->count;
+    for (size_t i = first; i < last; i++) {
+      const loan_record *l = &job->loans[i];
+      loan_schedule s = {.payment = payments,
+                         .capacity = payments ? PORTFOLIO_MAX_MONTHS : 0};
+      int error =
+          l->term <= PORTFOLIO_MAX_MONTHS
+              ? calculateSchedule(l->amount, l->term, l->rate, l->type, &s)
+              : ERROR;
+      if (error == OK)
+        error = calculateEffectiveRate(l->amount, &s,
+                                       job->fees ? &job->fees[i] : NULL,
+                                       &job->rates[i]);
+      if (error != OK) {
+        job->rates[i] = NAN;
+        atomic_store(&job->error, ERROR);
+      }
+    }
+  }
+  free(payments);
+}
+
+/*!
+ * \brief Рассчитывает эффективные годовые ставки всех кредитов портфеля
+ * (см. calculateEffectiveRate).
+ *
+ * \param loans Кредиты портфеля; месяц выдачи не учитывается.
+ * \param fees Комиссии по кредитам или NULL, если их нет.
+ * \param count Число кредитов.
+ * \param rates Массив на count ставок, % годовых.
+ * \return OK или ERROR, если хотя бы для одного кредита ставки нет; его
+ * ставка — NaN.
+ */
+int portfolio_effective_rates(const loan_record *loans, const loan_fees *fees,
+                              size_t count, double *rates) {
+  rate_job job = {
+      .loans = loans, .fees = fees, .count = count, .rates = rates};
+  atomic_init(&job.error, OK);
+  int nparts = (int)((count + PORTFOLIO_MIN_BLOCK - 1) / PORTFOLIO_MIN_BLOCK);
+  if (nparts > PORTFOLIO_PARTS) nparts = PORTFOLIO_PARTS;
+  job.block = nparts ? (count + nparts - 1) / nparts : 0;
+  pool_run(pool_shared(), nparts, rate_range, &job);
+  return atomic_load(&job.error);
+}
+
+/*!
+ * \brief Освобождает итоги портфеля.
+ */
+void portfolio_free(portfolio_totals *totals) {
+  free(totals->principal);
+  memset(totals, 0, sizeof(*totals));
+}
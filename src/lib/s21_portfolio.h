@@ -0,0 +1,55 @@
+#ifndef S21_PORTFOLIO_H
+#define S21_PORTFOLIO_H
+
+#include <stddef.h>
+
+#include "s21_creditcal.h"
+
+//! Наибольшее число частичных итогов. Кредиты делятся на столько блоков
+//! независимо от числа потоков, поэтому и итоги от него не зависят.
+#define PORTFOLIO_PARTS 64
+
+//! Наименьшее число кредитов в блоке: меньшие блоки не окупают сложения
+//! своих частичных итогов.
+#define PORTFOLIO_MIN_BLOCK 4096
+
+//! Наибольший горизонт портфеля в месяцах.
+#define PORTFOLIO_MAX_MONTHS 12000
+
+/*!
+ * \struct loan_record
+ * \brief Кредит портфеля; в двоичном файле портфеля записи лежат подряд в
+ * порядке байтов машины.
+ *
+ * Ставка — годовая в процентах, type — CREDIT_ANNUITY или
+ * CREDIT_DIFFERENTIAL, start — номер календарного месяца выдачи от начала
+ * портфеля (первый платёж приходится на месяц start).
+ */
+typedef struct loan_record {
+  double amount;
+  double rate;
+  int term;
+  int type;
+  int start;
+  int reserved;
+} loan_record;
+
+/*!
+ * \struct portfolio_totals
+ * \brief Итоги портфеля по календарным месяцам: погашенный долг, проценты
+ * и остаток долга после платежей месяца.
+ */
+typedef struct portfolio_totals {
+  double *principal;
+  double *interest;
+  double *balance;
+  int months;
+} portfolio_totals;
+
+int portfolio_run(const loan_record *loans, size_t count,
+                  portfolio_totals *totals);
+int portfolio_effective_rates(const loan_record *loans,
+                              const loan_fees *fees, size_t count,
+                              double *rates);
+void portfolio_free(portfolio_totals *totals);
+#endif
@@ -0,0 +1,208 @@
+/*!
+ * \file s21_preview.h
+ * \brief Инкрементальный разбор и компиляция выражения при вводе
+ *
+ * При каждом изменении строки находятся общие начало и конец старого и
+ * нового текста. Лексемы до изменённого места остаются как есть; разбор
+ * начинается немного раньше места правки (имя функции может срастись из
+ * нескольких букв) и идёт, пока позиция разбора не совпадёт с началом
+ * старой лексемы из неизменного конца строки. Дальше старые лексемы
+ * переиспользуются со сдвигом; заново определяется только первая из них,
+ * потому что унарность плюса и минуса зависит от предыдущей лексемы.
+ */
+#include "s21_preview.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "s21_lexeme_parser.h"
+
+//! Насколько раньше места правки начинать разбор: длина самого длинного
+//! имени функции без одной буквы.
+#define PREVIEW_BACKTRACK 3
+
+/*!
+ * \brief Создаёт пустое состояние предпросмотра.
+ *
+ * \param pv Состояние предпросмотра.
+ * \param vars TRUE, если кроме x разрешены другие переменные.
+ */
+void preview_init(preview *pv, int vars) {
+  memset(pv, 0, sizeof(preview));
+  pv->vars = vars;
+}
+
+/*!
+ * \brief Разбирает одну лексему с учётом предыдущей.
+ *
+ * Используются те же функции разбора, что и в parse_all: предыдущая лексема
+ * передаётся им как вершина стека.
+ *
+ * \param pv Состояние предпросмотра.
+ * \param pos Позиция начала лексемы.
+ * \param prev Предыдущая лексема или NULL.
+ * \param out Указатель для записи лексемы.
+ * \return OK или ERROR, если в позиции pos нет допустимой лексемы.
+ */
+static int lex_token(const preview *pv, int pos, const token *prev,
+                     token *out) {
+  stack ctx = {0};
+  if (prev) ctx = prev->lex;
+  ctx.prew = ctx.next = NULL;
+  stack *head = prev ? &ctx : NULL;
+  const char *line = pv->text + pos;
+  int code = parse_number(line, &head);
+  if (code == ERROR) code = parse_func(line, &head);
+  if (code == ERROR) code = parse_aggregate(line, &head);
+  // индексы агрегатов — переменные и без режима переменных
+  if (code == ERROR) code = parse_variable(*line, &head);
+  if (code == ERROR) code = parse_operator(*line, &head);
+  if (code != ERROR && head && head != &ctx) {
+    out->start = pos;
+    out->length = code;
+    out->lex = *head;
+    out->lex.prew = out->lex.next = NULL;
+    free(head);
+  } else {
+    code = ERROR;
+  }
+  return code == ERROR ? ERROR : OK;
+}
+
+/*!
+ * \brief Находит первую лексему, которую может затронуть правка в позиции
+ * edit.
+ *
+ * Лексема, заканчивающаяся прямо перед правкой, тоже разбирается заново:
+ * к числу могут дописать цифры. Если перед правкой стоят буквы, они могут
+ * стать началом имени функции, поэтому начало сдвигается на них.
+ */
+static int first_affected(const preview *pv, int edit) {
+  int from = edit;
+  while (from > 0 && edit - from < PREVIEW_BACKTRACK &&
+         pv->text[from - 1] >= 'a' && pv->text[from - 1] <= 'z')
+    from--;
+  int k = 0;
+  while (k < pv->ntokens && pv->tokens[k].start + pv->tokens[k].length < from)
+    k++;
+  return k;
+}
+
+/*!
+ * \brief Разбирает заново участок строки, начиная с лексемы k.
+ *
+ * \param pv Состояние предпросмотра с уже записанным новым текстом.
+ * \param k Номер первой разбираемой лексемы.
+ * \param old Старые лексемы начиная с k (NULL, если их нельзя
+ * переиспользовать).
+ * \param nold Количество старых лексем.
+ * \param suffix Начало неизменного конца строки в новом тексте.
+ * \param delta Сдвиг позиций старых лексем.
+ * \return OK или ERROR при недопустимом символе.
+ */
+static int relex(preview *pv, int k, const token *old, int nold, int suffix,
+                 int delta) {
+  int pos = k > 0 ? pv->tokens[k - 1].start + pv->tokens[k - 1].length : 0;
+  int count = k;
+  int j = 0;
+  int error = OK;
+  int synced = FALSE;
+  while (error == OK && !synced) {
+    while (pos < pv->length && pv->text[pos] == ' ') pos++;
+    if (pos >= pv->length) break;
+    // старые лексемы, оставшиеся позади, уже не пригодятся
+    while (j < nold && old[j].start + delta < pos) j++;
+    if (j < nold && pos >= suffix && old[j].start + delta == pos) {
+      synced = TRUE;
+      for (int i = j; i < nold; i++) {
+        pv->tokens[count] = old[i];
+        pv->tokens[count++].start += delta;
+      }
+    }
+    const token *prev = count > 0 ? &pv->tokens[count - 1] : NULL;
+    token t;
+    if (synced) {
+      // первая переиспользованная лексема зависит от новой предыдущей
+      int at = count - (nold - j);
+      error = lex_token(pv, pos, at > 0 ? &pv->tokens[at - 1] : NULL, &t);
+      if (error == OK) pv->tokens[at] = t;
+    } else {
+      error = lex_token(pv, pos, prev, &t);
+      if (error == OK) {
+        pv->tokens[count++] = t;
+        pos += t.length;
+      }
+    }
+    pv->relexed++;
+  }
+  pv->ntokens = count;
+  return error;
+}
+
+/*!
+ * \brief Обновляет предпросмотр для нового текста выражения.
+ *
+ * \param pv Состояние предпросмотра.
+ * \param text Новый текст выражения.
+ * \return OK, если выражение разобрано и скомпилировано в pv->prog, иначе
+ * ERROR.
+ */
+int preview_update(preview *pv, const char *text) {
+  int n = (int)strlen(text);
+  if (n >= PREVIEW_MAX) {
+    preview_free(pv);
+    pv->lex_error = TRUE;
+    return ERROR;
+  }
+  int p = 0;
+  while (p < n && p < pv->length && text[p] == pv->text[p]) p++;
+  int s = 0;
+  while (s < n - p && s < pv->length - p &&
+         text[n - 1 - s] == pv->text[pv->length - 1 - s])
+    s++;
+
+  int k = first_affected(pv, p);
+  int nold = pv->lex_error ? 0 : pv->ntokens - k;
+  memcpy(pv->scratch, pv->tokens + k, sizeof(token) * (nold > 0 ? nold : 0));
+  int delta = n - pv->length;
+  memcpy(pv->text, text, n + 1);
+  pv->length = n;
+  pv->relexed = 0;
+
+  int error = relex(pv, k, pv->scratch, nold > 0 ? nold : 0, n - s, delta);
+  pv->lex_error = error != OK;
+  if (error == OK) error = comma_check(pv->text);
+
+  remove_program(&pv->prog);
+  stack *st = NULL;
+  for (int i = 0; error == OK && i < pv->ntokens; i++) {
+    stack *next = st_push(st, pv->tokens[i].lex);
+    if (next == NULL) error = ERROR;
+    st = next ? next : st;
+  }
+  if (error == OK && pv->ntokens > 0)
+    error = compile_lexemes(st, &pv->prog);
+  else
+    remove_stack(&st);
+  // как и в compile_program, без режима переменных свободной может быть
+  // только x
+  if (error == OK && !pv->vars && pv->prog.nvars > 1) {
+    remove_program(&pv->prog);
+    error = ERROR;
+  }
+  if (pv->ntokens == 0) error = ERROR;
+  return error;
+}
+
+/*!
+ * \brief Освобождает программу предпросмотра и сбрасывает разбор.
+ *
+ * \param pv Состояние предпросмотра.
+ */
+void preview_free(preview *pv) {
+  remove_program(&pv->prog);
+  pv->length = 0;
+  pv->text[0] = '\0';
+  pv->ntokens = 0;
+  pv->lex_error = FALSE;
+}
@@ -0,0 +1,44 @@
+#ifndef S21_PREVIEW_H
+#define S21_PREVIEW_H
+
+#include "s21_datatypes.h"
+#include "s21_program.h"
+
+//! Максимальная длина выражения в предпросмотре вместе с нулём в конце.
+#define PREVIEW_MAX 256
+
+/*!
+ * \struct token
+ * \brief Лексема вместе с её положением в строке.
+ */
+typedef struct token {
+  int start;
+  int length;
+  stack lex;
+} token;
+
+/*!
+ * \struct preview
+ * \brief Состояние инкрементального разбора выражения при вводе.
+ *
+ * Хранит предыдущий текст и его лексемы. При обновлении заново
+ * разбирается только участок вокруг изменённого места, а лексемы до и после
+ * него переиспользуются. Поле relexed показывает, сколько лексем пришлось
+ * разобрать заново при последнем обновлении.
+ */
+typedef struct preview {
+  char text[PREVIEW_MAX];
+  int length;
+  token tokens[PREVIEW_MAX];
+  token scratch[PREVIEW_MAX];
+  int ntokens;
+  int lex_error;
+  int vars;
+  int relexed;
+  program prog;
+} preview;
+
+void preview_init(preview *pv, int vars);
+int preview_update(preview *pv, const char *text);
+void preview_free(preview *pv);
+#endif
@@ -0,0 +1,415 @@
+/*!
+ * \file s21_program.h
+ * \brief Компиляция выражения в плоскую программу и её вычисление
+ *
+ * Выражение разбирается, проверяется и переводится в обратную польскую запись
+ * один раз, после чего хранится в виде массива инструкций. Программу можно
+ * вычислять для отдельного значения x или для массива значений: в пакетном
+ * режиме каждая инструкция обрабатывает сразу блок из S21_CHUNK точек.
+ */
+#include "s21_program.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "s21_aggregate.h"
+#include "s21_budget.h"
+#include "s21_datatypes.h"
+#include "s21_ddouble.h"
+#include "s21_polish.h"
+#include "s21_validate.h"
+
+/*!
+ * \brief Переносит выражение из стека в обратной польской записи в массив
+ * инструкций.
+ *
+ * Заодно вычисляется максимальная глубина стека вычислений и проверяется,
+ * что каждому оператору хватает операндов.
+ *
+ * \param postfix Указатель на вершину стека в обратной польской записи.
+ * \param prog Указатель на заполняемую программу.
+ * \return OK при успешной компиляции, иначе ERROR.
+ */
+static int emit_program(stack *postfix, program *prog) {
+  int count = 0;
+  stack *lex = postfix;
+  while (lex && lex->next != NULL) {
+    lex = lex->next;
+    count++;
+  }
+  if (lex) count++;
+  prog->code = malloc(sizeof(instr) * (count + 1));
+  prog->consts = malloc(sizeof(double) * (count + 1));
+  prog->consts_lo = malloc(sizeof(double) * (count + 1));
+  if (prog->code == NULL || prog->consts == NULL || prog->consts_lo == NULL)
+    return ERROR;
+
+  int error = OK;
+  int depth = 0;
+  for (; lex != NULL && error == OK; lex = lex->prew) {
+    instr in = {lex->type, lex->ival};
+    if (lex->type == S_INTEGER || lex->type == S_DOUBLE) {
+      // у чисел с точкой ival хранит число знаков после точки
+      ddouble exact =
+          dd_const(lex->dval, lex->type == S_DOUBLE ? lex->ival : 0);
+      in.type = S_DOUBLE;
+      in.ival = prog->nconsts;
+      prog->consts[prog->nconsts] = lex->dval;
+      prog->consts_lo[prog->nconsts++] =
+          dd_sub(exact, dd_from(lex->dval)).hi;
+      depth++;
+    } else if (lex->type == S_XOPERAND) {
+      in.ival = program_var_slot(prog, (char)lex->ival);
+      if (in.ival == ERROR && prog->nvars < S21_MAX_VARS) {
+        in.ival = prog->nvars;
+        prog->vars[prog->nvars++] = (char)lex->ival;
+      }
+      if (in.ival == ERROR) error = ERROR;
+      depth++;
+    } else if (lex->type == S_AGGVALUE) {
+      depth++;
+    } else if (lex->type == S_OPERAND && depth >= 2) {
+      depth--;
+    } else if ((lex->type == S_UOPERAND || lex->type == S_FUNC) &&
+               depth >= 1) {
+      // унарный плюс ничего не меняет и в программу не попадает
+      if (lex->type == S_UOPERAND && lex->ival == '+') continue;
+    } else {
+      error = ERROR;
+    }
+    if (depth > prog->depth) prog->depth = depth;
+    if (error == OK) prog->code[prog->size++] = in;
+  }
+  if (depth != 1 || prog->depth > S21_MAX_DEPTH) error = ERROR;
+  return error;
+}
+
+/*!
+ * \brief Компилирует список лексем в программу.
+ *
+ * Агрегаты (sum, prod, min, max) собираются в отдельные программы до
+ * проверки выражения, см. compile_aggregates. Число лексем и вложенность
+ * скобок сверяются с текущим бюджетом потока (см. s21_budget.h).
+ *
+ * \param st Список лексем, полученный от parse_all или parse_all_vars.
+ * Список освобождается.
+ * \param prog Указатель на заполняемую программу.
+ * \return OK при успешной компиляции, LIMITED при превышении лимитов,
+ * иначе ERROR.
+ */
+int compile_lexemes(stack *st, program *prog) {
+  program p = {0};
+  stack *postfix = NULL;
+  p.vars[p.nvars++] = 'x';
+  int error = st ? budget_check_lexemes(st) : ERROR;
+  if (error == OK && (compile_aggregates(&st, &p) == ERROR ||
+                      s21_validate(st) == ERROR))
+    error = ERROR;
+
+  if (error == OK) {
+    postfix = to_polish(&st);
+    error = emit_program(postfix, &p);
+  }
+  remove_stack(&st);
+  remove_stack(&postfix);
+
+  if (error != OK) remove_program(&p);
+  *prog = p;
+  return error;
+}
+
+/*!
+ * \brief Компилирует строку с выражением в программу.
+ *
+ * Строка разбирается на лексемы, проверяется и переводится в обратную
+ * польскую запись. Результат сохраняется в виде массива инструкций, который
+ * затем можно многократно вычислять функциями calc_program и
+ * calc_program_batch. Кроме x в выражении могут быть только индексы
+ * агрегатов, например k в sum(k, 1, 100, x^k).
+ *
+ * \param line Строка с выражением.
+ * \param prog Указатель на программу, которая будет заполнена. После
+ * использования её нужно освободить функцией remove_program.
+ * \return OK при успешной компиляции, иначе ERROR.
+ */
+int compile_program(const char *line, program *prog) {
+  // индексы агрегатов разбираются как переменные, но свободной может
+  // остаться только x
+  int error = compile_lexemes(parse_all_vars(line), prog);
+  if (error == OK && prog->nvars > 1) {
+    remove_program(prog);
+    error = ERROR;
+  }
+  return error;
+}
+
+/*!
+ * \brief Компилирует выражение, в котором кроме x могут встречаться другие
+ * переменные — строчные латинские буквы.
+ *
+ * Каждой переменной назначается слот; номер слота возвращает
+ * program_var_slot, значения передаются в calc_program_vars и
+ * calc_program_batch_vars.
+ *
+ * \param line Строка с выражением.
+ * \param prog Указатель на программу, которая будет заполнена.
+ * \return OK при успешной компиляции, иначе ERROR.
+ */
+int compile_program_vars(const char *line, program *prog) {
+  return compile_lexemes(parse_all_vars(line), prog);
+}
+
+/*!
+ * \brief Возвращает номер слота переменной.
+ *
+ * \param prog Указатель на программу.
+ * \param name Имя переменной.
+ * \return Номер слота или ERROR, если переменной в программе нет.
+ */
+int program_var_slot(const program *prog, char name) {
+  int slot = ERROR;
+  for (int i = 0; i < prog->nvars && slot == ERROR; i++)
+    if (prog->vars[i] == name) slot = i;
+  return slot;
+}
+
+/*!
+ * \brief Проверяет, использует ли программа слот переменной: напрямую или
+ * через вложенные агрегаты.
+ *
+ * Слот x есть в каждой программе, даже если x в выражении не встречается.
+ *
+ * \param prog Указатель на программу.
+ * \param slot Номер слота.
+ * \return TRUE или FALSE.
+ */
+int program_uses_slot(const program *prog, int slot) {
+  int used = FALSE;
+  for (int i = 0; !used && i < prog->size; i++)
+    used = prog->code[i].type == S_XOPERAND && prog->code[i].ival == slot;
+  for (int i = 0; !used && i < prog->naggs; i++) {
+    const aggregate *a = &prog->aggs[i];
+    for (int v = 0; !used && v < S21_MAX_VARS; v++)
+      used = a->lo_map[v] == slot || a->hi_map[v] == slot ||
+             a->body_map[v] == slot;
+  }
+  return used;
+}
+
+/*!
+ * \brief Вычисляет программу для одного значения x.
+ *
+ * Остальные переменные, если они есть, считаются равными нулю.
+ *
+ * \param prog Указатель на скомпилированную программу.
+ * \param x Значение переменной x.
+ * \param result Указатель на переменную для записи результата.
+ * \return OK при успешном вычислении, ERROR при делении на ноль или пустой
+ * программе.
+ */
+int calc_program(const program *prog, double x, double *result) {
+  double vars[S21_MAX_VARS] = {x};
+  return calc_program_vars(prog, vars, result);
+}
+
+/*!
+ * \brief Вычисляет программу для заданных значений переменных.
+ *
+ * Если у программы выбрана точность P_DDOUBLE, вычисление идёт с
+ * двойной-двойной точностью, а результат округляется до double.
+ *
+ * \param prog Указатель на скомпилированную программу.
+ * \param vars Значения переменных по слотам, не меньше prog->nvars
+ * элементов.
+ * \param result Указатель на переменную для записи результата.
+ * \return OK при успешном вычислении, ERROR при делении на ноль или пустой
+ * программе, LIMITED при исчерпании текущего бюджета потока.
+ */
+int calc_program_vars(const program *prog, const double *vars,
+                      double *result) {
+  if (prog == NULL || prog->size == 0) return ERROR;
+  if (prog->precision == P_DDOUBLE) {
+    ddouble dvars[S21_MAX_VARS];
+    for (int i = 0; i < prog->nvars; i++) dvars[i] = dd_from(vars[i]);
+    ddouble r = dd_from(0);
+    int error = calc_program_dd(prog, dvars, &r);
+    *result = r.hi + r.lo;
+    return error;
+  }
+  if (budget_charge(prog->size) != OK) {
+    *result = NAN;
+    return LIMITED;
+  }
+  int error = OK;
+  double st[S21_MAX_DEPTH];
+  int top = -1;
+  for (int i = 0; i < prog->size; i++) {
+    const instr *in = &prog->code[i];
+    if (in->type == S_DOUBLE) {
+      st[++top] = prog->consts[in->ival];
+    } else if (in->type == S_XOPERAND) {
+      st[++top] = vars[in->ival];
+    } else if (in->type == S_AGGVALUE) {
+      int status = calc_aggregate(prog, in->ival, vars, &st[++top]);
+      if (status != OK && error != LIMITED) error = status;
+    } else if (in->type == S_OPERAND) {
+      if (in->ival == '/' && st[top] == 0) error = ERROR;
+      st[top - 1] = apply_bioperand(in->ival, st[top - 1], st[top]);
+      top--;
+    } else {
+      st[top] = apply_uoperand(in->ival, st[top]);
+    }
+  }
+  *result = st[0];
+  return error;
+}
+
+/*!
+ * \brief Применяет бинарный оператор к блоку значений.
+ *
+ * Для самых частых операторов цикл записан явно, чтобы компилятор мог его
+ * векторизовать.
+ *
+ * \param op Код оператора.
+ * \param a Левые операнды, сюда же записывается результат.
+ * \param b Правые операнды.
+ * \param n Количество значений в блоке.
+ */
+static void batch_bioperand(int op, double *restrict a,
+                            const double *restrict b, int n) {
+  switch (op) {
+    case '+':
+      for (int i = 0; i < n; i++) a[i] += b[i];
+      break;
+    case '-':
+      for (int i = 0; i < n; i++) a[i] -= b[i];
+      break;
+    case '*':
+      for (int i = 0; i < n; i++) a[i] *= b[i];
+      break;
+    case '/':
+      for (int i = 0; i < n; i++) a[i] /= b[i];
+      break;
+    default:
+      for (int i = 0; i < n; i++) a[i] = apply_bioperand(op, a[i], b[i]);
+      break;
+  }
+}
+
+/*!
+ * \brief Вычисляет программу для массива значений x.
+ *
+ * Остальные переменные, если они есть, считаются равными нулю.
+ *
+ * \param prog Указатель на скомпилированную программу.
+ * \param x Массив значений переменной x.
+ * \param y Массив для записи результатов, не меньше n элементов.
+ * \param n Количество точек.
+ * \return OK при успешном вычислении, иначе ERROR.
+ */
+int calc_program_batch(const program *prog, const double *x, double *y,
+                       int n) {
+  const double *cols[S21_MAX_VARS] = {x};
+  return calc_program_batch_vars(prog, cols, y, n);
+}
+
+/*!
+ * \brief Вычисляет программу для столбцов значений переменных.
+ *
+ * Точки обрабатываются блоками по S21_CHUNK: каждая инструкция выполняется
+ * сразу для всего блока, поэтому разбор инструкции не повторяется для каждой
+ * точки. Ошибки вычисления (деление на ноль, выход из области определения)
+ * дают в соответствующих элементах inf или NaN. Программы с точностью
+ * P_DDOUBLE вычисляются поточечно. Операции списываются с текущего бюджета
+ * потока на каждый блок; после его исчерпания остальные точки получают NaN.
+ *
+ * \param prog Указатель на скомпилированную программу.
+ * \param cols Столбцы значений переменных по слотам, не меньше prog->nvars
+ * элементов. Столбец NULL означает переменную, равную нулю.
+ * \param y Массив для записи результатов, не меньше n элементов.
+ * \param n Количество точек.
+ * \return OK при успешном вычислении, LIMITED при исчерпании бюджета,
+ * иначе ERROR.
+ */
+int calc_program_batch_vars(const program *prog, const double *const *cols,
+                            double *y, int n) {
+  if (prog == NULL || prog->size == 0 || n < 0) return ERROR;
+  int error = OK;
+  if (prog->precision == P_DDOUBLE) {
+    for (int i = 0; i < n; i++) {
+      double vars[S21_MAX_VARS] = {0};
+      for (int v = 0; v < prog->nvars; v++)
+        if (cols[v]) vars[v] = cols[v][i];
+      if (error == OK && calc_program_vars(prog, vars, &y[i]) == LIMITED)
+        error = LIMITED;
+      if (error == LIMITED) y[i] = NAN;
+    }
+    return error;
+  }
+  double *regs = malloc(sizeof(double) * prog->depth * S21_CHUNK);
+  if (regs == NULL) return ERROR;
+  // агрегаты без переменных вычисляются один раз на весь вызов
+  double *fixed = fix_aggregates(prog);
+
+  for (int start = 0; start < n; start += S21_CHUNK) {
+    int len = n - start < S21_CHUNK ? n - start : S21_CHUNK;
+    if (error == OK && budget_charge((long long)prog->size * len) != OK)
+      error = LIMITED;
+    if (error == LIMITED) {
+      for (int k = 0; k < len; k++) y[start + k] = NAN;
+      continue;
+    }
+    int top = -1;
+    for (int i = 0; i < prog->size; i++) {
+      const instr *in = &prog->code[i];
+      if (in->type == S_DOUBLE) {
+        double *r = regs + (++top) * S21_CHUNK;
+        double c = prog->consts[in->ival];
+        for (int k = 0; k < len; k++) r[k] = c;
+      } else if (in->type == S_XOPERAND && cols[in->ival]) {
+        memcpy(regs + (++top) * S21_CHUNK, cols[in->ival] + start,
+               sizeof(double) * len);
+      } else if (in->type == S_XOPERAND) {
+        memset(regs + (++top) * S21_CHUNK, 0, sizeof(double) * len);
+      } else if (in->type == S_AGGVALUE) {
+        calc_aggregate_batch(prog, in->ival, cols, start, len, fixed,
+                             regs + (++top) * S21_CHUNK);
+      } else if (in->type == S_OPERAND) {
+        top--;
+        batch_bioperand(in->ival, regs + top * S21_CHUNK,
+                        regs + (top + 1) * S21_CHUNK, len);
+      } else {
+        double *r = regs + top * S21_CHUNK;
+        for (int k = 0; k < len; k++) r[k] = apply_uoperand(in->ival, r[k]);
+      }
+    }
+    memcpy(y + start, regs, sizeof(double) * len);
+  }
+  free(fixed);
+  free(regs);
+  // агрегат мог исчерпать бюджет в последнем блоке
+  if (budget_status(budget_current()) != OK) error = LIMITED;
+  return error;
+}
+
+/*!
+ * \brief Освобождает память, занятую программой.
+ *
+ * \param prog Указатель на программу.
+ */
+void remove_program(program *prog) {
+  if (prog == NULL) return;
+  remove_aggregates(prog);
+  free(prog->code);
+  free(prog->consts);
+  free(prog->consts_lo);
+  prog->code = NULL;
+  prog->consts = NULL;
+  prog->consts_lo = NULL;
+  prog->size = 0;
+  prog->nconsts = 0;
+  prog->depth = 0;
+  prog->precision = P_DOUBLE;
+  prog->nvars = 0;
+}
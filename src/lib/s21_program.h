@@ -0,0 +1,76 @@
+#ifndef S21_PROGRAM_H
+#define S21_PROGRAM_H
+
+#include "s21_datatypes.h"
+
+//! Максимальная глубина стека вычислений скомпилированной программы.
+#define S21_MAX_DEPTH 256
+
+//! Размер блока пакетного вычисления (число точек за один проход).
+#define S21_CHUNK 256
+
+//! Максимальное число переменных в программе.
+#define S21_MAX_VARS 26
+
+//! Точность вычисления программы: обычный double.
+#define P_DOUBLE 0
+
+//! Точность вычисления программы: двойная-двойная (около 32 цифр).
+#define P_DDOUBLE 1
+
+/*!
+ * \struct instr
+ * \brief Инструкция скомпилированной программы.
+ *
+ * Поле type совпадает с типом лексемы (S_DOUBLE, S_XOPERAND, S_OPERAND,
+ * S_UOPERAND, S_FUNC). Поле ival хранит код оператора, номер функции,
+ * индекс константы в таблице program.consts или номер слота переменной.
+ */
+typedef struct instr {
+  int type;
+  int ival;
+} instr;
+
+/*!
+ * \struct program
+ * \brief Выражение, скомпилированное в плоскую обратную польскую запись.
+ *
+ * Программа компилируется один раз и затем вычисляется для любого количества
+ * значений x без повторного разбора строки. Для каждой константы, кроме
+ * значения double, хранится поправка consts_lo до точной десятичной записи,
+ * которая используется в режиме P_DDOUBLE. Поле precision выбирает точность
+ * вычисления для конкретного выражения.
+ *
+ * Переменные хранятся в слотах: vars[i] — имя переменной в слоте i.
+ * Переменная x всегда занимает слот 0. Агрегаты (sum, prod, min, max)
+ * хранятся отдельно в aggs, инструкция S_AGGVALUE ссылается на них по
+ * номеру.
+ */
+typedef struct program {
+  instr *code;
+  int size;
+  double *consts;
+  double *consts_lo;
+  int nconsts;
+  int depth;
+  int precision;
+  char vars[S21_MAX_VARS];
+  int nvars;
+  struct aggregate *aggs;
+  int naggs;
+} program;
+
+int compile_lexemes(stack *st, program *prog);
+int compile_program(const char *line, program *prog);
+int compile_program_vars(const char *line, program *prog);
+int program_var_slot(const program *prog, char name);
+int program_uses_slot(const program *prog, int slot);
+int calc_program(const program *prog, double x, double *result);
+int calc_program_vars(const program *prog, const double *vars,
+                      double *result);
+int calc_program_batch(const program *prog, const double *x, double *y,
+                       int n);
+int calc_program_batch_vars(const program *prog, const double *const *cols,
+                            double *y, int n);
+void remove_program(program *prog);
+#endif
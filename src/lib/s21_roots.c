@@ -0,0 +1,268 @@
+/*!
+ * \file s21_roots.h
+ * \brief Поиск нулей и экстремумов функции на отрезке
+ *
+ * Отрезок сначала грубо сканируется: значения функции и её производных
+ * вычисляются параллельно в общем пуле потоков через пакетный вычислитель
+ * дуальных чисел. Смены знака f дают интервалы с нулями, смены знака f' —
+ * интервалы с экстремумами. Каждый интервал затем уточняется методом Ньютона
+ * с защитой делением пополам, производные для которого берутся из того же
+ * дуального вычисления.
+ */
+#include "s21_roots.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "s21_budget.h"
+#include "s21_dual.h"
+
+//! Максимальное число итераций уточнения одного корня.
+#define R_MAX_ITER 100
+
+/*!
+ * \struct bracket
+ * \brief Интервал, на котором функция (или её производная) меняет знак.
+ */
+typedef struct bracket {
+  double a;
+  double b;
+  double ga;
+  double gb;
+  int kind;
+} bracket;
+
+/*!
+ * \struct root_task
+ * \brief Задание: вся сетка или все интервалы либо их часть.
+ */
+typedef struct root_task {
+  const program *prog;
+  const double *x;
+  dual *d;
+  int n;
+  const bracket *br;
+  root *out;
+  int *found;
+} root_task;
+
+/*!
+ * \struct root_job
+ * \brief Задание пула: общее задание и функция обработки его части.
+ */
+typedef struct root_job {
+  root_task base;
+  void *(*worker)(void *);
+  budget *budget;
+} root_job;
+
+/*!
+ * \brief Вычисляет уточняемую функцию: f для нулей и f' для экстремумов.
+ *
+ * \param prog Указатель на программу.
+ * \param x Точка.
+ * \param kind Вид особой точки.
+ * \param g Указатель для записи значения функции.
+ * \param dg Указатель для записи её производной.
+ * \return Значение f(x).
+ */
+static double root_eval(const program *prog, double x, int kind, double *g,
+                        double *dg) {
+  dual d = {0};
+  calc_program_dual(prog, x, kind == R_ZERO ? 1 : 2, &d);
+  *g = kind == R_ZERO ? d.v : d.d1;
+  *dg = kind == R_ZERO ? d.d1 : d.d2;
+  return d.v;
+}
+
+/*!
+ * \brief Уточняет корень на интервале со сменой знака.
+ *
+ * Шаг Ньютона принимается, только если он остаётся внутри текущего
+ * интервала; иначе интервал делится пополам. Интервал сужается по знаку
+ * функции в новой точке, поэтому сходимость гарантирована.
+ *
+ * \param prog Указатель на программу.
+ * \param br Интервал со сменой знака.
+ * \param res Указатель для записи найденной точки.
+ * \return OK, если найден корень, ERROR для разрыва функции (например,
+ * полюса tan).
+ */
+static int refine_root(const program *prog, const bracket *br, root *res) {
+  double a = br->a, b = br->b;
+  double ga = br->ga;
+  double x = 0.5 * (a + b);
+  double g = 0, dg = 0;
+  double fx = root_eval(prog, x, br->kind, &g, &dg);
+  for (int i = 0; i < R_MAX_ITER && g != 0; i++) {
+    if ((g < 0) == (ga < 0)) {
+      a = x;
+      ga = g;
+    } else {
+      b = x;
+    }
+    double next = x - g / dg;
+    if (!isfinite(next) || next <= a || next >= b) next = 0.5 * (a + b);
+    if (fabs(next - x) <= 4 * DBL_EPSILON * (1 + fabs(x))) break;
+    x = next;
+    fx = root_eval(prog, x, br->kind, &g, &dg);
+    if (b - a <= 4 * DBL_EPSILON * (1 + fabs(x))) break;
+  }
+  res->x = x;
+  res->y = fx;
+  res->kind = br->kind;
+  // на разрыве знак меняется через бесконечность, а не через ноль
+  return fabs(g) <= 1e-6 * (1 + fabs(br->ga) + fabs(br->gb)) ? OK : ERROR;
+}
+
+/*!
+ * \brief Поток грубого сканирования: вычисляет f, f' и f'' на части сетки.
+ */
+static void *scan_worker(void *arg) {
+  root_task *t = arg;
+  calc_program_dual_batch(t->prog, t->x, 2, t->d, t->n);
+  return NULL;
+}
+
+/*!
+ * \brief Поток уточнения: уточняет свою часть интервалов.
+ */
+static void *refine_worker(void *arg) {
+  root_task *t = arg;
+  for (int i = 0; i < t->n; i++)
+    t->found[i] = refine_root(t->prog, &t->br[i], &t->out[i]);
+  return NULL;
+}
+
+/*!
+ * \brief Обрабатывает элементы задания с from по to: сдвигает массивы
+ * задания на начало диапазона и вызывает его функцию в бюджете вызвавшего
+ * потока.
+ */
+static void root_range(void *arg, int from, int to) {
+  const root_job *job = arg;
+  budget *prev = budget_enter(job->budget);
+  root_task t = job->base;
+  t.n = to - from;
+  if (t.x) t.x += from;
+  if (t.d) t.d += from;
+  if (t.br) t.br += from;
+  if (t.out) t.out += from;
+  if (t.found) t.found += from;
+  job->worker(&t);
+  budget_enter(prev);
+}
+
+/*!
+ * \brief Выполняет задание для n элементов в пуле потоков.
+ *
+ * Время уточнения интервалов сильно различается (у разрывов и кратных
+ * корней итераций больше), поэтому элементы распределяются пулом с
+ * перехватом работы, а не поровну между потоками.
+ *
+ * \param base Задание для всех элементов.
+ * \param n Количество элементов.
+ * \param pool Пул потоков или NULL для вычисления в вызывающем потоке.
+ * \param worker Функция обработки части задания.
+ */
+static void run_parallel(root_task base, int n, work_pool *pool,
+                         void *(*worker)(void *)) {
+  root_job job = {base, worker, budget_current()};
+  pool_run(pool, n, root_range, &job);
+}
+
+/*!
+ * \brief Сравнивает особые точки по x для qsort.
+ */
+static int compare_roots(const void *a, const void *b) {
+  double xa = ((const root *)a)->x, xb = ((const root *)b)->x;
+  return (xa > xb) - (xa < xb);
+}
+
+/*!
+ * \brief Добавляет интервал со сменой знака, если она есть.
+ *
+ * Производная по x (для экстремумов) на концах интервала задаёт вид
+ * точки: переход с минуса на плюс — минимум, с плюса на минус — максимум.
+ *
+ * \return Новое количество интервалов.
+ */
+static int add_bracket(bracket *br, int count, double a, double b, double ga,
+                       double gb, int kind) {
+  if (isfinite(ga) && isfinite(gb) && ((ga < 0 && gb > 0) ||
+                                       (ga > 0 && gb < 0) || gb == 0)) {
+    bracket item = {a, b, ga, gb, kind};
+    br[count++] = item;
+  }
+  return count;
+}
+
+/*!
+ * \brief Находит нули, минимумы и максимумы функции на отрезке.
+ *
+ * \param prog Указатель на скомпилированную программу.
+ * \param x_min Левая граница отрезка.
+ * \param x_max Правая граница отрезка.
+ * \param scan Число шагов грубого сканирования (0 — R_DEFAULT_SCAN). Корни,
+ * расположенные ближе шага сканирования, могут быть пропущены.
+ * \param threads Число потоков: 0 — общий пул библиотеки (см. pool_shared),
+ * 1 — вызывающий поток, иначе отдельный пул из threads потоков на время
+ * вызова.
+ * \param out Массив для записи найденных точек в порядке возрастания x.
+ * \param max_out Размер массива out.
+ * \return Количество найденных точек, ERROR или LIMITED при исчерпании
+ * текущего бюджета потока.
+ */
+int find_roots(const program *prog, double x_min, double x_max, int scan,
+               int threads, root *out, int max_out) {
+  if (prog == NULL || prog->size == 0 || !(x_min < x_max) || threads < 0)
+    return ERROR;
+  if (scan <= 0) scan = R_DEFAULT_SCAN;
+
+  double *x = malloc(sizeof(double) * (scan + 1));
+  dual *d = malloc(sizeof(dual) * (scan + 1));
+  bracket *br = malloc(sizeof(bracket) * 2 * (scan + 1));
+  root *res = malloc(sizeof(root) * 2 * (scan + 1));
+  int *found = malloc(sizeof(int) * 2 * (scan + 1));
+  int count = ERROR;
+  work_pool *own = NULL;
+  work_pool *pool = threads == 0 ? pool_shared() : NULL;
+  // если пул не создался, вычисление идёт в вызывающем потоке
+  if (threads > 1 && pool_create(threads, FALSE, &own) == OK) pool = own;
+
+  if (x && d && br && res && found) {
+    double h = (x_max - x_min) / scan;
+    for (int i = 0; i <= scan; i++) x[i] = x_min + i * h;
+    root_task task = {prog, x, d, 0, NULL, NULL, NULL};
+    run_parallel(task, scan + 1, pool, scan_worker);
+
+    int nbr = 0;
+    if (d[0].v == 0) nbr = add_bracket(br, nbr, x[0], x[0], 0, 0, R_ZERO);
+    for (int i = 0; i < scan; i++) {
+      nbr = add_bracket(br, nbr, x[i], x[i + 1], d[i].v, d[i + 1].v, R_ZERO);
+      nbr = add_bracket(br, nbr, x[i], x[i + 1], d[i].d1, d[i + 1].d1,
+                        d[i].d1 < 0 ? R_MIN : R_MAX);
+    }
+
+    root_task refine = {prog, NULL, NULL, 0, br, res, found};
+    run_parallel(refine, nbr, pool, refine_worker);
+
+    // нуль и экстремум из одной ячейки сетки уточняются в порядке
+    // интервалов, а не по x
+    int nres = 0;
+    for (int i = 0; i < nbr; i++)
+      if (found[i] == OK) res[nres++] = res[i];
+    qsort(res, nres, sizeof(root), compare_roots);
+    for (count = 0; count < nres && count < max_out; count++)
+      out[count] = res[count];
+  }
+  if (budget_status(budget_current()) != OK) count = LIMITED;
+  pool_destroy(own);
+  free(x);
+  free(d);
+  free(br);
+  free(res);
+  free(found);
+  return count;
+}
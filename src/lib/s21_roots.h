@@ -0,0 +1,38 @@
+#ifndef S21_ROOTS_H
+#define S21_ROOTS_H
+
+#include "s21_pool.h"
+#include "s21_program.h"
+
+/*!
+ * \defgroup RootMacros Виды особых точек
+ * @{
+ */
+
+//! Нуль функции.
+#define R_ZERO 0
+
+//! Локальный минимум.
+#define R_MIN 1
+
+//! Локальный максимум.
+#define R_MAX 2
+
+/*! @} */
+
+//! Число шагов грубого сканирования по умолчанию.
+#define R_DEFAULT_SCAN 4096
+
+/*!
+ * \struct root
+ * \brief Найденная особая точка функции.
+ */
+typedef struct root {
+  double x;
+  double y;
+  int kind;
+} root;
+
+int find_roots(const program *prog, double x_min, double x_max, int scan,
+               int threads, root *out, int max_out);
+#endif
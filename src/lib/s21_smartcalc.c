@@ -0,0 +1,417 @@
+/*!
+ * \file s21_smartcalc.h
+ * \brief Публичный интерфейс библиотеки libsmartcalc
+ *
+ * Тонкая обёртка над скомпилированными программами: дескриптор sc_program
+ * содержит структуру program, а функции интерфейса проверяют аргументы и
+ * передают вызов внутреннему вычислителю.
+ */
+#include "s21_smartcalc.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "s21_budget.h"
+#include "s21_datatypes.h"
+#include "s21_library.h"
+#include "s21_pool.h"
+#include "s21_program.h"
+
+_Static_assert(SC_OK == OK && SC_ERROR == ERROR && SC_LIMIT == LIMITED,
+               "status codes differ");
+_Static_assert(SC_MAX_VARS == S21_MAX_VARS, "variable limits differ");
+_Static_assert(SC_PRECISION_DOUBLE == P_DOUBLE &&
+                   SC_PRECISION_DDOUBLE == P_DDOUBLE,
+               "precision codes differ");
+
+/*!
+ * \struct sc_program
+ * \brief Скомпилированное выражение, скрытое за дескриптором.
+ */
+struct sc_program {
+  program prog;
+};
+
+/*!
+ * \struct sc_library
+ * \brief Библиотека выражений и дескрипторы её программ.
+ */
+struct sc_library {
+  program_library lib;
+  sc_program *handles;
+};
+
+/*!
+ * \brief Возвращает версию интерфейса, с которой собрана библиотека.
+ *
+ * \return SC_API_VERSION.
+ */
+int sc_api_version(void) { return SC_API_VERSION; }
+
+/*!
+ * \brief Компилирует выражение с переменными (строчные латинские буквы).
+ *
+ * \param line Строка с выражением.
+ * \param handle Указатель для записи дескриптора. При ошибке записывается
+ * NULL. Дескриптор освобождается функцией sc_free.
+ * \return SC_OK или SC_ERROR.
+ */
+int sc_compile(const char *line, sc_program **handle) {
+  if (handle == NULL) return SC_ERROR;
+  *handle = NULL;
+  if (line == NULL) return SC_ERROR;
+  sc_program *p = malloc(sizeof(sc_program));
+  int error = p ? compile_program_vars(line, &p->prog) : ERROR;
+  if (error == OK)
+    *handle = p;
+  else
+    free(p);
+  return error;
+}
+
+/*!
+ * \brief Выбирает точность вычисления выражения.
+ *
+ * \param handle Дескриптор выражения.
+ * \param precision SC_PRECISION_DOUBLE или SC_PRECISION_DDOUBLE.
+ * \return SC_OK или SC_ERROR при неизвестной точности.
+ */
+int sc_set_precision(sc_program *handle, int precision) {
+  if (handle == NULL ||
+      (precision != P_DOUBLE && precision != P_DDOUBLE))
+    return SC_ERROR;
+  handle->prog.precision = precision;
+  return SC_OK;
+}
+
+/*!
+ * \brief Возвращает число слотов переменных (x всегда занимает слот 0).
+ *
+ * \param handle Дескриптор выражения.
+ * \return Число слотов или SC_ERROR.
+ */
+int sc_var_count(const sc_program *handle) {
+  return handle ? handle->prog.nvars : SC_ERROR;
+}
+
+/*!
+ * \brief Возвращает номер слота переменной.
+ *
+ * \param handle Дескриптор выражения.
+ * \param name Имя переменной.
+ * \return Номер слота или SC_ERROR, если переменной в выражении нет.
+ */
+int sc_var_slot(const sc_program *handle, char name) {
+  return handle ? program_var_slot(&handle->prog, name) : SC_ERROR;
+}
+
+/*!
+ * \brief Вычисляет выражение для одного значения x.
+ *
+ * \param handle Дескриптор выражения.
+ * \param x Значение x; остальные переменные равны нулю.
+ * \param result Указатель для записи результата.
+ * \return SC_OK или SC_ERROR (например, при делении на ноль).
+ */
+int sc_eval(const sc_program *handle, double x, double *result) {
+  if (handle == NULL || result == NULL) return SC_ERROR;
+  return calc_program(&handle->prog, x, result);
+}
+
+/*!
+ * \brief Вычисляет выражение для заданных значений переменных.
+ *
+ * \param handle Дескриптор выражения.
+ * \param vars Значения по слотам, не меньше sc_var_count элементов.
+ * \param result Указатель для записи результата.
+ * \return SC_OK или SC_ERROR.
+ */
+int sc_eval_vars(const sc_program *handle, const double *vars,
+                 double *result) {
+  if (handle == NULL || vars == NULL || result == NULL) return SC_ERROR;
+  return calc_program_vars(&handle->prog, vars, result);
+}
+
+/*!
+ * \brief Вычисляет выражение для массива значений x.
+ *
+ * Ошибки в отдельных точках дают в результате inf или NaN.
+ *
+ * \param handle Дескриптор выражения.
+ * \param x Массив значений x.
+ * \param y Массив для записи результатов.
+ * \param n Количество точек.
+ * \return SC_OK или SC_ERROR.
+ */
+int sc_eval_batch(const sc_program *handle, const double *x, double *y,
+                  int n) {
+  if (handle == NULL || x == NULL || y == NULL) return SC_ERROR;
+  return calc_program_batch(&handle->prog, x, y, n);
+}
+
+/*!
+ * \brief Вычисляет выражение для столбцов значений переменных.
+ *
+ * \param handle Дескриптор выражения.
+ * \param cols Столбцы по слотам, не меньше sc_var_count элементов; NULL
+ * означает переменную, равную нулю.
+ * \param y Массив для записи результатов.
+ * \param n Количество точек.
+ * \return SC_OK или SC_ERROR.
+ */
+int sc_eval_batch_vars(const sc_program *handle, const double *const *cols,
+                       double *y, int n) {
+  if (handle == NULL || cols == NULL || y == NULL) return SC_ERROR;
+  return calc_program_batch_vars(&handle->prog, cols, y, n);
+}
+
+/*!
+ * \struct sc_many
+ * \brief Задание пула для sc_eval_many.
+ */
+typedef struct sc_many {
+  const sc_program *const *handles;
+  const double *x;
+  double *y;
+} sc_many;
+
+/*!
+ * \brief Вычисляет выражения задания sc_eval_many с from по to.
+ */
+static void eval_many_range(void *arg, int from, int to) {
+  const sc_many *job = arg;
+  for (int i = from; i < to; i++)
+    if (job->handles[i] == NULL ||
+        calc_program(&job->handles[i]->prog, job->x[i], &job->y[i]) != OK)
+      job->y[i] = NAN;
+}
+
+/*!
+ * \brief Вычисляет много разных выражений: y[i] = handles[i](x[i]).
+ *
+ * Выражения вычисляются в общем пуле потоков библиотеки. Их стоимость может
+ * сильно различаться: пул делит работу по измеренному времени и
+ * перераспределяет её между потоками. Ошибка в отдельном выражении (или
+ * NULL вместо дескриптора) даёт в результате NaN.
+ *
+ * \param handles Дескрипторы выражений.
+ * \param x Значения x для каждого выражения.
+ * \param y Массив для записи результатов.
+ * \param n Количество выражений.
+ * \return SC_OK или SC_ERROR.
+ */
+int sc_eval_many(const sc_program *const *handles, const double *x, double *y,
+                 int n) {
+  if (handles == NULL || x == NULL || y == NULL || n < 0) return SC_ERROR;
+  sc_many job = {handles, x, y};
+  pool_run(pool_shared(), n, eval_many_range, &job);
+  return SC_OK;
+}
+
+/*!
+ * \brief Освобождает скомпилированное выражение.
+ *
+ * \param handle Дескриптор выражения (может быть NULL).
+ */
+void sc_free(sc_program *handle) {
+  if (handle == NULL) return;
+  remove_program(&handle->prog);
+  free(handle);
+}
+
+/*!
+ * \brief Создаёт бюджет по лимитам вызова и делает его текущим для потока.
+ *
+ * \param limits Лимиты вызова.
+ * \param b Указатель для записи бюджета.
+ * \param prev Указатель для записи прежнего бюджета потока.
+ * \return OK или ERROR.
+ */
+static int limits_enter(const sc_limits *limits, budget **b, budget **prev) {
+  eval_limits lim = {limits->max_tokens, limits->max_depth, limits->max_ops,
+                     limits->timeout_ms, limits->cancel};
+  int error = budget_create(&lim, b);
+  if (error == OK) *prev = budget_enter(*b);
+  return error;
+}
+
+/*!
+ * \brief Возвращает потоку прежний бюджет и освобождает бюджет вызова.
+ */
+static void limits_leave(budget *b, budget *prev) {
+  budget_enter(prev);
+  budget_destroy(b);
+}
+
+/*!
+ * \brief Компилирует выражение с ограничением числа лексем и вложенности
+ * скобок.
+ *
+ * \param line Строка с выражением.
+ * \param limits Лимиты; используются max_tokens, max_depth, timeout_ms и
+ * cancel.
+ * \param handle Указатель для записи дескриптора (NULL при ошибке).
+ * \return SC_OK, SC_ERROR или SC_LIMIT.
+ */
+int sc_compile_limited(const char *line, const sc_limits *limits,
+                       sc_program **handle) {
+  budget *b = NULL, *prev = NULL;
+  if (limits == NULL || limits_enter(limits, &b, &prev) != OK)
+    return SC_ERROR;
+  int error = sc_compile(line, handle);
+  limits_leave(b, prev);
+  return error;
+}
+
+/*!
+ * \brief Вычисляет выражение для заданных значений переменных в пределах
+ * лимитов.
+ *
+ * \param handle Дескриптор выражения.
+ * \param vars Значения по слотам, не меньше sc_var_count элементов.
+ * \param limits Лимиты; используются max_ops, timeout_ms и cancel.
+ * \param result Указатель для записи результата (NaN при SC_LIMIT).
+ * \return SC_OK, SC_ERROR или SC_LIMIT.
+ */
+int sc_eval_limited(const sc_program *handle, const double *vars,
+                    const sc_limits *limits, double *result) {
+  budget *b = NULL, *prev = NULL;
+  if (limits == NULL || limits_enter(limits, &b, &prev) != OK)
+    return SC_ERROR;
+  int error = sc_eval_vars(handle, vars, result);
+  limits_leave(b, prev);
+  return error;
+}
+
+/*!
+ * \brief Вычисляет выражение для столбцов значений в пределах лимитов.
+ *
+ * Все точки расходуют один общий бюджет; после его исчерпания остальные
+ * точки получают NaN.
+ *
+ * \param handle Дескриптор выражения.
+ * \param cols Столбцы по слотам (NULL — переменная равна нулю).
+ * \param y Массив для записи результатов.
+ * \param n Количество точек.
+ * \param limits Лимиты; используются max_ops, timeout_ms и cancel.
+ * \return SC_OK, SC_ERROR или SC_LIMIT.
+ */
+int sc_eval_batch_limited(const sc_program *handle,
+                          const double *const *cols, double *y, int n,
+                          const sc_limits *limits) {
+  budget *b = NULL, *prev = NULL;
+  if (limits == NULL || limits_enter(limits, &b, &prev) != OK)
+    return SC_ERROR;
+  int error = sc_eval_batch_vars(handle, cols, y, n);
+  limits_leave(b, prev);
+  return error;
+}
+
+/*!
+ * \brief Сохраняет выражения в файл библиотеки.
+ *
+ * \param path Путь к файлу библиотеки.
+ * \param handles Дескрипторы выражений.
+ * \param names Уникальные имена выражений.
+ * \param count Количество выражений.
+ * \return SC_OK или SC_ERROR.
+ */
+int sc_library_save(const char *path, const sc_program *const *handles,
+                    const char *const *names, int count) {
+  if (path == NULL || count < 0 || (count && (!handles || !names)))
+    return SC_ERROR;
+  program *progs = malloc(sizeof(program) * (count + 1));
+  int error = progs ? OK : ERROR;
+  for (int i = 0; error == OK && i < count; i++) {
+    if (handles[i] == NULL || names[i] == NULL)
+      error = ERROR;
+    else
+      progs[i] = handles[i]->prog;
+  }
+  if (error == OK) error = save_library(path, progs, names, count);
+  free(progs);
+  return error;
+}
+
+/*!
+ * \brief Открывает файл библиотеки выражений.
+ *
+ * Выражения библиотеки принадлежат ей: их нельзя передавать в sc_free и
+ * sc_set_precision, они действительны до sc_library_close.
+ *
+ * \param path Путь к файлу библиотеки.
+ * \param library Указатель для записи дескриптора (NULL при ошибке).
+ * \return SC_OK или SC_ERROR.
+ */
+int sc_library_open(const char *path, sc_library **library) {
+  if (library == NULL) return SC_ERROR;
+  *library = NULL;
+  if (path == NULL) return SC_ERROR;
+  sc_library *l = calloc(1, sizeof(sc_library));
+  int error = l ? open_library(path, &l->lib) : ERROR;
+  if (error == OK) {
+    l->handles = malloc(sizeof(sc_program) * (l->lib.count + 1));
+    if (l->handles == NULL) error = ERROR;
+  }
+  for (int i = 0; error == OK && i < l->lib.count; i++)
+    l->handles[i].prog = l->lib.progs[i];
+  if (error == OK) {
+    *library = l;
+  } else if (l) {
+    close_library(&l->lib);
+    free(l);
+  }
+  return error;
+}
+
+/*!
+ * \brief Возвращает число выражений в библиотеке.
+ *
+ * \return Число выражений или SC_ERROR.
+ */
+int sc_library_count(const sc_library *library) {
+  return library ? library->lib.count : SC_ERROR;
+}
+
+/*!
+ * \brief Возвращает имя выражения библиотеки по номеру.
+ *
+ * \return Имя или NULL для неверного номера.
+ */
+const char *sc_library_name(const sc_library *library, int index) {
+  return library ? library_name(&library->lib, index) : NULL;
+}
+
+/*!
+ * \brief Возвращает выражение библиотеки по номеру.
+ *
+ * \return Дескриптор или NULL для неверного номера.
+ */
+const sc_program *sc_library_at(const sc_library *library, int index) {
+  if (library == NULL || index < 0 || index >= library->lib.count)
+    return NULL;
+  return &library->handles[index];
+}
+
+/*!
+ * \brief Ищет выражение библиотеки по имени.
+ *
+ * \return Дескриптор или NULL, если выражения с таким именем нет.
+ */
+const sc_program *sc_library_get(const sc_library *library,
+                                 const char *name) {
+  if (library == NULL || name == NULL) return NULL;
+  return sc_library_at(library, library_find(&library->lib, name));
+}
+
+/*!
+ * \brief Закрывает библиотеку выражений.
+ *
+ * \param library Дескриптор библиотеки (может быть NULL).
+ */
+void sc_library_close(sc_library *library) {
+  if (library == NULL) return;
+  close_library(&library->lib);
+  free(library->handles);
+  free(library);
+}
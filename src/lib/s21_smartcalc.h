@@ -0,0 +1,116 @@
+#ifndef S21_SMARTCALC_H
+#define S21_SMARTCALC_H
+
+/*!
+ * \defgroup SmartCalcApi Публичный интерфейс библиотеки libsmartcalc
+ * @{
+ * \brief Стабильный C-интерфейс для подключения вычислителя к другим
+ * программам.
+ *
+ * Скомпилированное выражение доступно только через непрозрачный указатель
+ * sc_program. Его можно хранить сколько угодно долго и вычислять из
+ * нескольких потоков одновременно: функции вычисления программу не изменяют.
+ * Заголовок не зависит от внутренних заголовков библиотеки.
+ *
+ * Выражения можно сохранить в файл библиотеки (sc_library_save) и при
+ * следующем запуске открыть его без повторной компиляции
+ * (sc_library_open). Файл отображается в память только для чтения, поэтому
+ * несколько процессов, открывших одну библиотеку, разделяют её страницы.
+ *
+ * Функции с суффиксом _limited выполняются в пределах лимитов sc_limits и
+ * при их превышении или отмене быстро завершаются с кодом SC_LIMIT.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__) && defined(SC_BUILD)
+#define SC_API __attribute__((visibility("default")))
+#else
+#define SC_API
+#endif
+
+//! Версия интерфейса; меняется при несовместимых изменениях.
+#define SC_API_VERSION 1
+
+//! Код успешного завершения (совпадает с OK библиотеки).
+#define SC_OK 1
+
+//! Код ошибки (совпадает с ERROR библиотеки).
+#define SC_ERROR -1
+
+//! Код превышения лимита или отмены вычисления (совпадает с LIMITED).
+#define SC_LIMIT -2
+
+//! Точность вычисления: обычный double.
+#define SC_PRECISION_DOUBLE 0
+
+//! Точность вычисления: двойная-двойная (около 32 цифр).
+#define SC_PRECISION_DDOUBLE 1
+
+//! Максимальное число переменных в выражении.
+#define SC_MAX_VARS 26
+
+//! Непрозрачный дескриптор скомпилированного выражения.
+typedef struct sc_program sc_program;
+
+//! Непрозрачный дескриптор библиотеки выражений, отображённой в память.
+typedef struct sc_library sc_library;
+
+/*!
+ * \struct sc_limits
+ * \brief Лимиты одного вызова; нулевое поле снимает ограничение.
+ *
+ * Флаг cancel (может быть NULL) проверяется по ходу вычисления; его нужно
+ * записывать атомарно, например __atomic_store_n.
+ */
+typedef struct sc_limits {
+  int max_tokens;
+  int max_depth;
+  long long max_ops;
+  long long timeout_ms;
+  const int *cancel;
+} sc_limits;
+
+SC_API int sc_api_version(void);
+SC_API int sc_compile(const char *line, sc_program **handle);
+SC_API int sc_set_precision(sc_program *handle, int precision);
+SC_API int sc_var_count(const sc_program *handle);
+SC_API int sc_var_slot(const sc_program *handle, char name);
+SC_API int sc_eval(const sc_program *handle, double x, double *result);
+SC_API int sc_eval_vars(const sc_program *handle, const double *vars,
+                        double *result);
+SC_API int sc_eval_batch(const sc_program *handle, const double *x,
+                         double *y, int n);
+SC_API int sc_eval_batch_vars(const sc_program *handle,
+                              const double *const *cols, double *y, int n);
+SC_API int sc_eval_many(const sc_program *const *handles, const double *x,
+                        double *y, int n);
+SC_API void sc_free(sc_program *handle);
+
+SC_API int sc_compile_limited(const char *line, const sc_limits *limits,
+                              sc_program **handle);
+SC_API int sc_eval_limited(const sc_program *handle, const double *vars,
+                           const sc_limits *limits, double *result);
+SC_API int sc_eval_batch_limited(const sc_program *handle,
+                                 const double *const *cols, double *y, int n,
+                                 const sc_limits *limits);
+
+SC_API int sc_library_save(const char *path, const sc_program *const *handles,
+                           const char *const *names, int count);
+SC_API int sc_library_open(const char *path, sc_library **library);
+SC_API int sc_library_count(const sc_library *library);
+SC_API const char *sc_library_name(const sc_library *library, int index);
+SC_API const sc_program *sc_library_at(const sc_library *library,
+                                       int index);
+SC_API const sc_program *sc_library_get(const sc_library *library,
+                                        const char *name);
+SC_API void sc_library_close(sc_library *library);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*! @} */
+#endif
@@ -32,8 +32,12 @@ int s21_validate(stack* root) {
     else if (root->type == S_FUNC)
       error = check_func(root);
     else if (root->type == S_INTEGER || root->type == S_DOUBLE ||
-             root->type == S_XOPERAND)
+             root->type == S_XOPERAND || root->type == S_AGGVALUE)
       error = check_number(root);
+    // агрегаты и запятые между их аргументами должны быть собраны
+    // compile_aggregates до проверки
+    else if (root->type == S_AGGREGATE)
+      error = ERROR;
 
     if (error == ERROR) break;
 
@@ -54,6 +58,7 @@ int s21_validate(stack* root) {
 int check_binar(stack* node) {
   int error = OK;
   if (node->ival == '(' || node->ival == ')') return OK;
+  if (node->ival == ',') return ERROR;
   if (node->prew == NULL || node->next == NULL) return ERROR;
 
   if (node->next->type == S_OPERAND && node->next->ival != ')')
@@ -110,7 +115,7 @@ int check_func(stack* node) {
   // скобки
   if (node->next != NULL &&
       (node->next->type == S_INTEGER || node->next->type == S_DOUBLE ||
-       node->next->type == S_XOPERAND ||
+       node->next->type == S_XOPERAND || node->next->type == S_AGGVALUE ||
        (node->next->type == S_OPERAND && node->next->ival == ')'))) {
     error = ERROR;
   }
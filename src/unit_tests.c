@@ -16,14 +16,36 @@
 */
 
 #include <check.h>
+#include <limits.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "lib/s21_budget.h"
 #include "lib/s21_creditcal.h"
 #include "lib/s21_datatypes.h"
+#include "lib/s21_depositcal.h"
+#include "lib/s21_ddouble.h"
+#include "lib/s21_dual.h"
+#include "lib/s21_integral.h"
+#include "lib/s21_library.h"
 #include "lib/s21_lexeme_parser.h"
 #include "lib/s21_polish.h"
+#include "lib/s21_pool.h"
+#include "lib/s21_portfolio.h"
+#include "lib/s21_preview.h"
+#include "lib/s21_program.h"
+#include "lib/s21_roots.h"
+#include "lib/s21_smartcalc.h"
 #include "lib/s21_validate.h"
+#include "cli/s21_accrual.h"
+#include "cli/s21_columns.h"
+#include "cli/s21_csv.h"
+#include "cli/s21_queue.h"
 
 START_TEST(test_sum) {
   char *input = "2 + 3 + 0.0 + 5 + 4.3";
@@ -287,6 +309,1099 @@ START_TEST(test_annuity_payment) {
 }
 END_TEST
 
+START_TEST(test_credit_schedule) {
+  double loanAmount = 10000;
+  int loanTerm = 12;
+  double interestRate = 12;
+  double buffer[CREDIT_COLUMNS * 12];
+  loan_schedule schedule;
+  bindSchedule(&schedule, buffer, loanTerm);
+  ck_assert_int_eq(calculateSchedule(loanAmount, loanTerm, interestRate,
+                                     CREDIT_ANNUITY, &schedule),
+                   OK);
+  ck_assert_int_eq(schedule.count, loanTerm);
+  double annuity = calculateAnnuityPayment(loanAmount, loanTerm, interestRate);
+  double principal = 0;
+  for (int i = 0; i < loanTerm; ++i) {
+    ck_assert_double_eq_tol(schedule.payment[i], annuity, 1e-9);
+    ck_assert_double_eq_tol(schedule.principal[i] + schedule.interest[i],
+                            schedule.payment[i], 1e-9);
+    principal += schedule.principal[i];
+  }
+  ck_assert_double_eq_tol(principal, loanAmount, 1e-9);
+  ck_assert_double_eq_tol(schedule.balance[loanTerm - 1], 0, 1e-9);
+  ck_assert_double_eq_tol(schedule.totalPayment, annuity * loanTerm, 1e-7);
+
+  ck_assert_int_eq(calculateSchedule(loanAmount, loanTerm, interestRate,
+                                     CREDIT_DIFFERENTIAL, &schedule),
+                   OK);
+  double *payments =
+      calculateDifferentialPayments(loanAmount, loanTerm, interestRate);
+  for (int i = 0; i < loanTerm; ++i)
+    ck_assert_double_eq_tol(schedule.payment[i], payments[i], 1e-9);
+  free(payments);
+  ck_assert_double_eq_tol(schedule.balance[loanTerm - 1], 0, 1e-9);
+
+  ck_assert_int_eq(calculateSchedule(loanAmount, 0, 0, 0, &schedule), ERROR);
+  ck_assert_int_eq(calculateSchedule(loanAmount, loanTerm + 1, interestRate,
+                                     CREDIT_ANNUITY, &schedule),
+                   ERROR);
+  loan_schedule totals = {0};
+  ck_assert_int_eq(calculateSchedule(loanAmount, 120, 0, CREDIT_ANNUITY,
+                                     &totals),
+                   OK);
+  ck_assert_double_eq_tol(totals.totalPayment, loanAmount, 1e-9);
+  ck_assert_double_eq_tol(totals.totalInterest, 0, 1e-12);
+}
+END_TEST
+
+START_TEST(test_credit_prepayment) {
+  double buffer[CREDIT_COLUMNS * 120];
+  loan_schedule base, prepaid;
+  double other[CREDIT_COLUMNS * 120];
+  bindSchedule(&base, buffer, 120);
+  bindSchedule(&prepaid, other, 120);
+  ck_assert_int_eq(calculateSchedule(100000, 120, 10, CREDIT_ANNUITY, &base),
+                   OK);
+
+  loan_prepayment term[2] = {{12, 20000, CREDIT_REDUCE_TERM},
+                             {12, 5000, CREDIT_REDUCE_TERM}};
+  ck_assert_int_eq(calculatePrepaidSchedule(100000, 120, 10, CREDIT_ANNUITY,
+                                            term, 2, &prepaid),
+                   OK);
+  ck_assert_int_lt(prepaid.count, 120);
+  ck_assert_double_eq_tol(prepaid.payment[11], base.payment[11] + 25000, 1e-6);
+  ck_assert_double_eq_tol(prepaid.payment[12], base.payment[12], 1e-6);
+  ck_assert_double_eq_tol(prepaid.balance[prepaid.count - 1], 0, 1e-9);
+  double principal = 0;
+  for (int i = 0; i < prepaid.count; ++i) principal += prepaid.principal[i];
+  ck_assert_double_eq_tol(principal, 100000, 1e-6);
+  ck_assert(prepaid.totalInterest < base.totalInterest);
+
+  loan_prepayment payment = {12, 25000, CREDIT_REDUCE_PAYMENT};
+  ck_assert_int_eq(calculatePrepaidSchedule(100000, 120, 10, CREDIT_ANNUITY,
+                                            &payment, 1, &prepaid),
+                   OK);
+  ck_assert_int_eq(prepaid.count, 120);
+  double expected = calculateAnnuityPayment(prepaid.balance[11], 108, 10);
+  ck_assert_double_eq_tol(prepaid.payment[12], expected, 1e-6);
+  ck_assert_double_eq_tol(prepaid.balance[119], 0, 1e-6);
+
+  loan_prepayment full = {60, 1e9, CREDIT_REDUCE_TERM};
+  ck_assert_int_eq(calculatePrepaidSchedule(100000, 120, 10,
+                                            CREDIT_DIFFERENTIAL, &full, 1,
+                                            &prepaid),
+                   OK);
+  ck_assert_int_eq(prepaid.count, 60);
+  ck_assert_double_eq_tol(prepaid.principal[59], 100000 - 59 * 100000 / 120.,
+                          1e-6);
+
+  loan_prepayment unsorted[2] = {{24, 1000, CREDIT_REDUCE_TERM},
+                                 {12, 1000, CREDIT_REDUCE_TERM}};
+  ck_assert_int_eq(calculatePrepaidSchedule(100000, 120, 10, CREDIT_ANNUITY,
+                                            unsorted, 2, &prepaid),
+                   ERROR);
+}
+END_TEST
+
+START_TEST(test_portfolio) {
+  int count = 3 * PORTFOLIO_MIN_BLOCK + 7;
+  loan_record *loans = calloc(count, sizeof(loan_record));
+  double amounts = 0;
+  for (int i = 0; i < count; ++i) {
+    loan_record l = {1000 + i, i % 19, 1 + i % 37, i % 2, i % 5, 0};
+    loans[i] = l;
+    amounts += l.amount;
+  }
+  portfolio_totals totals;
+  ck_assert_int_eq(portfolio_run(loans, count, &totals), OK);
+  ck_assert_int_eq(totals.months, 4 + 37);
+
+  double principal[41] = {0}, interest[41] = {0}, balance[41] = {0};
+  double buffer[CREDIT_COLUMNS * 37];
+  loan_schedule s;
+  bindSchedule(&s, buffer, 37);
+  for (int i = 0; i < count; ++i) {
+    ck_assert_int_eq(calculateSchedule(loans[i].amount, loans[i].term,
+                                       loans[i].rate, loans[i].type, &s),
+                     OK);
+    for (int m = 0; m < s.count; ++m) {
+      principal[loans[i].start + m] += s.principal[m];
+      interest[loans[i].start + m] += s.interest[m];
+      balance[loans[i].start + m] += s.balance[m];
+    }
+  }
+  double paid = 0;
+  for (int m = 0; m < totals.months; ++m) {
+    ck_assert_double_eq_tol(totals.principal[m], principal[m], 1e-6);
+    ck_assert_double_eq_tol(totals.interest[m], interest[m], 1e-6);
+    ck_assert_double_eq_tol(totals.balance[m], balance[m], 1e-6);
+    paid += totals.principal[m];
+  }
+  ck_assert_double_eq_tol(paid, amounts, 1e-3);
+  portfolio_free(&totals);
+
+  loans[100].term = 0;
+  ck_assert_int_eq(portfolio_run(loans, count, &totals), ERROR);
+  ck_assert_int_eq(portfolio_run(loans, 0, &totals), OK);
+  ck_assert_int_eq(totals.months, 0);
+  portfolio_free(&totals);
+  free(loans);
+}
+END_TEST
+
+START_TEST(test_credit_curve) {
+  double buffer[CREDIT_COLUMNS * 360], other[CREDIT_COLUMNS * 360];
+  loan_schedule s, base;
+  bindSchedule(&s, buffer, 360);
+  bindSchedule(&base, other, 360);
+
+  rate_segment index[30];
+  for (int i = 0; i < 30; ++i) index[i] = (rate_segment){1 + 12 * i, i % 7};
+  rate_curve floating = {index, 30, 2.5};
+  ck_assert_int_eq(calculateCurveSchedule(3e6, 360, &floating, CREDIT_ANNUITY,
+                                          NULL, 0, &s),
+                   OK);
+  ck_assert_int_eq(s.count, 360);
+  ck_assert_double_eq_tol(s.balance[359], 0, 1e-6);
+  for (int i = 1; i < 30; ++i) {
+    int reset = 12 * i;
+    double expected =
+        calculateAnnuityPayment(s.balance[reset - 1], 360 - reset, i % 7 + 2.5);
+    ck_assert_double_eq_tol(s.payment[reset], expected, 1e-6);
+    ck_assert_double_eq_tol(s.payment[reset + 11], expected, 1e-6);
+  }
+
+  // ступенчатая ставка из одного отрезка совпадает с постоянной
+  rate_segment step = {1, 8};
+  rate_curve fixed = {&step, 1, 0};
+  ck_assert_int_eq(calculateCurveSchedule(3e6, 360, &fixed,
+                                          CREDIT_DIFFERENTIAL, NULL, 0, &s),
+                   OK);
+  ck_assert_int_eq(calculateSchedule(3e6, 360, 8, CREDIT_DIFFERENTIAL, &base),
+                   OK);
+  for (int i = 0; i < 360; ++i)
+    ck_assert_double_eq(s.payment[i], base.payment[i]);
+
+  // смена ставки не растягивает срок, сокращённый досрочным погашением
+  loan_prepayment shorten = {1, 30000, CREDIT_REDUCE_TERM};
+  rate_segment same[2] = {{1, 12}, {4, 12}};
+  rate_curve reset = {same, 2, 0};
+  ck_assert_int_eq(calculatePrepaidSchedule(100000, 12, 12, CREDIT_ANNUITY,
+                                            &shorten, 1, &base),
+                   OK);
+  ck_assert_int_eq(calculateCurveSchedule(100000, 12, &reset, CREDIT_ANNUITY,
+                                          &shorten, 1, &s),
+                   OK);
+  ck_assert_int_eq(base.count, 9);
+  ck_assert_int_eq(s.count, 9);
+  ck_assert_double_eq_tol(s.payment[3], 8884.88, 0.005);
+  for (int i = 0; i < 9; ++i)
+    ck_assert_double_eq_tol(s.payment[i], base.payment[i], 1e-6);
+  same[1].rate = 24;
+  ck_assert_int_eq(calculateCurveSchedule(100000, 12, &reset, CREDIT_ANNUITY,
+                                          &shorten, 1, &s),
+                   OK);
+  ck_assert_int_eq(s.count, 9);
+  ck_assert_double_eq_tol(s.balance[8], 0, 1e-6);
+
+  rate_segment late = {2, 8};
+  rate_curve bad = {&late, 1, 0};
+  ck_assert_int_eq(calculateCurveSchedule(3e6, 360, &bad, CREDIT_ANNUITY, NULL,
+                                          0, &s),
+                   ERROR);
+  ck_assert_int_eq(calculateSchedule(3e6, 360, -1, CREDIT_ANNUITY, &s), ERROR);
+}
+END_TEST
+
+START_TEST(test_effective_rate) {
+  double buffer[CREDIT_COLUMNS * 360];
+  loan_schedule s;
+  bindSchedule(&s, buffer, 360);
+  double rate = 0;
+  for (int type = CREDIT_ANNUITY; type <= CREDIT_DIFFERENTIAL; ++type) {
+    ck_assert_int_eq(calculateSchedule(250000, 360, 7.2, type, &s), OK);
+    ck_assert_int_eq(calculateEffectiveRate(250000, &s, NULL, &rate), OK);
+    ck_assert_double_eq_tol(rate, (pow(1 + 0.006, 12) - 1) * 100, 1e-9);
+  }
+
+  ck_assert_int_eq(calculateSchedule(100000, 12, 12, CREDIT_ANNUITY, &s), OK);
+  loan_fees fees = {1000, 100};
+  ck_assert_int_eq(calculateEffectiveRate(100000, &s, &fees, &rate), OK);
+  ck_assert_double_eq_tol(rate, 17.28941434403053, 1e-9);
+  loan_fees all = {100000, 0};
+  ck_assert_int_eq(calculateEffectiveRate(100000, &s, &all, &rate), ERROR);
+  ck_assert(isnan(rate));
+
+  int count = 2 * PORTFOLIO_MIN_BLOCK + 3;
+  loan_record *loans = calloc(count, sizeof(loan_record));
+  loan_fees *loan_fee = calloc(count, sizeof(loan_fees));
+  double *rates = calloc(count, sizeof(double));
+  for (int i = 0; i < count; ++i) {
+    loans[i] = (loan_record){1e5 + i, i % 23, 1 + i % 240, i % 2, 0, 0};
+    loan_fee[i] = (loan_fees){i % 500, i % 30};
+  }
+  ck_assert_int_eq(portfolio_effective_rates(loans, loan_fee, count, rates),
+                   OK);
+  for (int i = 0; i < count; i += 97) {
+    ck_assert_int_eq(calculateSchedule(loans[i].amount, loans[i].term,
+                                       loans[i].rate, loans[i].type, &s),
+                     OK);
+    ck_assert_int_eq(calculateEffectiveRate(loans[i].amount, &s, &loan_fee[i],
+                                            &rate),
+                     OK);
+    ck_assert_double_eq(rates[i], rate);
+  }
+  loans[5].term = 0;
+  ck_assert_int_eq(portfolio_effective_rates(loans, NULL, count, rates),
+                   ERROR);
+  ck_assert(isnan(rates[5]));
+  ck_assert(!isnan(rates[6]));
+  free(loans);
+  free(loan_fee);
+  free(rates);
+}
+END_TEST
+
+START_TEST(test_deposit) {
+  deposit_event plus[3] = {{0, 5000}, {45, 20000}, {400, 1000}};
+  deposit_event minus[2] = {{45, 3000}, {200, 1e9}};
+  int periods[4] = {DEPOSIT_DAILY, DEPOSIT_MONTHLY, DEPOSIT_QUARTERLY,
+                    DEPOSIT_AT_END};
+  for (int cap = 0; cap <= 1; ++cap)
+    for (int k = 0; k < 4; ++k) {
+      deposit_params p = {100000, 731, 8.5, 13, 1000, periods[k], cap,
+                          plus, 3, minus, 2};
+      deposit_result res;
+      ck_assert_int_eq(calculateDeposit(&p, &res), OK);
+
+      // посуточный расчёт для сверки
+      int period = periods[k] ? periods[k] : p.term;
+      double balance = p.amount, accrued = 0, interest = 0, paid = 0;
+      double rate = p.interestRate / 100 / DEPOSIT_YEAR_DAYS;
+      int r = 0, w = 0;
+      for (int day = 0; day <= p.term; ++day) {
+        if (day > 0) accrued += balance * rate;
+        if ((day > 0 && day % period == 0) || day == p.term) {
+          interest += accrued;
+          if (cap)
+            balance += accrued;
+          else
+            paid += accrued;
+          accrued = 0;
+        }
+        for (; r < 3 && plus[r].day == day; ++r) balance += plus[r].amount;
+        for (; w < 2 && minus[w].day == day; ++w)
+          balance = fmax(balance - minus[w].amount, 0);
+      }
+      ck_assert_double_eq_tol(res.interest, interest, 1e-6);
+      ck_assert_double_eq_tol(res.paidOut, paid, 1e-6);
+      ck_assert_double_eq_tol(res.balance, balance, 1e-6);
+      ck_assert_double_eq_tol(res.tax, (interest - 1000) * 0.13, 1e-6);
+    }
+
+  deposit_event unsorted[2] = {{200, 1}, {45, 1}};
+  deposit_params bad = {100000, 365, 8.5, 13, 0, DEPOSIT_MONTHLY, 1,
+                        unsorted, 2, NULL, 0};
+  deposit_result res;
+  ck_assert_int_eq(calculateDeposit(&bad, &res), ERROR);
+}
+END_TEST
+
+START_TEST(test_deposit_accrual) {
+  deposit_account accounts[4] = {{5336290, 12.69, 13, 3, 0},
+                                 {687788, 6.25, 13, 1, 1},
+                                 {100000, 10, 0, 2, 1},
+                                 {100000, 10, 13, 0, 0}};
+  deposit_accrual accruals[4];
+  ck_assert_int_eq(accrueDeposits(accounts, 4, accruals), ERROR);
+  ck_assert_int_eq(accruals[0].interest, 556582);
+  ck_assert_int_eq(accruals[0].tax, 72356);
+  ck_assert_int_eq(accruals[1].interest, 11777);
+  // ежедневная капитализация: проценты второго дня начисляются и на первые
+  double rate = 0.1 / DEPOSIT_YEAR_DAYS;
+  ck_assert_int_eq(accruals[2].interest,
+                   llround(100000 * ((1 + rate) * (1 + rate) - 1) * 100));
+  ck_assert_int_eq(accruals[2].tax, 0);
+  ck_assert_int_eq(accruals[3].interest, DEPOSIT_INVALID);
+  ck_assert_int_eq(accruals[3].tax, DEPOSIT_INVALID);
+  ck_assert_int_eq(accrueDeposits(accounts, 3, accruals), OK);
+}
+END_TEST
+
+START_TEST(test_credit_minor) {
+  double buffer[CREDIT_COLUMNS * 360];
+  long long minor[CREDIT_COLUMNS * 360];
+  loan_schedule s;
+  loan_schedule_minor m;
+  bindSchedule(&s, buffer, 360);
+  bindScheduleMinor(&m, minor, 360);
+  for (int type = CREDIT_ANNUITY; type <= CREDIT_DIFFERENTIAL; ++type)
+    for (int rounding = CREDIT_ROUND_HALF_UP; rounding <= CREDIT_ROUND_DOWN;
+         ++rounding) {
+      ck_assert_int_eq(calculateSchedule(1234567.89, 360, 9.35, type, &s), OK);
+      ck_assert_int_eq(calculateScheduleMinor(123456789, 360, 9.35, type,
+                                              rounding, &m),
+                       OK);
+      ck_assert_int_eq(m.count, 360);
+      long long principal = 0;
+      for (int i = 0; i < m.count; ++i) {
+        ck_assert_int_eq(m.payment[i], m.principal[i] + m.interest[i]);
+        // до последнего платежа копейки расходятся с double не больше чем
+        // на округление месяца, последний поглощает накопленную разницу
+        ck_assert_double_eq_tol(m.payment[i] / 100.0, s.payment[i],
+                                i < m.count - 1 ? 0.02 : 10.0);
+        principal += m.principal[i];
+      }
+      ck_assert_int_eq(principal, 123456789);
+      ck_assert_int_eq(m.balance[359], 0);
+      ck_assert_double_eq_tol(m.totalPayment / 100.0, s.totalPayment, 10.0);
+    }
+
+  // 100000.00 под 12% на 12 месяцев: платёж 8884.88, последний 8884.85
+  ck_assert_int_eq(calculateScheduleMinor(10000000, 12, 12, CREDIT_ANNUITY,
+                                          CREDIT_ROUND_HALF_UP, &m),
+                   OK);
+  ck_assert_int_eq(m.payment[0], 888488);
+  ck_assert_int_eq(m.interest[0], 100000);
+  ck_assert_int_eq(m.payment[11], 888485);
+
+  ck_assert_int_eq(calculateScheduleMinor(100, 12, 12, CREDIT_ANNUITY, 7, &m),
+                   ERROR);
+
+  // суммы, при которых итог графика не помещается в long long
+  ck_assert_int_eq(calculateScheduleMinor(LLONG_MAX / 4, 12, 12, CREDIT_ANNUITY,
+                                          CREDIT_ROUND_HALF_UP, &m),
+                   ERROR);
+  ck_assert_int_eq(calculateScheduleMinor(100000000000000LL, 360, 1e6,
+                                          CREDIT_DIFFERENTIAL,
+                                          CREDIT_ROUND_HALF_UP, &m),
+                   ERROR);
+  ck_assert_int_eq(calculateScheduleMinor(1000000000000000LL, 360, 20,
+                                          CREDIT_ANNUITY, CREDIT_ROUND_UP, &m),
+                   OK);
+  long long repaid = 0;
+  for (int i = 0; i < m.count; ++i) repaid += m.principal[i];
+  ck_assert_int_eq(repaid, 1000000000000000LL);
+  ck_assert_int_eq(m.totalPayment - m.totalInterest, repaid);
+}
+END_TEST
+
+START_TEST(test_credit_sweep) {
+  double rates[3] = {0, 7.5, 24};
+  int terms[2] = {1, 360};
+  double amounts[4] = {0, 1000, 250000, 1e7};
+  double payment[24], total[24], overpay[24];
+  loan_sweep sweep = {payment, total, overpay};
+  ck_assert_int_eq(calculateSweep(rates, 3, terms, 2, amounts, 4, &sweep), OK);
+  for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 2; ++j)
+      for (int k = 0; k < 4; ++k) {
+        int at = (i * 2 + j) * 4 + k;
+        double expected = rates[i] > 0 ? calculateAnnuityPayment(
+                                             amounts[k], terms[j], rates[i])
+                                       : amounts[k] / terms[j];
+        ck_assert_double_eq_tol(payment[at], expected, 1e-9 * (1 + expected));
+        ck_assert_double_eq_tol(total[at], expected * terms[j],
+                                1e-9 * (1 + total[at]));
+        ck_assert_double_eq_tol(overpay[at], total[at] - amounts[k],
+                                1e-9 * (1 + total[at]));
+      }
+  loan_sweep only = {NULL, total, NULL};
+  ck_assert_int_eq(calculateSweep(rates, 3, terms, 2, amounts, 4, &only), OK);
+  terms[0] = 0;
+  ck_assert_int_eq(calculateSweep(rates, 3, terms, 2, amounts, 4, &sweep),
+                   ERROR);
+  terms[0] = 12;
+  payment[0] = -1;
+  rates[1] = NAN;
+  ck_assert_int_eq(calculateSweep(rates, 3, terms, 2, amounts, 4, &sweep),
+                   ERROR);
+  rates[1] = -1200;
+  ck_assert_int_eq(calculateSweep(rates, 3, terms, 2, amounts, 4, &sweep),
+                   ERROR);
+  rates[1] = INFINITY;
+  ck_assert_int_eq(calculateSweep(rates, 3, terms, 2, amounts, 4, &sweep),
+                   ERROR);
+  ck_assert_double_eq(payment[0], -1);
+}
+END_TEST
+
+START_TEST(test_program) {
+  char *input = "1/2+(2+3)/(sin(x-2)^2-6/7.4)*x mod 3 - (-x)";
+  program prog = {0};
+  ck_assert_int_eq(compile_program(input, &prog), OK);
+  double xs[300], ys[300];
+  for (int i = 0; i < 300; i++) xs[i] = -5 + i * 0.037;
+  ck_assert_int_eq(calc_program_batch(&prog, xs, ys, 300), OK);
+  for (int i = 0; i < 300; i += 7) {
+    double result = 0;
+    calc_program(&prog, xs[i], &result);
+    ck_assert_double_eq_tol(result, ys[i], 1e-12);
+    double x = xs[i];
+    ck_assert_double_eq_tol(
+        result, 1.0 / 2 + fmod(5 / (pow(sin(x - 2), 2) - 6 / 7.4) * x, 3) + x,
+        1e-9);
+  }
+  remove_program(&prog);
+  ck_assert_int_eq(compile_program("sin(*8)", &prog), ERROR);
+  ck_assert_int_eq(compile_program("", &prog), ERROR);
+}
+END_TEST
+
+START_TEST(test_dual) {
+  program prog = {0};
+  dual d = {0};
+  ck_assert_int_eq(compile_program("x^3 + sin(x) * x - 2 ^ x", &prog), OK);
+  double x = 1.3;
+  calc_program_dual(&prog, x, 2, &d);
+  ck_assert_double_eq_tol(d.v, pow(x, 3) + sin(x) * x - pow(2, x), 1e-12);
+  ck_assert_double_eq_tol(
+      d.d1, 3 * x * x + cos(x) * x + sin(x) - pow(2, x) * log(2), 1e-12);
+  ck_assert_double_eq_tol(d.d2,
+                          6 * x - sin(x) * x + 2 * cos(x) -
+                              pow(2, x) * log(2) * log(2),
+                          1e-12);
+  remove_program(&prog);
+
+  ck_assert_int_eq(compile_program("ln(x) / sqrt(x) + atan(x)", &prog), OK);
+  double xs[3] = {0.5, 1, 4};
+  dual ds[3];
+  calc_program_dual_batch(&prog, xs, 1, ds, 3);
+  for (int i = 0; i < 3; i++) {
+    x = xs[i];
+    ck_assert_double_eq_tol(
+        ds[i].d1, (2 - log(x)) / (2 * pow(x, 1.5)) + 1 / (1 + x * x), 1e-12);
+  }
+  remove_program(&prog);
+
+  // x^1 и x^0 в нуле: pow(0, -1) бесконечна, но производные конечны
+  ck_assert_int_eq(compile_program("x^1 + x^0", &prog), OK);
+  calc_program_dual(&prog, 0, 2, &d);
+  ck_assert_double_eq(d.v, 1);
+  ck_assert_double_eq(d.d1, 1);
+  ck_assert_double_eq(d.d2, 0);
+  remove_program(&prog);
+}
+END_TEST
+
+START_TEST(test_roots) {
+  program prog = {0};
+  root r[32];
+  compile_program("sin(x)", &prog);
+  int n = find_roots(&prog, -10, 10, 0, 4, r, 32);
+  ck_assert_int_eq(n, 13);
+  int zeros = 0;
+  for (int i = 0; i < n; i++) {
+    double k = r[i].x / (M_PI / 2);
+    ck_assert_double_eq_tol(k, round(k), 1e-12);
+    if (r[i].kind == R_ZERO) zeros++;
+    if (r[i].kind == R_MAX) ck_assert_double_eq_tol(r[i].y, 1, 1e-12);
+    if (r[i].kind == R_MIN) ck_assert_double_eq_tol(r[i].y, -1, 1e-12);
+    if (i > 0) ck_assert(r[i].x > r[i - 1].x);
+  }
+  ck_assert_int_eq(zeros, 7);
+  remove_program(&prog);
+
+  // минимум и нуль в одной ячейке сетки
+  compile_program("x^2 - 0.01", &prog);
+  ck_assert_int_eq(find_roots(&prog, -0.05, 1, 1, 1, r, 32), 2);
+  ck_assert_int_eq(r[0].kind, R_MIN);
+  ck_assert_double_eq_tol(r[0].x, 0, 1e-12);
+  ck_assert_int_eq(r[1].kind, R_ZERO);
+  ck_assert_double_eq_tol(r[1].x, 0.1, 1e-12);
+  ck_assert_int_eq(find_roots(&prog, -0.05, 1, 1, 1, r, 1), 1);
+  ck_assert_int_eq(r[0].kind, R_MIN);
+  remove_program(&prog);
+
+  compile_program("tan(x) + x^2 - 2", &prog);
+  n = find_roots(&prog, -0.3, 2, 100, 2, r, 32);
+  for (int i = 0; i < n; i++) {
+    double x = r[i].x;
+    if (r[i].kind == R_ZERO) ck_assert_double_eq_tol(tan(x) + x * x, 2, 1e-9);
+  }
+  ck_assert_int_eq(find_roots(&prog, 1, 0, 0, 1, r, 32), ERROR);
+  ck_assert_int_eq(find_roots(&prog, 0, 1, 0, -1, r, 32), ERROR);
+  remove_program(&prog);
+}
+END_TEST
+
+START_TEST(test_integral) {
+  program prog = {0};
+  double result = 0, err = 0;
+  compile_program("sin(x)", &prog);
+  ck_assert_int_eq(integrate_program(&prog, 0, M_PI, 0, &result, &err), OK);
+  ck_assert_double_eq_tol(result, 2, 1e-12);
+  ck_assert(err < 1e-9);
+  remove_program(&prog);
+
+  compile_program("1 / (1 + 25 * x ^ 2)", &prog);
+  ck_assert_int_eq(integrate_program(&prog, -1, 1, 1e-12, &result, NULL), OK);
+  ck_assert_double_eq_tol(result, 0.4 * atan(5), 1e-11);
+  ck_assert_int_eq(integrate_program(&prog, 1, -1, 1e-12, &result, NULL), OK);
+  ck_assert_double_eq_tol(result, -0.4 * atan(5), 1e-11);
+  remove_program(&prog);
+
+  compile_program("1 / x", &prog);
+  ck_assert_int_eq(integrate_program(&prog, -1, 1, 0, &result, &err), ERROR);
+  remove_program(&prog);
+}
+END_TEST
+
+START_TEST(test_cumulative_integral) {
+  int n = 2001;
+  double h = M_PI / (n - 1);
+  double *y = malloc(sizeof(double) * n);
+  double *F = malloc(sizeof(double) * n);
+  for (int i = 0; i < n; i++) y[i] = sin(i * h);
+  ck_assert_int_eq(cumulative_integral(y, n, h, F), OK);
+  for (int i = 0; i < n; i += 50)
+    ck_assert_double_eq_tol(F[i], 1 - cos(i * h), 1e-11);
+
+  y[1000] = NAN;
+  cumulative_integral(y, n, h, F);
+  ck_assert(isnan(F[1000]));
+  ck_assert_double_eq_tol(F[999], 1 - cos(999 * h), 1e-11);
+  ck_assert_double_eq_tol(F[n - 1] - F[1001], cos(1001 * h) + 1, 1e-11);
+  ck_assert_int_eq(cumulative_integral(y, 0, h, F), ERROR);
+  free(y);
+  free(F);
+}
+END_TEST
+
+START_TEST(test_ddouble) {
+  program prog = {0};
+  double result = 0;
+  compile_program("(1 + x) ^ 3 - 1", &prog);
+  double x = 1e-12;
+  calc_program(&prog, x, &result);
+  ck_assert(fabs(result / (3 * x) - 1) > 1e-6);
+  prog.precision = P_DDOUBLE;
+  calc_program(&prog, x, &result);
+  ck_assert_double_eq_tol(result / (3 * x + 3 * x * x) - 1, 0, 1e-15);
+  remove_program(&prog);
+
+  ddouble r = {0};
+  ddouble vars[1] = {{0, 0}};
+  compile_program("0.1 * 3 - 0.3", &prog);
+  calc_program_dd(&prog, vars, &r);
+  ck_assert(fabs(r.hi) < 1e-30);
+  remove_program(&prog);
+
+  char *identities[] = {"sin(x) ^ 2 + cos(x) ^ 2 - 1",
+                        "ln(x ^ 2.5) / ln(x) - 2.5",
+                        "(x ^ 0.5) ^ 2 / x - 1",
+                        "tan(atan(x)) / x - 1",
+                        "sin(asin(x / 8)) * 8 / x - 1",
+                        "cos(acos(x / 8)) * 8 / x - 1",
+                        "log(x) / ln(x) * ln(10) - 1",
+                        "(x mod 0.7) + 0.7 * 4 - x",
+                        "\0"};
+  for (int i = 0; strcmp(identities[i], "\0"); i++) {
+    ck_assert_int_eq(compile_program(identities[i], &prog), OK);
+    vars[0] = dd_from(3.3);
+    calc_program_dd(&prog, vars, &r);
+    ck_assert(fabs(r.hi) < 1e-29);
+    remove_program(&prog);
+  }
+  ck_assert_double_eq_tol(dd_exp(dd_from(1)).hi, M_E, 1e-15);
+  ck_assert_double_eq_tol(dd_sin(dd_from(100)).hi, sin(100), 1e-15);
+}
+END_TEST
+
+START_TEST(test_program_vars) {
+  program prog = {0};
+  double result = 0;
+  ck_assert_int_eq(compile_program("a * x + b", &prog), ERROR);
+  ck_assert_int_eq(compile_program_vars("a * x + b ^ 2 - a", &prog), OK);
+  ck_assert_int_eq(prog.nvars, 3);
+  int a = program_var_slot(&prog, 'a');
+  int b = program_var_slot(&prog, 'b');
+  ck_assert_int_eq(program_var_slot(&prog, 'x'), 0);
+  ck_assert_int_eq(program_var_slot(&prog, 'c'), ERROR);
+
+  double vars[S21_MAX_VARS] = {2};
+  vars[a] = 3;
+  vars[b] = 4;
+  ck_assert_int_eq(calc_program_vars(&prog, vars, &result), OK);
+  ck_assert_double_eq_tol(result, 19, 1e-12);
+
+  double xs[300], as[300], ys[300];
+  const double *cols[S21_MAX_VARS] = {xs};
+  cols[a] = as;
+  for (int i = 0; i < 300; i++) {
+    xs[i] = i;
+    as[i] = 0.5 * i;
+  }
+  calc_program_batch_vars(&prog, cols, ys, 300);
+  for (int i = 0; i < 300; i++)
+    ck_assert_double_eq_tol(ys[i], 0.5 * i * i - 0.5 * i, 1e-9);
+  remove_program(&prog);
+  ck_assert_int_eq(compile_program_vars("ab", &prog), ERROR);
+}
+END_TEST
+
+START_TEST(test_smartcalc_api) {
+  sc_program *handle = NULL;
+  double result = 0;
+  ck_assert_int_eq(sc_api_version(), SC_API_VERSION);
+  ck_assert_int_eq(sc_compile("1 +", &handle), SC_ERROR);
+  ck_assert_ptr_null(handle);
+  ck_assert_int_eq(sc_compile("k * x ^ 2", &handle), SC_OK);
+  ck_assert_int_eq(sc_var_count(handle), 2);
+  double vars[SC_MAX_VARS] = {3};
+  vars[sc_var_slot(handle, 'k')] = 0.5;
+  ck_assert_int_eq(sc_eval_vars(handle, vars, &result), SC_OK);
+  ck_assert_double_eq_tol(result, 4.5, 1e-12);
+  ck_assert_int_eq(sc_eval(handle, 3, &result), SC_OK);
+  ck_assert_double_eq_tol(result, 0, 1e-12);
+  ck_assert_int_eq(sc_set_precision(handle, 7), SC_ERROR);
+  ck_assert_int_eq(sc_set_precision(handle, SC_PRECISION_DDOUBLE), SC_OK);
+  double x[3] = {1, 2, 3}, y[3] = {0};
+  ck_assert_int_eq(sc_eval_batch(handle, x, y, 3), SC_OK);
+  ck_assert_double_eq_tol(y[2], 0, 1e-12);
+  sc_free(handle);
+  sc_free(NULL);
+}
+END_TEST
+
+START_TEST(test_library) {
+  const char *names[] = {"square", "line", "exact"};
+  const char *exprs[] = {"x ^ 2", "k * x + 0.1", "0.1 * 3 - 0.3"};
+  program progs[3];
+  for (int i = 0; i < 3; i++)
+    ck_assert_int_eq(compile_program_vars(exprs[i], &progs[i]), OK);
+  progs[2].precision = P_DDOUBLE;
+  ck_assert_int_eq(save_library("test_library.bin", progs, names, 3), OK);
+
+  program_library lib = {0};
+  double result = 0;
+  ck_assert_int_eq(open_library("test_library.bin", &lib), OK);
+  ck_assert_int_eq(lib.count, 3);
+  ck_assert_int_eq(library_find(&lib, "missing"), ERROR);
+  const program *line = &lib.progs[library_find(&lib, "line")];
+  double vars[S21_MAX_VARS] = {2};
+  vars[program_var_slot(line, 'k')] = 3;
+  calc_program_vars(line, vars, &result);
+  ck_assert_double_eq_tol(result, 6.1, 1e-12);
+  calc_program(&lib.progs[library_find(&lib, "square")], 3, &result);
+  ck_assert_double_eq_tol(result, 9, 1e-12);
+  calc_program(&lib.progs[library_find(&lib, "exact")], 0, &result);
+  ck_assert(fabs(result) < 1e-30);
+  close_library(&lib);
+
+  sc_library *shared = NULL;
+  ck_assert_int_eq(sc_library_open("test_library.bin", &shared), SC_OK);
+  ck_assert_int_eq(sc_library_count(shared), 3);
+  ck_assert_str_eq(sc_library_name(shared, 0), "exact");
+  ck_assert_int_eq(sc_eval(sc_library_get(shared, "square"), 4, &result),
+                   SC_OK);
+  ck_assert_double_eq_tol(result, 16, 1e-12);
+  ck_assert_ptr_null(sc_library_get(shared, "cube"));
+  sc_library_close(shared);
+
+  // обрезанный файл не открывается
+  truncate("test_library.bin", 100);
+  ck_assert_int_eq(open_library("test_library.bin", &lib), ERROR);
+  remove("test_library.bin");
+  ck_assert_int_eq(open_library("test_library.bin", &lib), ERROR);
+  names[1] = "square";
+  ck_assert_int_eq(save_library("test_library.bin", progs, names, 3), ERROR);
+  for (int i = 0; i < 3; i++) remove_program(&progs[i]);
+}
+END_TEST
+
+START_TEST(test_preview) {
+  static preview pv;
+  preview_init(&pv, TRUE);
+  // посимвольный ввод, правка в середине и удаление
+  const char *steps[] = {"s",         "si",         "sin",       "sin(",
+                         "sin(x",     "sin(x)",     "sin(x)-",   "sin(x)-2",
+                         "sin(-x)-2", "sin(-x)*-2", "sin(-x)*k", "sin(x)*k",
+                         "in(x)*k",   "cos(x)*k",   "cos(x)*k)"};
+  double vars[S21_MAX_VARS] = {0.5};
+  for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+    program expected;
+    int code = compile_program_vars(steps[i], &expected);
+    ck_assert_int_eq(preview_update(&pv, steps[i]), code);
+    if (code != OK) continue;
+    double want = 0, got = 0;
+    int k = program_var_slot(&expected, 'k');
+    if (k != ERROR) vars[k] = 3;
+    calc_program_vars(&expected, vars, &want);
+    k = program_var_slot(&pv.prog, 'k');
+    if (k != ERROR) vars[k] = 3;
+    calc_program_vars(&pv.prog, vars, &got);
+    ck_assert_double_eq_tol(got, want, 1e-12);
+    remove_program(&expected);
+  }
+
+  // правка одного символа в длинном выражении разбирает только соседние
+  // лексемы
+  char line[PREVIEW_MAX] = "1";
+  for (int i = 0; i < 60; i++) strcat(line, "+x*2");
+  ck_assert_int_eq(preview_update(&pv, line), OK);
+  line[121] = '-';
+  ck_assert_int_eq(preview_update(&pv, line), OK);
+  ck_assert_int_le(pv.relexed, 4);
+  double result = 0;
+  calc_program(&pv.prog, 1, &result);
+  ck_assert_double_eq_tol(result, 117, 1e-12);
+  preview_free(&pv);
+}
+END_TEST
+
+/*!
+ * \brief Отмечает обработанные элементы; каждый сотый элемент намного
+ * дороже остальных.
+ */
+static void mark_range(void *arg, int from, int to) {
+  int *hits = arg;
+  for (int i = from; i < to; i++) {
+    volatile double sink = 0;
+    for (int k = 0; i % 100 == 0 && k < 100000; k++) sink += k;
+    hits[i]++;
+  }
+}
+
+START_TEST(test_pool) {
+  enum { N = 20000 };
+  static int hits[N];
+  work_pool *pool = NULL;
+  ck_assert_int_eq(pool_create(4, TRUE, &pool), OK);
+  ck_assert_int_eq(pool_threads(pool), 4);
+  for (int round = 1; round <= 3; round++) {
+    pool_run(pool, N, mark_range, hits);
+    for (int i = 0; i < N; i++) ck_assert_int_eq(hits[i], round);
+  }
+  pool_destroy(pool);
+  pool_run(NULL, 10, mark_range, hits);
+  ck_assert_int_eq(hits[9], 4);
+
+  sc_program *progs[3] = {NULL};
+  ck_assert_int_eq(sc_compile("x ^ 2", &progs[0]), SC_OK);
+  ck_assert_int_eq(sc_compile("sin(x) + 1", &progs[1]), SC_OK);
+  double x[3] = {3, 0, 1}, y[3] = {0};
+  ck_assert_int_eq(sc_eval_many((const sc_program *const *)progs, x, y, 3),
+                   SC_OK);
+  ck_assert_double_eq_tol(y[0], 9, 1e-12);
+  ck_assert_double_eq_tol(y[1], 1, 1e-12);
+  ck_assert(isnan(y[2]));
+  sc_free(progs[0]);
+  sc_free(progs[1]);
+}
+END_TEST
+
+START_TEST(test_aggregate) {
+  program prog = {0};
+  double r = 0, again = 0;
+  ck_assert_int_eq(compile_program("sum(k, 1, 1000000, 1/k^2)", &prog), OK);
+  ck_assert_int_eq(calc_program(&prog, 0, &r), OK);
+  ck_assert_double_eq_tol(r, M_PI * M_PI / 6 - 1e-6, 1e-12);
+  calc_program(&prog, 0, &again);
+  ck_assert(r == again);
+  remove_program(&prog);
+
+  ck_assert_int_eq(compile_program("prod(k, 1, 10, k) + x", &prog), OK);
+  ck_assert_int_eq(calc_program(&prog, 1, &r), OK);
+  ck_assert_double_eq(r, 3628801);
+  remove_program(&prog);
+
+  ck_assert_int_eq(compile_program("sum(k, 1, x, max(j, 1, k, j*x))", &prog),
+                   OK);
+  double x[2] = {3, 4}, y[2] = {0};
+  calc_program_batch(&prog, x, y, 2);
+  ck_assert_double_eq_tol(y[0], 18, 1e-12);
+  ck_assert_double_eq_tol(y[1], 40, 1e-12);
+  dual d = {0};
+  ck_assert_int_eq(calc_program_dual(&prog, 3, 1, &d), OK);
+  ck_assert_double_eq_tol(d.d1, 6, 1e-12);
+  remove_program(&prog);
+
+  ck_assert_int_eq(compile_program("min(k, 1, 0, k)", &prog), OK);
+  ck_assert_int_eq(calc_program(&prog, 0, &r), ERROR);
+  remove_program(&prog);
+  ck_assert_int_eq(compile_program("sum(k, 1, 10)", &prog), ERROR);
+  ck_assert_int_eq(compile_program("sum(2, 1, 10, k)", &prog), ERROR);
+  ck_assert_int_eq(compile_program("sum(k, 1, 10, k) + a", &prog), ERROR);
+}
+END_TEST
+
+START_TEST(test_budget) {
+  eval_limits lim = {20, 3, 0, 0, NULL};
+  budget *b = NULL;
+  program prog = {0};
+  ck_assert_int_eq(budget_create(&lim, &b), OK);
+  ck_assert_ptr_null(budget_enter(b));
+  ck_assert_int_eq(compile_program("((((1))))", &prog), LIMITED);
+  budget_enter(NULL);
+  budget_destroy(b);
+  budget_create(&lim, &b);
+  budget_enter(b);
+  ck_assert_int_eq(compile_program("1+1+1+1+1+1+1+1+1+1+1", &prog), LIMITED);
+  budget_enter(NULL);
+  budget_destroy(b);
+
+  ck_assert_int_eq(compile_program("sum(k, 1, 1000000, k*x)", &prog), OK);
+  eval_limits ops = {0, 0, 100000, 0, NULL};
+  budget_create(&ops, &b);
+  budget_enter(b);
+  double r = 0;
+  ck_assert_int_eq(calc_program(&prog, 1, &r), LIMITED);
+  ck_assert(isnan(r));
+  ck_assert_int_eq(budget_status(b), LIMITED);
+  ck_assert(budget_used(b) > 100000);
+  budget_enter(NULL);
+  budget_destroy(b);
+  ck_assert_int_eq(calc_program(&prog, 1, &r), OK);
+  ck_assert_double_eq(r, 500000500000.0);
+
+  int cancel = 1;
+  sc_limits limits = {0, 0, 0, 0, &cancel};
+  sc_program *handle = NULL;
+  ck_assert_int_eq(sc_compile("sum(k, 1, 100000000, k*x)", &handle), SC_OK);
+  double vars[1] = {1}, y[300] = {0};
+  ck_assert_int_eq(sc_eval_limited(handle, vars, &limits, &r), SC_LIMIT);
+  cancel = 0;
+  limits.timeout_ms = 20;
+  const double *cols[1] = {NULL};
+  ck_assert_int_eq(sc_eval_batch_limited(handle, cols, y, 300, &limits),
+                   SC_LIMIT);
+  ck_assert(isnan(y[299]));
+  sc_free(handle);
+  remove_program(&prog);
+}
+END_TEST
+
+static void write_file(const char *path, const void *data, size_t size) {
+  FILE *f = fopen(path, "wb");
+  ck_assert(f != NULL);
+  ck_assert_int_eq(fwrite(data, 1, size, f), size);
+  fclose(f);
+}
+
+static void *read_file(const char *path, size_t *size) {
+  FILE *f = fopen(path, "rb");
+  ck_assert(f != NULL);
+  fseek(f, 0, SEEK_END);
+  *size = (size_t)ftell(f);
+  rewind(f);
+  void *data = malloc(*size ? *size : 1);
+  ck_assert_int_eq(fread(data, 1, *size, f), *size);
+  fclose(f);
+  return data;
+}
+
+START_TEST(test_columns) {
+  size_t n = 2 * COLUMNS_CHUNK + 7;
+  double *x = malloc(sizeof(double) * n), *y = malloc(sizeof(double) * n);
+  for (size_t i = 0; i < n; i++) {
+    x[i] = (double)i;
+    y[i] = 0.5;
+  }
+  write_file("test_columns_x.bin", x, sizeof(double) * n);
+  write_file("test_columns_y.bin", y, sizeof(double) * n);
+  column_bind binds[] = {{'x', "test_columns_x.bin"},
+                         {'y', "test_columns_y.bin"}};
+  ck_assert_int_eq(eval_columns("2 * x + y", binds, 2, "test_columns_out.bin",
+                                4, FALSE, P_DOUBLE),
+                   OK);
+  FILE *f = fopen("test_columns_out.bin", "rb");
+  ck_assert(f != NULL);
+  ck_assert_int_eq(fread(x, sizeof(double), n, f), n);
+  ck_assert_int_eq(fread(y, sizeof(double), 1, f), 0);
+  fclose(f);
+  int wrong = 0;
+  for (size_t i = 0; i < n; i++) wrong += x[i] != 2.0 * (double)i + 0.5;
+  ck_assert_int_eq(wrong, 0);
+
+  // столбцы разной длины и непривязанная переменная
+  write_file("test_columns_y.bin", y, sizeof(double) * (n - 1));
+  ck_assert_int_eq(eval_columns("x + y", binds, 2, "test_columns_out.bin", 2,
+                                FALSE, P_DOUBLE),
+                   ERROR);
+  ck_assert_int_eq(eval_columns("x + z", binds, 1, "test_columns_out.bin", 2,
+                                FALSE, P_DOUBLE),
+                   ERROR);
+  remove("test_columns_x.bin");
+  remove("test_columns_y.bin");
+  remove("test_columns_out.bin");
+  free(x);
+  free(y);
+}
+END_TEST
+
+#define ACCRUAL_TEST_COUNT (2 * ACCRUAL_CHUNK + 100)
+
+// начисление по test_accrual.bin после контрольной точки с отметкой mark у
+// первой порции; в выходном файле размера size от out остаётся только первая
+// порция
+static void resume_accruals(const void *out, size_t size, int64_t mtime_ns,
+                            unsigned char mark, int status,
+                            const void *expect) {
+  size_t nchunks = (ACCRUAL_TEST_COUNT + ACCRUAL_CHUNK - 1) / ACCRUAL_CHUNK;
+  size_t ckpt_size = sizeof(accrual_checkpoint) + nchunks;
+  accrual_checkpoint *ckpt = calloc(1, ckpt_size);
+  strcpy(ckpt->magic, ACCRUAL_MAGIC);
+  ckpt->count = ACCRUAL_TEST_COUNT;
+  ckpt->chunk = ACCRUAL_CHUNK;
+  ckpt->input_size = ACCRUAL_TEST_COUNT * sizeof(deposit_account);
+  ckpt->input_mtime_ns = mtime_ns;
+  ckpt->done[0] = mark;
+  write_file("test_accrual_out.bin.ckpt", ckpt, ckpt_size);
+  char *partial = calloc(1, size);
+  size_t first = ACCRUAL_CHUNK * sizeof(deposit_accrual);
+  memcpy(partial, out, size < first ? size : first);
+  write_file("test_accrual_out.bin", partial, size);
+  ck_assert_int_eq(
+      eval_accruals("test_accrual.bin", "test_accrual_out.bin", 2, FALSE),
+      status);
+  size_t result_size = 0;
+  char *result = read_file("test_accrual_out.bin", &result_size);
+  ck_assert_int_eq(result_size, ACCRUAL_TEST_COUNT * sizeof(deposit_accrual));
+  ck_assert(memcmp(result, expect, result_size) == 0);
+  ck_assert_int_eq(access("test_accrual_out.bin.ckpt", F_OK), -1);
+  free(result);
+  free(partial);
+  free(ckpt);
+}
+
+START_TEST(test_accrual) {
+  size_t n = ACCRUAL_TEST_COUNT, size = 0;
+  deposit_account *accounts = malloc(sizeof(deposit_account) * n);
+  for (size_t i = 0; i < n; i++)
+    accounts[i] = (deposit_account){100000 + i, 5 + i % 10, 13, 1 + i % 3,
+                                    (int)(i & 1)};
+  write_file("test_accrual.bin", accounts, sizeof(deposit_account) * n);
+  ck_assert_int_eq(
+      eval_accruals("test_accrual.bin", "test_accrual_out.bin", 3, FALSE), OK);
+  ck_assert_int_eq(access("test_accrual_out.bin.ckpt", F_OK), -1);
+  deposit_accrual *full = read_file("test_accrual_out.bin", &size);
+  ck_assert_int_eq(size, sizeof(deposit_accrual) * n);
+  struct stat st;
+  stat("test_accrual.bin", &st);
+  int64_t mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+
+  // продолжение с первой выполненной порции даёт те же итоги
+  resume_accruals(full, size, mtime, ACCRUAL_DONE, OK, full);
+  // отметка пропускает порцию: испорченный итог в ней остаётся
+  deposit_accrual *marked = malloc(size);
+  memcpy(marked, full, size);
+  marked[0].interest = 7;
+  resume_accruals(marked, size, mtime, ACCRUAL_DONE, OK, marked);
+  // контрольная точка другого файла счетов не используется
+  resume_accruals(marked, size, mtime + 1, ACCRUAL_DONE, OK, full);
+  // выходной файл другого размера: начисление начинается заново
+  resume_accruals(marked, size / 2, mtime, ACCRUAL_DONE, OK, full);
+
+  // неверный счёт в выполненной порции по-прежнему даёт ошибку
+  accounts[5].days = 0;
+  write_file("test_accrual.bin", accounts, sizeof(deposit_account) * n);
+  ck_assert_int_eq(
+      eval_accruals("test_accrual.bin", "test_accrual_out.bin", 3, FALSE),
+      ERROR);
+  ck_assert_int_eq(access("test_accrual_out.bin.ckpt", F_OK), -1);
+  deposit_accrual *invalid = read_file("test_accrual_out.bin", &size);
+  ck_assert_int_eq(invalid[5].interest, DEPOSIT_INVALID);
+  stat("test_accrual.bin", &st);
+  mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+  resume_accruals(invalid, size, mtime, ACCRUAL_DONE_INVALID, ERROR, invalid);
+
+  remove("test_accrual.bin");
+  remove("test_accrual_out.bin");
+  free(accounts);
+  free(full);
+  free(marked);
+  free(invalid);
+}
+END_TEST
+
+#define RING_THREADS 4
+#define RING_ITEMS 50000
+
+typedef struct ring_test {
+  ring *q;
+  int id;
+  unsigned char *seen;
+} ring_test;
+
+static void *ring_producer(void *arg) {
+  ring_test *t = arg;
+  for (int i = 0; i < RING_ITEMS; i++)
+    ring_push_wait(t->q, (void *)(uintptr_t)(t->id * RING_ITEMS + i + 1));
+  return NULL;
+}
+
+static void *ring_consumer(void *arg) {
+  ring_test *t = arg;
+  void *item;
+  while ((item = ring_pop_wait(t->q)) != NULL)
+    __atomic_add_fetch(&t->seen[(uintptr_t)item - 1], 1, __ATOMIC_RELAXED);
+  return NULL;
+}
+
+START_TEST(test_ring) {
+  ring q;
+  ck_assert_int_eq(ring_init(&q, 8), OK);
+  unsigned char *seen = calloc(RING_THREADS * RING_ITEMS, 1);
+  ring_test tests[2 * RING_THREADS];
+  pthread_t ids[2 * RING_THREADS];
+  for (int i = 0; i < 2 * RING_THREADS; i++) {
+    tests[i] = (ring_test){&q, i % RING_THREADS, seen};
+    pthread_create(&ids[i], NULL, i < RING_THREADS ? ring_producer
+                                                   : ring_consumer,
+                   &tests[i]);
+  }
+  for (int i = 0; i < RING_THREADS; i++) pthread_join(ids[i], NULL);
+  for (int i = 0; i < RING_THREADS; i++) ring_push_wait(&q, NULL);
+  for (int i = RING_THREADS; i < 2 * RING_THREADS; i++)
+    pthread_join(ids[i], NULL);
+  int wrong = 0;
+  for (int i = 0; i < RING_THREADS * RING_ITEMS; i++) wrong += seen[i] != 1;
+  ck_assert_int_eq(wrong, 0);
+  void *item = NULL;
+  ck_assert_int_eq(ring_pop(&q, &item), ERROR);
+  free(seen);
+  ring_free(&q);
+}
+END_TEST
+
+START_TEST(test_csv) {
+  int n = 3 * CSV_BATCH + 5;
+  char *input = malloc(32 * (n + 1)), *expect = malloc(64 * (n + 1));
+  size_t in_len = sprintf(input, "x,\"y, mm\"\n");
+  size_t expect_len =
+      sprintf(expect, "x,\"y, mm\",t,\"sum(k, 1, 2, k * x)\"\n");
+  for (int i = 0; i < n; i++) {
+    in_len += sprintf(input + in_len, "%d,%d\n", i, n - i);
+    expect_len += sprintf(expect + expect_len, "%d,%d,%d,%d\n", i, n - i,
+                          n, 3 * i);
+  }
+  const char *exprs[] = {"t = x + y", "sum(k, 1, 2, k * x)"};
+  column_bind binds[] = {{'y', "y, mm"}};
+  char *result = NULL;
+  size_t result_len = 0;
+  FILE *in = fmemopen(input, in_len, "r");
+  FILE *out = open_memstream(&result, &result_len);
+  ck_assert_int_eq(eval_csv(in, out, exprs, 2, binds, 1, 4, P_DOUBLE), OK);
+  fclose(in);
+  fclose(out);
+  ck_assert_int_eq(result_len, expect_len);
+  ck_assert(memcmp(result, expect, expect_len) == 0);
+  free(result);
+
+  // вывод не помещается в буфер: ошибка записи не теряется
+  char small[8];
+  in = fmemopen(input, in_len, "r");
+  out = fmemopen(small, sizeof(small), "w");
+  ck_assert_int_eq(eval_csv(in, out, exprs, 2, binds, 1, 2, P_DOUBLE), ERROR);
+  fclose(in);
+  fclose(out);
+  free(input);
+  free(expect);
+}
+END_TEST
+
 Suite *sample_suite() {
   Suite *s = suite_create("calc logic testing");
 
@@ -313,6 +1428,32 @@ Suite *sample_suite() {
   tcase_add_test(tc_core, test_validate_ok);
   tcase_add_test(tc_core, test_differential_payments);
   tcase_add_test(tc_core, test_annuity_payment);
+  tcase_add_test(tc_core, test_credit_schedule);
+  tcase_add_test(tc_core, test_credit_prepayment);
+  tcase_add_test(tc_core, test_credit_curve);
+  tcase_add_test(tc_core, test_effective_rate);
+  tcase_add_test(tc_core, test_credit_minor);
+  tcase_add_test(tc_core, test_deposit);
+  tcase_add_test(tc_core, test_deposit_accrual);
+  tcase_add_test(tc_core, test_credit_sweep);
+  tcase_add_test(tc_core, test_portfolio);
+  tcase_add_test(tc_core, test_program);
+  tcase_add_test(tc_core, test_dual);
+  tcase_add_test(tc_core, test_roots);
+  tcase_add_test(tc_core, test_integral);
+  tcase_add_test(tc_core, test_cumulative_integral);
+  tcase_add_test(tc_core, test_ddouble);
+  tcase_add_test(tc_core, test_program_vars);
+  tcase_add_test(tc_core, test_smartcalc_api);
+  tcase_add_test(tc_core, test_library);
+  tcase_add_test(tc_core, test_preview);
+  tcase_add_test(tc_core, test_pool);
+  tcase_add_test(tc_core, test_aggregate);
+  tcase_add_test(tc_core, test_budget);
+  tcase_add_test(tc_core, test_columns);
+  tcase_add_test(tc_core, test_accrual);
+  tcase_add_test(tc_core, test_ring);
+  tcase_add_test(tc_core, test_csv);
   suite_add_tcase(s, tc_core);
 
   return s;